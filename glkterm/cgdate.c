@@ -4,7 +4,11 @@
 #include <time.h>
 #include <sys/time.h>
 #include "glk.h"
+#ifdef MEMGLK
+#include "memglk.h"
+#else
 #include "glkterm.h"
+#endif
 
 /* This file is copied directly from the cheapglk package. */
 
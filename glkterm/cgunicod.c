@@ -2,7 +2,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include "glk.h"
+#ifdef MEMGLK
+#include "memglk.h"
+#else
 #include "glkterm.h"
+#endif
 
 /* This file (and cgunigen.c) are copied directly from the cheapglk package. */
 
@@ -143,6 +147,36 @@ glui32 gli_parse_utf8(unsigned char *buf, glui32 buflen,
 #define COND_ALL (0)
 #define COND_LINESTART (1)
 
+/* Nearly everything that passes through here is a line of plain ASCII,
+   typed at the prompt. Such text is case-changed sixteen characters at
+   a time, without touching the tables: each chunk is checked for being
+   all ASCII (by or-ing it together) and then converted with a little
+   arithmetic. Both loops are simple enough for the compiler to turn into
+   vector code. Whatever is left goes through the general code. Returns
+   the number of characters converted. */
+#define ASCII_CHUNK (16)
+
+static glui32 gli_ascii_change_case(glui32 *buf, glui32 numchars,
+    int destcase)
+{
+    glui32 ix, jx, bits;
+    glui32 from = (destcase == CASE_LOWER) ? 'A' : 'a';
+
+    for (ix=0; ix+ASCII_CHUNK<=numchars; ix+=ASCII_CHUNK) {
+        bits = 0;
+        for (jx=0; jx<ASCII_CHUNK; jx++)
+            bits |= buf[ix+jx];
+        if (bits & ~0x7F)
+            break;
+        for (jx=0; jx<ASCII_CHUNK; jx++) {
+            glui32 ch = buf[ix+jx];
+            buf[ix+jx] = ch ^ ((glui32)(ch - from < 26) << 5);
+        }
+    }
+
+    return ix;
+}
+
 /* Apply a case change to the buffer. The len is the length of the buffer
    array; numchars is the number of characters originally in it. (This
    may be less than len.) The result will be clipped to fit len, but
@@ -184,7 +218,11 @@ static glui32 gli_buffer_change_case(glui32 *buf, glui32 len,
     outcount = 0;
     outbuf = buf;
 
-    for (ix=0; ix<numchars; ix++) {
+    if (cond == COND_ALL && destcase != CASE_TITLE)
+        outcount = gli_ascii_change_case(buf,
+            (numchars < len) ? numchars : len, destcase);
+
+    for (ix=outcount; ix<numchars; ix++) {
         int target;
         int isfirst;
         glui32 res;
@@ -200,6 +238,10 @@ static glui32 gli_buffer_change_case(glui32 *buf, glui32 len,
         if (target == CASE_IDENT) {
             res = ch;
         }
+        else if (ch < 0x100) {
+            /* Latin-1 is the first block; no need to search for it. */
+            res = unigen_case_block_0x0[ch][target];
+        }
         else {
             gli_case_block_t *block;
 
@@ -300,6 +342,24 @@ static glui32 combining_class(glui32 ch)
     RETURN_COMBINING_CLASS(ch);
 }
 
+/* Return the largest character in the buffer. Nothing below U+00C0 has
+   a decomposition, and nothing below U+0300 (where the combining marks
+   begin) combines with anything, so text below those limits is already
+   decomposed or normalized, respectively. That covers every line typed
+   in Latin-1, which can then be left alone without copying it. */
+static glui32 gli_buffer_max_char(glui32 *buf, glui32 numchars)
+{
+    glui32 ix;
+    glui32 max = 0;
+
+    for (ix=0; ix<numchars; ix++) {
+        if (buf[ix] > max)
+            max = buf[ix];
+    }
+
+    return max;
+}
+
 /* This returns a new buffer (possibly longer), containing the decomposed
    form of the original buffer. The caller must free the returned buffer.
    On exit, *numcharsref contains the size of the returned buffer.
@@ -480,9 +540,13 @@ static glui32 gli_buffer_canon_compose_uni(glui32 *buf, glui32 len)
 glui32 glk_buffer_canon_decompose_uni(glui32 *buf, glui32 len,
     glui32 numchars)
 {
-    glui32 *dest = gli_buffer_canon_decompose_uni(buf, &numchars);
+    glui32 *dest;
     glui32 newlen;
 
+    if (numchars <= len && gli_buffer_max_char(buf, numchars) < 0xC0)
+        return numchars;
+
+    dest = gli_buffer_canon_decompose_uni(buf, &numchars);
     if (!dest)
         return 0;
 
@@ -501,8 +565,12 @@ glui32 glk_buffer_canon_normalize_uni(glui32 *buf, glui32 len,
     glui32 numchars)
 {
     glui32 newlen;
-    glui32 *dest = gli_buffer_canon_decompose_uni(buf, &numchars);
+    glui32 *dest;
+
+    if (numchars <= len && gli_buffer_max_char(buf, numchars) < 0x300)
+        return numchars;
 
+    dest = gli_buffer_canon_decompose_uni(buf, &numchars);
     if (!dest)
         return 0;
 
@@ -55,5 +55,18 @@ extern strid_t glkunix_stream_open_pathname_gen(char *pathname,
 extern strid_t glkunix_stream_open_pathname(char *pathname, glui32 textmode, 
     glui32 rock);
 
+/* These only matter with the -ansi library option (and only exist if
+    GlkTerm was built with OPT_ANSI_SCREEN). They send the screen output
+    to another descriptor, or hand each batch of it to a function, instead
+    of writing it to standard output. */
+extern void glkunix_set_screen_output(int fd);
+extern void glkunix_set_screen_writer(
+    void (*writer)(void *rock, char *buf, int len), void *rock);
+
+/* The timer is called after every screen update, with the time it took on
+    the monotonic clock. Pass NULL to stop timing. */
+extern void glkunix_set_update_timer(
+    void (*timer)(void *rock, long long nanoseconds), void *rock);
+
 #endif /* GT_START_H */
 
@@ -193,6 +193,9 @@ extern int pref_window_borders;
 extern int pref_precise_timing;
 extern int pref_historylen;
 extern int pref_prompt_defaults;
+#ifdef OPT_ANSI_SCREEN
+extern int pref_ansi_screen;
+#endif /* OPT_ANSI_SCREEN */
 
 /* Declarations of library internal functions. */
 
@@ -209,6 +212,7 @@ extern int gli_msgin_getchar(char *prompt, int hilite);
 extern void gli_initialize_events(void);
 extern void gli_event_store(glui32 type, window_t *win, glui32 val1, glui32 val2);
 extern void gli_set_halfdelay(void);
+extern void gli_event_wake(void);
 
 extern void gli_input_handle_key(int key);
 extern void gli_input_guess_focus(void);
@@ -252,6 +256,76 @@ extern fileref_t *gli_new_fileref(char *filename, glui32 usage,
     glui32 rock);
 extern void gli_delete_fileref(fileref_t *fref);
 
+#ifdef OPT_ANSI_SCREEN
+
+extern void gli_ansi_setup(void);
+extern void gli_ansi_resume(void);
+extern void gli_ansi_size(int *width, int *height);
+extern int gli_ansi_endwin(void);
+extern int gli_ansi_move(int y, int x);
+extern int gli_ansi_addch(unsigned long ch);
+extern int gli_ansi_addstr(char *str);
+extern int gli_ansi_attrset(unsigned long attr);
+extern int gli_ansi_attron(unsigned long attr);
+extern int gli_ansi_clrtoeol(void);
+extern int gli_ansi_clear(void);
+extern int gli_ansi_refresh(void);
+extern int gli_ansi_repaint(void);
+extern int gli_ansi_getch(void);
+extern void gli_ansi_timeout(int delay);
+extern int gli_ansi_halfdelay(int tenths);
+
+/* All screen drawing and key reading goes through these, so that the
+    -ansi option can route it to gtansi.c instead of curses. */
+#define gli_move(y, x) \
+    (pref_ansi_screen ? gli_ansi_move(y, x) : move(y, x))
+#define gli_addch(ch) \
+    (pref_ansi_screen ? gli_ansi_addch(ch) : addch(ch))
+#define gli_mvaddch(y, x, ch) \
+    (pref_ansi_screen ? (gli_ansi_move(y, x), gli_ansi_addch(ch)) \
+        : mvaddch(y, x, ch))
+#define gli_addstr(str) \
+    (pref_ansi_screen ? gli_ansi_addstr(str) : addstr(str))
+#define gli_attrset(attr) \
+    (pref_ansi_screen ? gli_ansi_attrset(attr) : attrset(attr))
+#define gli_attron(attr) \
+    (pref_ansi_screen ? gli_ansi_attron(attr) : attron(attr))
+#define gli_clrtoeol() \
+    (pref_ansi_screen ? gli_ansi_clrtoeol() : clrtoeol())
+#define gli_clear() \
+    (pref_ansi_screen ? gli_ansi_clear() : clear())
+#define gli_refresh() \
+    (pref_ansi_screen ? gli_ansi_refresh() : refresh())
+#define gli_repaint() \
+    (pref_ansi_screen ? gli_ansi_repaint() : wrefresh(curscr))
+#define gli_getch() \
+    (pref_ansi_screen ? gli_ansi_getch() : getch())
+#define gli_timeout(delay) \
+    (pref_ansi_screen ? gli_ansi_timeout(delay) : timeout(delay))
+#define gli_halfdelay(tenths) \
+    (pref_ansi_screen ? gli_ansi_halfdelay(tenths) : halfdelay(tenths))
+#define gli_endwin() \
+    (pref_ansi_screen ? gli_ansi_endwin() : endwin())
+
+#else /* OPT_ANSI_SCREEN */
+
+#define gli_move(y, x) move(y, x)
+#define gli_addch(ch) addch(ch)
+#define gli_mvaddch(y, x, ch) mvaddch(y, x, ch)
+#define gli_addstr(str) addstr(str)
+#define gli_attrset(attr) attrset(attr)
+#define gli_attron(attr) attron(attr)
+#define gli_clrtoeol() clrtoeol()
+#define gli_clear() clear()
+#define gli_refresh() refresh()
+#define gli_repaint() wrefresh(curscr)
+#define gli_getch() getch()
+#define gli_timeout(delay) timeout(delay)
+#define gli_halfdelay(tenths) halfdelay(tenths)
+#define gli_endwin() endwin()
+
+#endif /* OPT_ANSI_SCREEN */
+
 /* A macro that I can't think of anywhere else to put it. */
 
 #define gli_event_clearevent(evp)  \
@@ -0,0 +1,799 @@
+/* gtansi.c: Direct ANSI terminal screen, used instead of curses
+        for GlkTerm, curses.h implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+/* termios, poll() and ioctl() are hidden by -ansi unless we ask for
+    them. */
+#define _GNU_SOURCE
+
+#include "gtoption.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <curses.h> /* only for the KEY_ and A_ constants */
+#include "glk.h"
+#include "glkterm.h"
+#include "glkstart.h"
+
+#ifdef OPT_ANSI_SCREEN
+
+/* This is a stand-in for the handful of curses calls that GlkTerm makes,
+    selected with the -ansi option. It keeps two copies of the screen: the
+    back buffer, which the window code draws into, and the front buffer,
+    which is what the terminal is known to show. Each row has a dirty flag.
+    On refresh, only dirty rows are compared, and only the cells which
+    differ are sent, as plain VT100/ANSI escape sequences. Nothing is
+    looked up in terminfo; any terminal emulator made in the last thirty
+    years understands these.
+   Output is collected into one buffer and written out in a single call
+    at the end of each refresh. It goes to standard output, or to another
+    descriptor or writer function if the program asked for that with
+    glkunix_set_screen_output() or glkunix_set_screen_writer().
+   All of the state lives in one screen_t, and no curses SCREEN is ever
+    created, so the per-session cost is the two cell arrays and nothing
+    else.
+*/
+
+typedef struct cell_struct {
+    unsigned char ch;
+    unsigned char attr;
+} cell_t;
+
+#define attr_Bold (1)
+#define attr_Underline (2)
+#define attr_Reverse (4)
+#define attr_Unknown (0xFF) /* terminal attributes we can't vouch for */
+
+/* How long to wait for the rest of an escape sequence before deciding
+    that the player just hit the escape key. */
+#define ESCAPE_DELAY (25)
+
+/* Gaps of unchanged cells at most this wide are rewritten rather than
+    skipped, since a cursor movement costs more than that. */
+#define SPAN_GAP (4)
+
+typedef struct screen_struct {
+    int width, height;
+    cell_t *back; /* what the library has drawn */
+    cell_t *front; /* what the terminal is showing */
+    unsigned char *rowdirty; /* rows where back may differ from front */
+    int fullrepaint; /* clear the terminal and draw everything */
+
+    int cury, curx; /* the drawing position */
+    unsigned char attr; /* the drawing attributes */
+    int termy, termx; /* the terminal's cursor, or -1 if unknown */
+    unsigned char termattr;
+
+    char *outbuf;
+    long outlen, outsize;
+    int outfd;
+    void (*writer)(void *rock, char *buf, int len);
+    void *writerrock;
+
+    int infd;
+    unsigned char inbuf[32];
+    int inlen;
+    int delay; /* as for curses timeout(): -1 blocks, 0 doesn't wait */
+
+    struct termios origtios;
+    int tiosvalid;
+} screen_t;
+
+static screen_t screen = {
+    0, 0, NULL, NULL, NULL, FALSE,
+    0, 0, 0, -1, -1, 0,
+    NULL, 0, 0, -1, NULL, NULL,
+    -1, { 0 }, 0, -1
+};
+
+static char *enter_seq = "\033[?1049h\033[H\033[2J";
+static char *leave_seq = "\033[0m\033[?1049l";
+
+static void resize_buffers(int width, int height);
+static void enter_terminal(void);
+static void leave_terminal(void);
+static void out_bytes(char *buf, long len);
+static void out_str(char *str);
+static void out_move(int y, int x);
+static void out_attr(unsigned char attr);
+static void out_flush(void);
+static void scroll_region(void);
+static void draw_row(int y);
+static int fill_input(int msec);
+static int decode_key(void);
+
+#ifdef OPT_USE_SIGNALS
+static void sig_stop(int val);
+#endif /* OPT_USE_SIGNALS */
+
+/* Set up the terminal. This is called from gli_setup_curses() in place
+    of initscr(). */
+void gli_ansi_setup()
+{
+    int width, height;
+
+    screen.infd = fileno(stdin);
+    if (screen.outfd == -1)
+        screen.outfd = fileno(stdout);
+
+    if (tcgetattr(screen.infd, &screen.origtios) == 0)
+        screen.tiosvalid = TRUE;
+
+    gli_ansi_size(&width, &height);
+    enter_terminal();
+
+#ifdef OPT_USE_SIGNALS
+    signal(SIGTSTP, &sig_stop);
+#endif /* OPT_USE_SIGNALS */
+}
+
+/* Put the terminal back the way we found it. This is our endwin(). */
+int gli_ansi_endwin()
+{
+    out_flush();
+    leave_terminal();
+    return OK;
+}
+
+/* Called from the SIGCONT handler, after the program has been stopped
+    and resumed. The terminal was restored when we stopped, so take it
+    over again. This only calls async-signal-safe functions. */
+void gli_ansi_resume()
+{
+    if (screen.writer)
+        return;
+#ifdef OPT_USE_SIGNALS
+    signal(SIGTSTP, &sig_stop);
+#endif /* OPT_USE_SIGNALS */
+    enter_terminal();
+    screen.fullrepaint = TRUE;
+}
+
+/* Measure the terminal, and resize the buffers if it has changed. This is
+    the only place where the screen size is checked. */
+void gli_ansi_size(int *width, int *height)
+{
+    struct winsize ws;
+    int newwid = 0, newhgt = 0;
+
+    if (ioctl(screen.outfd, TIOCGWINSZ, &ws) == 0
+        || ioctl(screen.infd, TIOCGWINSZ, &ws) == 0) {
+        newwid = ws.ws_col;
+        newhgt = ws.ws_row;
+    }
+    if (newwid <= 0 || newhgt <= 0) {
+        /* Not a terminal, or it won't say. */
+        newwid = 80;
+        newhgt = 24;
+    }
+
+    if (newwid != screen.width || newhgt != screen.height)
+        resize_buffers(newwid, newhgt);
+
+    *width = screen.width;
+    *height = screen.height;
+}
+
+static void resize_buffers(int width, int height)
+{
+    int ix;
+
+    screen.back = (cell_t *)realloc(screen.back,
+        width * height * sizeof(cell_t));
+    screen.front = (cell_t *)realloc(screen.front,
+        width * height * sizeof(cell_t));
+    screen.rowdirty = (unsigned char *)realloc(screen.rowdirty,
+        height * sizeof(unsigned char));
+    if (!screen.back || !screen.front || !screen.rowdirty) {
+        screen.width = 0;
+        screen.height = 0;
+        return;
+    }
+
+    screen.width = width;
+    screen.height = height;
+    if (screen.cury >= height)
+        screen.cury = height-1;
+    if (screen.curx >= width)
+        screen.curx = width-1;
+    for (ix=0; ix<width*height; ix++) {
+        screen.back[ix].ch = ' ';
+        screen.back[ix].attr = 0;
+    }
+    screen.fullrepaint = TRUE;
+}
+
+/* The drawing calls. These only touch the back buffer. */
+
+int gli_ansi_move(int y, int x)
+{
+    if (y < 0 || y >= screen.height || x < 0 || x >= screen.width)
+        return ERR;
+    screen.cury = y;
+    screen.curx = x;
+    return OK;
+}
+
+int gli_ansi_addch(unsigned long ch)
+{
+    cell_t *cell;
+
+    if (screen.cury >= screen.height)
+        return ERR;
+
+    ch &= 0xFF;
+    if (ch == '\n') {
+        gli_ansi_clrtoeol();
+        screen.curx = 0;
+        if (screen.cury+1 < screen.height)
+            screen.cury++;
+        return OK;
+    }
+
+    cell = &screen.back[screen.cury * screen.width + screen.curx];
+    if (cell->ch != ch || cell->attr != screen.attr) {
+        cell->ch = ch;
+        cell->attr = screen.attr;
+        screen.rowdirty[screen.cury] = TRUE;
+    }
+
+    /* Wrap like curses does, but never scroll. */
+    screen.curx++;
+    if (screen.curx >= screen.width) {
+        if (screen.cury+1 < screen.height) {
+            screen.curx = 0;
+            screen.cury++;
+        }
+        else {
+            screen.curx = screen.width-1;
+        }
+    }
+    return OK;
+}
+
+int gli_ansi_addstr(char *str)
+{
+    for (; *str; str++)
+        gli_ansi_addch((unsigned char)*str);
+    return OK;
+}
+
+int gli_ansi_attrset(unsigned long attr)
+{
+    screen.attr = 0;
+    return gli_ansi_attron(attr);
+}
+
+int gli_ansi_attron(unsigned long attr)
+{
+    if (attr & A_BOLD)
+        screen.attr |= attr_Bold;
+    if (attr & A_UNDERLINE)
+        screen.attr |= attr_Underline;
+    if (attr & (A_REVERSE | A_STANDOUT))
+        screen.attr |= attr_Reverse;
+    return OK;
+}
+
+int gli_ansi_clrtoeol()
+{
+    int ix;
+    cell_t *cell;
+
+    if (screen.cury >= screen.height)
+        return ERR;
+
+    cell = &screen.back[screen.cury * screen.width];
+    for (ix=screen.curx; ix<screen.width; ix++) {
+        if (cell[ix].ch != ' ' || cell[ix].attr != 0) {
+            cell[ix].ch = ' ';
+            cell[ix].attr = 0;
+            screen.rowdirty[screen.cury] = TRUE;
+        }
+    }
+    return OK;
+}
+
+/* Like curses clear(): blank the screen, and repaint all of it on the
+    next refresh. */
+int gli_ansi_clear()
+{
+    int ix;
+
+    for (ix=0; ix<screen.width*screen.height; ix++) {
+        screen.back[ix].ch = ' ';
+        screen.back[ix].attr = 0;
+    }
+    screen.cury = 0;
+    screen.curx = 0;
+    screen.fullrepaint = TRUE;
+    return OK;
+}
+
+/* Like wrefresh(curscr): send the whole screen again, whatever we think
+    the terminal shows. */
+int gli_ansi_repaint()
+{
+    screen.fullrepaint = TRUE;
+    return gli_ansi_refresh();
+}
+
+/* Bring the terminal up to date with the back buffer, and put the
+    terminal cursor at the drawing position. */
+int gli_ansi_refresh()
+{
+    int jx;
+
+    if (!screen.back)
+        return ERR;
+
+    if (screen.fullrepaint) {
+        screen.fullrepaint = FALSE;
+        out_str("\033[0m\033[H\033[2J");
+        screen.termattr = 0;
+        screen.termy = 0;
+        screen.termx = 0;
+        for (jx=0; jx<screen.width*screen.height; jx++) {
+            screen.front[jx].ch = ' ';
+            screen.front[jx].attr = 0;
+        }
+        for (jx=0; jx<screen.height; jx++)
+            screen.rowdirty[jx] = TRUE;
+    }
+    else {
+        scroll_region();
+    }
+
+    for (jx=0; jx<screen.height; jx++) {
+        if (screen.rowdirty[jx]) {
+            draw_row(jx);
+            screen.rowdirty[jx] = FALSE;
+        }
+    }
+
+    out_move(screen.cury, screen.curx);
+    out_flush();
+    return OK;
+}
+
+/* Send the changed spans of one row. */
+static void draw_row(int y)
+{
+    cell_t *back = &screen.back[y * screen.width];
+    cell_t *front = &screen.front[y * screen.width];
+    int ix, end, gap;
+
+    ix = 0;
+    while (ix < screen.width) {
+        if (back[ix].ch == front[ix].ch && back[ix].attr == front[ix].attr) {
+            ix++;
+            continue;
+        }
+
+        /* Find the end of this span, swallowing short gaps. */
+        end = ix+1;
+        gap = 0;
+        while (end+gap < screen.width && gap <= SPAN_GAP) {
+            if (back[end+gap].ch == front[end+gap].ch
+                && back[end+gap].attr == front[end+gap].attr) {
+                gap++;
+            }
+            else {
+                end += gap+1;
+                gap = 0;
+            }
+        }
+
+        out_move(y, ix);
+        while (ix < end) {
+            int beg = ix;
+            char buf[256];
+            out_attr(back[ix].attr);
+            for (; ix<end && ix-beg<sizeof(buf)
+                && back[ix].attr == back[beg].attr; ix++) {
+                buf[ix-beg] = back[ix].ch;
+                front[ix] = back[ix];
+            }
+            out_bytes(buf, ix-beg);
+        }
+        screen.termx = end;
+        if (screen.termx >= screen.width) {
+            /* The terminal may or may not have wrapped. */
+            screen.termy = -1;
+            screen.termx = -1;
+        }
+    }
+}
+
+/* A line-buffered window that scrolls shifts a block of rows up the
+    screen. Spot that, and let the terminal do the shifting, so that only
+    the new lines have to be sent. This looks for the shift which moves
+    the most rows that have changed into place. */
+static void scroll_region()
+{
+    int shift, jx, run, top, score;
+    int bestshift = 0, besttop = 0, bestrun = 0, bestscore = 0;
+    int width = screen.width;
+    size_t rowsize = width * sizeof(cell_t);
+    char buf[64];
+
+    for (jx=0; jx<screen.height; jx++) {
+        if (screen.rowdirty[jx])
+            break;
+    }
+    if (jx == screen.height)
+        return;
+
+    for (shift=1; shift<screen.height; shift++) {
+        run = 0;
+        score = 0;
+        for (jx=0; jx+shift<screen.height; jx++) {
+            cell_t *back = &screen.back[jx * width];
+            if (!memcmp(back, &screen.front[(jx+shift) * width], rowsize)) {
+                run++;
+                if (screen.rowdirty[jx] && memcmp(back,
+                    &screen.front[jx * width], rowsize)) {
+                    int ix;
+                    for (ix=0; ix<width; ix++) {
+                        if (back[ix].ch != ' ' || back[ix].attr != 0)
+                            break;
+                    }
+                    if (ix < width)
+                        score++;
+                }
+                if (score > bestscore) {
+                    bestscore = score;
+                    bestshift = shift;
+                    besttop = jx+1-run;
+                    bestrun = run;
+                }
+            }
+            else {
+                run = 0;
+                score = 0;
+            }
+        }
+    }
+
+    if (bestscore < 3)
+        return;
+
+    /* Rows besttop..besttop+bestrun-1 of the back buffer are rows
+        besttop+bestshift.. of the front buffer. Scroll the region which
+        covers both up by bestshift. */
+    top = besttop;
+    out_attr(0);
+    sprintf(buf, "\033[%d;%dr\033[%dS\033[r",
+        top+1, top+bestrun+bestshift, bestshift);
+    out_str(buf);
+    /* Setting the scroll region homes the cursor. */
+    screen.termy = 0;
+    screen.termx = 0;
+
+    memmove(&screen.front[top * width],
+        &screen.front[(top+bestshift) * width], bestrun * rowsize);
+    for (jx=top+bestrun; jx<top+bestrun+bestshift; jx++) {
+        int ix;
+        for (ix=0; ix<width; ix++) {
+            screen.front[jx * width + ix].ch = ' ';
+            screen.front[jx * width + ix].attr = 0;
+        }
+        screen.rowdirty[jx] = TRUE;
+    }
+}
+
+static void out_str(char *str)
+{
+    out_bytes(str, strlen(str));
+}
+
+static void out_bytes(char *str, long len)
+{
+    if (screen.outlen + len > screen.outsize) {
+        long newsize = (screen.outsize + len) * 2;
+        char *newbuf = (char *)realloc(screen.outbuf, newsize);
+        if (!newbuf)
+            return;
+        screen.outbuf = newbuf;
+        screen.outsize = newsize;
+    }
+    memcpy(screen.outbuf + screen.outlen, str, len);
+    screen.outlen += len;
+}
+
+static void out_move(int y, int x)
+{
+    char buf[32];
+
+    if (y == screen.termy && x == screen.termx)
+        return;
+    if (y == screen.termy)
+        sprintf(buf, "\033[%dG", x+1);
+    else
+        sprintf(buf, "\033[%d;%dH", y+1, x+1);
+    out_str(buf);
+    screen.termy = y;
+    screen.termx = x;
+}
+
+static void out_attr(unsigned char attr)
+{
+    char buf[16];
+
+    if (attr == screen.termattr)
+        return;
+    strcpy(buf, "\033[0");
+    if (attr & attr_Bold)
+        strcat(buf, ";1");
+    if (attr & attr_Underline)
+        strcat(buf, ";4");
+    if (attr & attr_Reverse)
+        strcat(buf, ";7");
+    strcat(buf, "m");
+    out_str(buf);
+    screen.termattr = attr;
+}
+
+static void out_flush()
+{
+    long pos = 0;
+
+    if (screen.writer) {
+        if (screen.outlen)
+            (*screen.writer)(screen.writerrock, screen.outbuf, screen.outlen);
+        screen.outlen = 0;
+        return;
+    }
+
+    while (pos < screen.outlen) {
+        long count = write(screen.outfd, screen.outbuf + pos,
+            screen.outlen - pos);
+        if (count < 0) {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        pos += count;
+    }
+    screen.outlen = 0;
+}
+
+/* When writing to a terminal, these two only use write() and tcsetattr(),
+    so they can be called from signal handlers. With a writer function
+    there's no terminal of ours to stop or resume, so that never happens. */
+
+static void enter_terminal()
+{
+    if (screen.tiosvalid) {
+        struct termios tios = screen.origtios;
+        /* The same modes as curses cbreak(), noecho() and nonl(). */
+        tios.c_lflag &= ~(ICANON | ECHO | IEXTEN);
+        tios.c_iflag &= ~(ICRNL | INLCR | IGNCR);
+        tios.c_cc[VMIN] = 1;
+        tios.c_cc[VTIME] = 0;
+        tcsetattr(screen.infd, TCSADRAIN, &tios);
+    }
+    if (screen.writer) {
+        out_str(enter_seq);
+    }
+    else if (write(screen.outfd, enter_seq, strlen(enter_seq)) == -1) {
+        /* Nothing useful to do about it. */
+    }
+    screen.termy = -1;
+    screen.termx = -1;
+    screen.termattr = attr_Unknown;
+}
+
+static void leave_terminal()
+{
+    if (screen.writer) {
+        out_str(leave_seq);
+        out_flush();
+    }
+    else if (write(screen.outfd, leave_seq, strlen(leave_seq)) == -1) {
+        /* Nothing useful to do about it. */
+    }
+    if (screen.tiosvalid)
+        tcsetattr(screen.infd, TCSADRAIN, &screen.origtios);
+}
+
+#ifdef OPT_USE_SIGNALS
+
+/* Signal handler for SIGTSTP. Give the terminal back before stopping;
+    gli_ansi_resume() takes it over again. */
+static void sig_stop(int val)
+{
+    if (!screen.writer)
+        leave_terminal();
+    signal(SIGTSTP, SIG_DFL);
+    raise(SIGTSTP);
+}
+
+#endif /* OPT_USE_SIGNALS */
+
+/* Input. */
+
+void gli_ansi_timeout(int delay)
+{
+    screen.delay = delay;
+}
+
+int gli_ansi_halfdelay(int tenths)
+{
+    screen.delay = tenths * 100;
+    return OK;
+}
+
+/* Wait up to msec milliseconds (forever if negative) for input, and add
+    what arrives to inbuf. Returns the number of bytes added. */
+static int fill_input(int msec)
+{
+    struct pollfd pfd;
+    int count;
+
+    if (screen.inlen >= sizeof(screen.inbuf))
+        return 0;
+
+    pfd.fd = screen.infd;
+    pfd.events = POLLIN;
+    if (poll(&pfd, 1, msec) <= 0)
+        return 0;
+
+    count = read(screen.infd, screen.inbuf + screen.inlen,
+        sizeof(screen.inbuf) - screen.inlen);
+    if (count <= 0)
+        return 0;
+    screen.inlen += count;
+    return count;
+}
+
+/* Like curses getch() with keypad() on: returns a byte, a KEY_ value, or
+    ERR if nothing arrived in time. */
+int gli_ansi_getch()
+{
+    int key;
+
+    while (TRUE) {
+        if (screen.inlen == 0 && !fill_input(screen.delay))
+            return ERR;
+        key = decode_key();
+        if (key != ERR)
+            return key;
+        /* An escape sequence we don't know; it's been thrown away. */
+    }
+}
+
+static void consume_input(int len)
+{
+    screen.inlen -= len;
+    memmove(screen.inbuf, screen.inbuf+len, screen.inlen);
+}
+
+/* Take one key off the front of inbuf. */
+static int decode_key()
+{
+    unsigned char *buf = screen.inbuf;
+    int ix, param, key;
+
+    if (buf[0] != '\033') {
+        key = buf[0];
+        consume_input(1);
+        return key;
+    }
+
+    if (screen.inlen < 2)
+        fill_input(ESCAPE_DELAY);
+    if (screen.inlen < 2 || (buf[1] != '[' && buf[1] != 'O')) {
+        /* A bare escape key. (Or alt-something, which curses also
+            reports as an escape followed by the key.) */
+        consume_input(1);
+        return '\033';
+    }
+
+    if (buf[1] == 'O') {
+        if (screen.inlen < 3)
+            fill_input(ESCAPE_DELAY);
+        if (screen.inlen < 3) {
+            consume_input(1);
+            return '\033';
+        }
+        switch (buf[2]) {
+            case 'A': key = KEY_UP; break;
+            case 'B': key = KEY_DOWN; break;
+            case 'C': key = KEY_RIGHT; break;
+            case 'D': key = KEY_LEFT; break;
+            case 'H': key = KEY_HOME; break;
+            case 'F': key = KEY_END; break;
+            case 'M': key = KEY_ENTER; break;
+            case 'P': key = KEY_F(1); break;
+            case 'Q': key = KEY_F(2); break;
+            case 'R': key = KEY_F(3); break;
+            case 'S': key = KEY_F(4); break;
+            default: key = ERR; break;
+        }
+        consume_input(3);
+        return key;
+    }
+
+    /* A CSI sequence: parameter bytes, then a final byte from 0x40 to
+        0x7E. The Linux console sends F1-F5 as ESC [ [ A-E. */
+    ix = 2;
+    while (TRUE) {
+        if (ix >= screen.inlen && !fill_input(ESCAPE_DELAY))
+            break;
+        if (ix == 2 && buf[ix] == '[') {
+            ix++;
+            continue;
+        }
+        if (buf[ix] >= 0x40 && buf[ix] <= 0x7E)
+            break;
+        ix++;
+    }
+    if (ix >= screen.inlen) {
+        consume_input(1);
+        return '\033';
+    }
+
+    if (buf[2] == '[') {
+        key = (buf[3] >= 'A' && buf[3] <= 'E') ? KEY_F(1 + buf[3] - 'A') : ERR;
+        consume_input(ix+1);
+        return key;
+    }
+
+    param = 0;
+    if (buf[2] >= '0' && buf[2] <= '9')
+        param = atoi((char *)buf+2);
+
+    switch (buf[ix]) {
+        case 'A': key = KEY_UP; break;
+        case 'B': key = KEY_DOWN; break;
+        case 'C': key = KEY_RIGHT; break;
+        case 'D': key = KEY_LEFT; break;
+        case 'H': key = KEY_HOME; break;
+        case 'F': key = KEY_END; break;
+        case '~':
+            switch (param) {
+                case 1: case 7: key = KEY_HOME; break;
+                case 4: case 8: key = KEY_END; break;
+                case 2: key = KEY_IC; break;
+                case 3: key = KEY_DC; break;
+                case 5: key = KEY_PPAGE; break;
+                case 6: key = KEY_NPAGE; break;
+                case 11: case 12: case 13: case 14: case 15:
+                    key = KEY_F(param - 10); break;
+                case 17: case 18: case 19: case 20: case 21:
+                    key = KEY_F(param - 11); break;
+                case 23: case 24:
+                    key = KEY_F(param - 12); break;
+                default: key = ERR; break;
+            }
+            break;
+        default: key = ERR; break;
+    }
+    consume_input(ix+1);
+    return key;
+}
+
+/* Called by the program (typically in glkunix_startup_code) to send the
+    screen output somewhere other than standard output. */
+void glkunix_set_screen_output(int fd)
+{
+    screen.outfd = fd;
+}
+
+void glkunix_set_screen_writer(void (*writer)(void *rock, char *buf, int len),
+    void *rock)
+{
+    screen.writer = writer;
+    screen.writerrock = rock;
+}
+
+#endif /* OPT_ANSI_SCREEN */
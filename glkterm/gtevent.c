@@ -4,6 +4,10 @@
     http://www.eblong.com/zarf/glk/index.html
 */
 
+/* poll(), pipe() and timerfd_create() are hidden by -ansi unless we ask
+    for them. */
+#define _GNU_SOURCE
+
 #include "gtoption.h"
 #include <stdio.h>
 #include <stdlib.h>
@@ -13,6 +17,19 @@
 #include <sys/time.h>
 #endif /* OPT_TIMED_INPUT */
 
+#ifdef OPT_POLL_EVENTS
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <stdint.h>
+#include <sys/timerfd.h>
+#define USE_TIMERFD
+#endif /* __linux__ */
+#endif /* OPT_POLL_EVENTS */
+
 #include <curses.h>
 #include "glk.h"
 #include "glkterm.h"
@@ -25,7 +42,29 @@ static int halfdelay_running; /* TRUE if halfdelay() has been called. */
 static glui32 timing_msec; /* The current timed-event request, exactly as
     passed to glk_request_timer_events(). */
 
-#ifdef OPT_TIMED_INPUT
+#ifdef OPT_POLL_EVENTS
+
+    /* The self-pipe. Signal handlers write a byte to wake_fds[1], so that
+        a glk_select() sleeping in poll() notices them at once. */
+    static int wake_fds[2] = { -1, -1 };
+
+#ifdef USE_TIMERFD
+    /* The kernel timer which delivers glk_request_timer_events() ticks.
+        If it could not be created, this is -1 and the clock below is
+        used instead. */
+    static int timer_fd = -1;
+#endif /* USE_TIMERFD */
+    /* The monotonic time (in milliseconds) of the next timer event. This
+        is only valid if timing_msec is nonzero and there is no timer_fd. */
+    static long long next_msec;
+    static long long monotonic_msec(void);
+
+    static int check_timer(void);
+    static void wait_for_activity(void);
+
+#endif /* OPT_POLL_EVENTS */
+
+#if defined(OPT_TIMED_INPUT) && !defined(OPT_POLL_EVENTS)
 
     /* The time at which the next timed event will occur. This is only valid 
         if timing_msec is nonzero. */
@@ -41,6 +80,22 @@ void gli_initialize_events()
     halfdelay_running = FALSE;
     timing_msec = 0;
 
+#ifdef OPT_POLL_EVENTS
+    if (pipe(wake_fds) == 0) {
+        fcntl(wake_fds[0], F_SETFL, O_NONBLOCK);
+        fcntl(wake_fds[1], F_SETFL, O_NONBLOCK);
+        fcntl(wake_fds[0], F_SETFD, FD_CLOEXEC);
+        fcntl(wake_fds[1], F_SETFD, FD_CLOEXEC);
+    }
+    else {
+        wake_fds[0] = -1;
+        wake_fds[1] = -1;
+    }
+#ifdef USE_TIMERFD
+    timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+#endif /* USE_TIMERFD */
+#endif /* OPT_POLL_EVENTS */
+
     gli_set_halfdelay();
 }
 
@@ -62,10 +117,18 @@ void glk_select(event_t *event)
             all windows which require it. */
         if (needrefresh) {
             gli_windows_place_cursor();
-            refresh();
+            gli_refresh();
             needrefresh = FALSE;
         }
-        key = getch();
+
+#ifdef OPT_POLL_EVENTS
+        /* Never block inside curses; poll() below does the waiting. This
+            is set on every pass because a SIGWINCH may have handed us a
+            fresh stdscr. */
+        gli_timeout(0);
+#endif /* OPT_POLL_EVENTS */
+
+        key = gli_getch();
         
 #ifdef OPT_USE_SIGNALS
         if (just_killed) {
@@ -109,6 +172,16 @@ void glk_select(event_t *event)
 
 #endif /* OPT_USE_SIGNALS */
 
+#ifdef OPT_POLL_EVENTS
+        if (check_timer()) {
+            gli_event_store(evtype_Timer, NULL, 0, 0);
+            continue;
+        }
+
+        /* Nothing is pending. Sleep until a key, a signal or the timer
+            wakes us up. */
+        wait_for_activity();
+#else /* OPT_POLL_EVENTS */
 #ifdef OPT_TIMED_INPUT
         /* Check to see if we've passed next_time. */
         if (timing_msec) {
@@ -124,9 +197,16 @@ void glk_select(event_t *event)
             }
         }
 #endif /* OPT_TIMED_INPUT */
+#endif /* OPT_POLL_EVENTS */
 
     }
     
+#ifdef OPT_POLL_EVENTS
+    /* Outside glk_select(), getch() callers (the message line input
+        code) expect to block until a key arrives. */
+    gli_timeout(-1);
+#endif /* OPT_POLL_EVENTS */
+
     /* An event has occurred; glk_select() is over. */
     gli_windows_trim_buffers();
     curevent = NULL;
@@ -150,7 +230,7 @@ void glk_select_poll(event_t *event)
         firsttime = FALSE;
 
         gli_windows_place_cursor();
-        refresh();
+        gli_refresh();
         
 #ifdef OPT_USE_SIGNALS
 
@@ -171,6 +251,12 @@ void glk_select_poll(event_t *event)
 
 #endif /* OPT_USE_SIGNALS */
 
+#ifdef OPT_POLL_EVENTS
+        if (check_timer()) {
+            gli_event_store(evtype_Timer, NULL, 0, 0);
+            continue;
+        }
+#else /* OPT_POLL_EVENTS */
 #ifdef OPT_TIMED_INPUT
         /* Check to see if we've passed next_time. */
         if (timing_msec) {
@@ -186,6 +272,7 @@ void glk_select_poll(event_t *event)
             }
         }
 #endif /* OPT_TIMED_INPUT */
+#endif /* OPT_POLL_EVENTS */
     }
 
     curevent = NULL;
@@ -207,9 +294,127 @@ void gli_event_store(glui32 type, window_t *win, glui32 val1, glui32 val2)
 void glk_request_timer_events(glui32 millisecs)
 {
     timing_msec = millisecs;
+
+#ifdef OPT_POLL_EVENTS
+#ifdef USE_TIMERFD
+    if (timer_fd != -1) {
+        struct itimerspec spec;
+        spec.it_value.tv_sec = millisecs / 1000;
+        spec.it_value.tv_nsec = (millisecs % 1000) * 1000000L;
+        spec.it_interval = spec.it_value;
+        /* A zero it_value disarms the timer, which is just what a
+            request for zero milliseconds means. */
+        timerfd_settime(timer_fd, 0, &spec, NULL);
+    }
+    else
+#endif /* USE_TIMERFD */
+    if (millisecs)
+        next_msec = monotonic_msec() + millisecs;
+#endif /* OPT_POLL_EVENTS */
+
     gli_set_halfdelay();
 }
 
+#ifdef OPT_POLL_EVENTS
+
+/* With OPT_POLL_EVENTS, none of the halfdelay() business below is
+    needed. glk_select() sleeps in poll() on the terminal, the self-pipe
+    and the timer, so an idle program uses no CPU at all, and timer events
+    arrive when they are due rather than at the next tenth of a second.
+   This is still called when curses is restarted (after SIGCONT or
+    SIGWINCH), so that getch() goes back to blocking mode. */
+void gli_set_halfdelay()
+{
+    gli_timeout(-1);
+}
+
+/* Wake up a glk_select() which is sleeping in poll(). This is called from
+    signal handlers, so it must stay async-signal-safe. */
+void gli_event_wake()
+{
+    char ch = 0;
+    int savederrno = errno;
+
+    if (wake_fds[1] != -1) {
+        if (write(wake_fds[1], &ch, 1) == -1) {
+            /* The pipe is full, so a wakeup is already pending. */
+        }
+    }
+    errno = savederrno;
+}
+
+/* Return TRUE (once) if a timer event is due. */
+static int check_timer()
+{
+    if (!timing_msec)
+        return FALSE;
+
+#ifdef USE_TIMERFD
+    if (timer_fd != -1) {
+        uint64_t expirations;
+        if (read(timer_fd, &expirations, sizeof(expirations)) 
+            == sizeof(expirations) && expirations > 0)
+            return TRUE;
+        return FALSE;
+    }
+#endif /* USE_TIMERFD */
+    if (monotonic_msec() >= next_msec) {
+        next_msec = monotonic_msec() + timing_msec;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+/* Block until the terminal has input, a signal handler has written to the
+    self-pipe, or the timer has fired. Spurious returns are harmless; the
+    glk_select() loop just checks everything again. */
+static void wait_for_activity()
+{
+    struct pollfd fds[3];
+    int nfds = 0;
+    int msec = -1;
+    char drain[64];
+
+    fds[nfds].fd = fileno(stdin);
+    fds[nfds].events = POLLIN;
+    nfds++;
+
+    if (wake_fds[0] != -1) {
+        fds[nfds].fd = wake_fds[0];
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+
+#ifdef USE_TIMERFD
+    if (timing_msec && timer_fd != -1) {
+        fds[nfds].fd = timer_fd;
+        fds[nfds].events = POLLIN;
+        nfds++;
+    }
+    else
+#endif /* USE_TIMERFD */
+    if (timing_msec) {
+        long long now = monotonic_msec();
+        msec = (next_msec > now) ? (int)(next_msec - now) : 0;
+    }
+
+    if (poll(fds, nfds, msec) == -1 && errno != EINTR)
+        return;
+
+    if (wake_fds[0] != -1) {
+        while (read(wake_fds[0], drain, sizeof(drain)) > 0) { }
+    }
+}
+
+static long long monotonic_msec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+#else /* OPT_POLL_EVENTS */
+
 /* The timed-input handling is a little obscure. This is because curses.h
     timed input is a little obscure. As far as I can tell, once you turn
     on timeouts by calling halfdelay(), you can't turn them off again. At
@@ -267,11 +472,16 @@ void gli_set_halfdelay()
 #endif /* OPT_USE_SIGNALS */
 
     if (halfdelay_running)
-        halfdelay(delay);
+        gli_halfdelay(delay);
 
 #endif /* OPT_TIMED_INPUT */
 }
 
+void gli_event_wake()
+{
+    /* Nothing to do; glk_select() wakes up by itself every half second. */
+}
+
 #ifdef OPT_TIMED_INPUT
 
 /* Given a time value, add a fixed delay to it. */
@@ -293,3 +503,5 @@ static void add_millisec_to_time(struct timeval *tv, glui32 msec)
 
 #endif /* OPT_TIMED_INPUT */
 
+#endif /* OPT_POLL_EVENTS */
+
@@ -66,24 +66,24 @@ void gli_msgline_redraw()
         return;
         
     if (msgbuflen == 0) {
-        move(content_box.bottom, 0);
-        clrtoeol();
+        gli_move(content_box.bottom, 0);
+        gli_clrtoeol();
     }
     else {
         int ix, len;
         
-        move(content_box.bottom, 0);
-        addch(' ');
-        addch(' ');
-        attron(A_REVERSE);
+        gli_move(content_box.bottom, 0);
+        gli_addch(' ');
+        gli_addch(' ');
+        gli_attron(A_REVERSE);
         if (msgbuflen > content_box.right-3)
             len = content_box.right-3;
         else
             len = msgbuflen;
         for (ix=0; ix<len; ix++) {
-            addch(msgbuf[ix]);
+            gli_addch(msgbuf[ix]);
         }
-        attrset(0);
-        clrtoeol();
+        gli_attrset(0);
+        gli_clrtoeol();
     }
 }
@@ -61,31 +61,31 @@ int gli_msgin_getchar(char *prompt, int hilite)
     }
     else {
         orgy = content_box.bottom-1;
-        move(orgy, 0);
-        clrtoeol();
+        gli_move(orgy, 0);
+        gli_clrtoeol();
     }
 
-    move(orgy, LEFT_MARGIN);
+    gli_move(orgy, LEFT_MARGIN);
     if (hilite)
-        attron(A_REVERSE);
-    addstr(prompt);
+        gli_attron(A_REVERSE);
+    gli_addstr(prompt);
     if (hilite)
-        attrset(0);
+        gli_attrset(0);
 
-    move(orgy, orgx);
-    refresh();
+    gli_move(orgy, orgx);
+    gli_refresh();
 
     key = ERR;
     while (key == ERR) {
-        key = getch();
+        key = gli_getch();
     }
     
     if (pref_messageline) {
         gli_msgline(NULL);
     }
     else {
-        move(orgy, 0);
-        clrtoeol();
+        gli_move(orgy, 0);
+        gli_clrtoeol();
         /* We have to redraw everything, unfortunately, to fix the
             last line. */
         gli_windows_update();
@@ -124,12 +124,12 @@ int gli_msgin_getline(char *prompt, char *buf, int maxlen, int *length)
     }
     else {
         lin->orgy = content_box.bottom-1;
-        move(lin->orgy, 0);
-        clrtoeol();
+        gli_move(lin->orgy, 0);
+        gli_clrtoeol();
     }
     
-    move(lin->orgy, LEFT_MARGIN);
-    addstr(lin->prompt);
+    gli_move(lin->orgy, LEFT_MARGIN);
+    gli_addstr(lin->prompt);
     update_text(lin);
     
     needrefresh = TRUE;
@@ -137,13 +137,13 @@ int gli_msgin_getline(char *prompt, char *buf, int maxlen, int *length)
     while (!lin->done) {
         int key;
         
-        move(lin->orgy, lin->orgx + lin->curs);
+        gli_move(lin->orgy, lin->orgx + lin->curs);
         if (needrefresh) {
-            refresh();
+            gli_refresh();
             needrefresh = FALSE;
         }
 
-        key = getch();
+        key = gli_getch();
         
         if (key != ERR) {
             handle_key(lin, key);
@@ -156,8 +156,8 @@ int gli_msgin_getline(char *prompt, char *buf, int maxlen, int *length)
         gli_msgline(NULL);
     }
     else {
-        move(lin->orgy, 0);
-        clrtoeol();
+        gli_move(lin->orgy, 0);
+        gli_clrtoeol();
         /* We have to redraw everything, unfortunately, to fix the
             last line. */
         gli_windows_update();
@@ -171,11 +171,11 @@ static void update_text(inline_t *lin)
 {
     int ix;
     
-    move(lin->orgy, lin->orgx);
+    gli_move(lin->orgy, lin->orgx);
     for (ix=0; ix<lin->len; ix++) {
-        addch(lin->buf[ix]);
+        gli_addch(lin->buf[ix]);
     }
-    clrtoeol();
+    gli_clrtoeol();
 }
 
 static void handle_key(inline_t *lin, int key)
@@ -146,7 +146,7 @@ void glk_exit()
 
     gli_streams_close_all();
 
-    endwin();
+    gli_endwin();
     putchar('\n');
     exit(0);
 }
@@ -47,6 +47,34 @@
     gtevent.c to use a different time API.
 */
 
+#define OPT_POLL_EVENTS
+
+/* OPT_POLL_EVENTS should be defined if your OS has the poll() and pipe()
+    calls, which is true of any Unix. If this is defined, glk_select()
+    sleeps in poll() until a key is typed, a signal arrives, or a timer
+    event is due, instead of waking up every tenth of a second via
+    halfdelay(). An idle program then uses no CPU time at all. On Linux,
+    timer events are delivered by a timerfd, which gives them millisecond
+    accuracy; elsewhere poll()'s own timeout is used.
+   If this is defined, the halfdelay() code described under
+    OPT_TIMED_INPUT is not used (and the -precise option has no effect),
+    but OPT_TIMED_INPUT must still be defined for timed input to work.
+*/
+
+#define OPT_ANSI_SCREEN
+
+/* OPT_ANSI_SCREEN should be defined if your OS has termios and your
+    terminal understands ANSI (VT100) escape sequences, which is true of
+    any Unix terminal emulator. If this is defined, the -ansi option
+    makes GlkTerm draw the screen and read keys itself (see gtansi.c),
+    instead of going through curses. This skips terminfo and the curses
+    screen structures, and lets the program send the output somewhere
+    other than standard output (see glkunix_set_screen_output() in
+    glkstart.h).
+   Curses is still used by default, and is still needed to compile, since
+    the key codes come from curses.h.
+*/
+
 #define OPT_USE_SIGNALS
 
 /* OPT_USE_SIGNALS should be defined if your OS uses SIGINT, SIGHUP,
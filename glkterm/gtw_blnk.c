@@ -42,14 +42,14 @@ void win_blank_redraw(window_t *win)
     window_blank_t *dwin = win->data;
 
     for (jx=win->bbox.top; jx<win->bbox.bottom; jx++) {
-        move(jx, win->bbox.left);
+        gli_move(jx, win->bbox.left);
         for (ix=win->bbox.left; ix<win->bbox.right; ix++)
-            addch(':');
+            gli_addch(':');
     }
     
-    mvaddch(win->bbox.top, win->bbox.left, '/');
-    mvaddch(win->bbox.top, win->bbox.right-1, '\\');
-    mvaddch(win->bbox.bottom-1, win->bbox.left, '\\');
-    mvaddch(win->bbox.bottom-1, win->bbox.right-1, '/');
+    gli_mvaddch(win->bbox.top, win->bbox.left, '/');
+    gli_mvaddch(win->bbox.top, win->bbox.right-1, '\\');
+    gli_mvaddch(win->bbox.bottom-1, win->bbox.left, '\\');
+    gli_mvaddch(win->bbox.bottom-1, win->bbox.right-1, '/');
 }
 
@@ -601,24 +601,24 @@ static void updatetext(window_textbuffer_t *dwin)
             if (lx >= 0 && lx < dwin->numlines) {
                 tbline_t *ln = &(dwin->lines[lx]);
                 int count = 0;
-                move(orgy+physln, orgx);
+                gli_move(orgy+physln, orgx);
                 for (wx=0; wx<ln->printwords; wx++) {
                     tbword_t *wd = &(ln->words[wx]);
                     if (wd->type == wd_Text || wd->type == wd_Blank) {
                         unsigned char *cx = (unsigned char *)&(dwin->chars[wd->pos]);
                         /* unsigned, so that addch() doesn't get fed any high
                             style bits. */
-                        attrset(win_textbuffer_styleattrs[wd->style]);
+                        gli_attrset(win_textbuffer_styleattrs[wd->style]);
                         for (ix=0; ix<wd->len; ix++, cx++, count++)
-                            addch(*cx);
+                            gli_addch(*cx);
                     }
                 }
-                attrset(0);
+                gli_attrset(0);
                 gli_print_spaces(dwin->width - count);
             }
             else {
                 /* blank lines at bottom */
-                move(orgy+physln, orgx);
+                gli_move(orgy+physln, orgx);
                 gli_print_spaces(dwin->width);
             }
         }
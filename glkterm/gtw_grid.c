@@ -16,6 +16,10 @@
     gtwgrid.h); within a line, just store an array of characters and
     an array of style bytes, the same size. (If we ever have more than
     255 styles, things will have to be changed, but that's unlikely.)
+    Each line also keeps a copy of what was last drawn, so that an update
+    only sends the cells which actually changed. A program which clears
+    and rewrites a status window every turn then costs almost nothing
+    when most of it is the same.
 */
 
 static void init_lines(window_textgrid_t *dwin, int beg, int end, int linewid);
@@ -55,6 +59,7 @@ window_textgrid_t *win_textgrid_create(window_t *win)
     dwin->lines = NULL;
     dwin->dirtybeg = -1;
     dwin->dirtyend = -1;
+    dwin->drawnvalid = FALSE;
     
     dwin->inbuf = NULL;
     dwin->inunicode = FALSE;
@@ -126,7 +131,12 @@ void win_textgrid_rearrange(window_t *win, grect_t *box)
                     ln->size * sizeof(char));
                 ln->attrs = (unsigned char *)realloc(ln->attrs, 
                     ln->size * sizeof(unsigned char));
-                if (!ln->chars || !ln->attrs) {
+                ln->drawnchars = (char *)realloc(ln->drawnchars, 
+                    ln->size * sizeof(char));
+                ln->drawnattrs = (unsigned char *)realloc(ln->drawnattrs, 
+                    ln->size * sizeof(unsigned char));
+                if (!ln->chars || !ln->attrs 
+                    || !ln->drawnchars || !ln->drawnattrs) {
                     dwin->lines = NULL;
                     return;
                 }
@@ -143,6 +153,8 @@ void win_textgrid_rearrange(window_t *win, grect_t *box)
 
     dwin->dirtybeg = 0;
     dwin->dirtyend = dwin->height;
+    /* The window may have moved, so we can't trust what's on the screen. */
+    dwin->drawnvalid = FALSE;
 }
 
 static void init_lines(window_textgrid_t *dwin, int beg, int end, int linewid)
@@ -156,7 +168,9 @@ static void init_lines(window_textgrid_t *dwin, int beg, int end, int linewid)
         ln->dirtyend = -1;
         ln->chars = (char *)malloc(ln->size * sizeof(char));
         ln->attrs = (unsigned char *)malloc(ln->size * sizeof(unsigned char));
-        if (!ln->chars || !ln->size) {
+        ln->drawnchars = (char *)malloc(ln->size * sizeof(char));
+        ln->drawnattrs = (unsigned char *)malloc(ln->size * sizeof(unsigned char));
+        if (!ln->chars || !ln->attrs || !ln->drawnchars || !ln->drawnattrs) {
             dwin->lines = NULL;
             return;
         }
@@ -181,6 +195,14 @@ static void final_lines(window_textgrid_t *dwin)
             free(ln->attrs);
             ln->attrs = NULL;
         }
+        if (ln->drawnchars) {
+            free(ln->drawnchars);
+            ln->drawnchars = NULL;
+        }
+        if (ln->drawnattrs) {
+            free(ln->drawnattrs);
+            ln->drawnattrs = NULL;
+        }
     }
     
     free(dwin->lines);
@@ -189,18 +211,22 @@ static void final_lines(window_textgrid_t *dwin)
 
 static void updatetext(window_textgrid_t *dwin, int drawall)
 {
-    int ix, jx, beg, iix;
+    int ix, jx, beg, iix, end;
     int orgx, orgy;
     unsigned char curattr;
     
-    if (drawall) {
-        dwin->dirtybeg = 0;
-        dwin->dirtyend = dwin->height;
-    }
-    else {
-        if (dwin->dirtyend > dwin->height) {
+    if (drawall || !dwin->drawnvalid) {
+        /* Whatever is on the screen is unknown, so every dirty cell gets
+            drawn, and the drawn arrays are refilled as we go. */
+        if (drawall) {
+            dwin->dirtybeg = 0;
             dwin->dirtyend = dwin->height;
         }
+        drawall = TRUE;
+    }
+    
+    if (dwin->dirtyend > dwin->height) {
+        dwin->dirtyend = dwin->height;
     }
     
     if (dwin->dirtybeg == -1)
@@ -224,20 +250,34 @@ static void updatetext(window_textgrid_t *dwin, int drawall)
         if (ln->dirtybeg == -1)
             continue;
         
-        /* draw one line. */
-        move(orgy+jx, orgx+ln->dirtybeg);
-        
+        /* draw the changed spans of one line. */
         ix=ln->dirtybeg;
         while (ix<ln->dirtyend) {
             unsigned char *ucx;
-            beg = ix;
-            curattr = ln->attrs[beg];
-            for (ix++; ix<ln->dirtyend && ln->attrs[ix] == curattr; ix++) { }
-            attrset(win_textgrid_styleattrs[curattr]);
-            ucx = (unsigned char *)ln->chars; /* unsigned, so that addch() doesn't
-                get fed any high style bits. */
-            for (iix=beg; iix<ix; iix++) {
-                addch(ucx[iix]);
+            if (!drawall && ln->chars[ix] == ln->drawnchars[ix]
+                && ln->attrs[ix] == ln->drawnattrs[ix]) {
+                ix++;
+                continue;
+            }
+            /* find the end of this changed span. */
+            for (end=ix+1; end<ln->dirtyend; end++) {
+                if (!drawall && ln->chars[end] == ln->drawnchars[end]
+                    && ln->attrs[end] == ln->drawnattrs[end])
+                    break;
+            }
+            gli_move(orgy+jx, orgx+ix);
+            while (ix<end) {
+                beg = ix;
+                curattr = ln->attrs[beg];
+                for (ix++; ix<end && ln->attrs[ix] == curattr; ix++) { }
+                gli_attrset(win_textgrid_styleattrs[curattr]);
+                ucx = (unsigned char *)ln->chars; /* unsigned, so that addch() doesn't
+                    get fed any high style bits. */
+                for (iix=beg; iix<ix; iix++) {
+                    gli_addch(ucx[iix]);
+                    ln->drawnchars[iix] = ln->chars[iix];
+                    ln->drawnattrs[iix] = ln->attrs[iix];
+                }
             }
         }
         
@@ -245,10 +285,11 @@ static void updatetext(window_textgrid_t *dwin, int drawall)
         ln->dirtyend = -1;
     }
     
-    attrset(0);
+    gli_attrset(0);
     
     dwin->dirtybeg = -1;
     dwin->dirtyend = -1;
+    dwin->drawnvalid = TRUE;
 }
 
 void win_textgrid_redraw(window_t *win)
@@ -9,6 +9,8 @@ typedef struct tgline_struct {
     int size; /* this is the allocated size; only width is valid */
     char *chars;
     unsigned char *attrs;
+    char *drawnchars; /* what was last sent to curses; same size as chars */
+    unsigned char *drawnattrs;
     int dirtybeg, dirtyend; /* characters [dirtybeg, dirtyend) need to be redrawn */
 } tgline_t;
 
@@ -23,6 +25,7 @@ typedef struct window_textgrid_struct {
     int curx, cury; /* the window cursor position */
     
     int dirtybeg, dirtyend; /* lines [dirtybeg, dirtyend) need to be redrawn */
+    int drawnvalid; /* the drawn arrays match the screen */
     
     /* for line input */
     void *inbuf; /* char* or glui32*, depending on inunicode. */
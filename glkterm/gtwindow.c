@@ -4,9 +4,13 @@
     http://www.eblong.com/zarf/glk/index.html
 */
 
+/* clock_gettime() is hidden by -ansi unless we ask for it. */
+#define _GNU_SOURCE
+
 #include "gtoption.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <time.h>
 
 #ifdef OPT_USE_SIGNALS
 #include <signal.h>
@@ -110,6 +114,14 @@ void gli_initialize_windows()
     is reinitialized for a screen-size change. */
 void gli_setup_curses()
 {
+#ifdef OPT_ANSI_SCREEN
+    if (pref_ansi_screen) {
+        /* No curses at all; see gtansi.c. */
+        gli_ansi_setup();
+        return;
+    }
+#endif /* OPT_ANSI_SCREEN */
+
     initscr();
     cbreak();
     noecho();
@@ -125,13 +137,19 @@ void gli_setup_curses()
 static void gli_sig_resume(int val)
 {
     signal(SIGCONT, &gli_sig_resume);
+#ifdef OPT_ANSI_SCREEN
+    if (pref_ansi_screen)
+        gli_ansi_resume();
+#endif /* OPT_ANSI_SCREEN */
     just_resumed = TRUE;
+    gli_event_wake();
 }
 
 /* Signal handler for SIGINT. */
 static void gli_sig_interrupt(int val)
 {
     just_killed = TRUE;
+    gli_event_wake();
 }
 
 #ifdef OPT_WINCHANGED_SIGNAL
@@ -139,14 +157,24 @@ static void gli_sig_interrupt(int val)
 /* Signal handler for SIGWINCH. */
 static void gli_sig_winsize(int val)
 {
-    endwin();
+#ifdef OPT_ANSI_SCREEN
+    if (pref_ansi_screen) {
+        /* The new size is measured by compute_content_box(), which
+            isn't safe to call from here. */
+    }
+    else
+#endif /* OPT_ANSI_SCREEN */
+    {
+        endwin();
 
-    newterm(getenv("TERM"), stdout, stdin);
-    gli_setup_curses();
-    gli_set_halfdelay();
+        newterm(getenv("TERM"), stdout, stdin);
+        gli_setup_curses();
+        gli_set_halfdelay();
+    }
 
     screen_size_changed = TRUE;
     signal(SIGWINCH, &gli_sig_winsize);
+    gli_event_wake();
 }
 
 #endif /* OPT_WINCHANGED_SIGNAL */
@@ -163,7 +191,7 @@ void gli_fast_exit()
     }
 
     gli_streams_close_all();
-    endwin();
+    gli_endwin();
     putchar('\n');
     exit(0);
 }
@@ -175,15 +203,21 @@ static void compute_content_box()
         place where COLS and LINES are checked. All the rest of the
         layout code uses content_box. */
     int width, height;
+    int screenwidth = COLS, screenheight = LINES;
     
+#ifdef OPT_ANSI_SCREEN
+    if (pref_ansi_screen)
+        gli_ansi_size(&screenwidth, &screenheight);
+#endif /* OPT_ANSI_SCREEN */
+
     if (pref_screenwidth)
         width = pref_screenwidth;
     else
-        width = COLS;
+        width = screenwidth;
     if (pref_screenheight)
         height = pref_screenheight;
     else
-        height = LINES;
+        height = screenheight;
     
     content_box.left = 0;
     content_box.top = 0;
@@ -617,6 +651,14 @@ void glk_window_set_arrangement(window_t *win, glui32 method, glui32 size,
         return;
     }
 
+    if (newdir == dwin->dir && key == dwin->key && size == dwin->size
+        && (method & winmethod_DivisionMask) == dwin->division
+        && ((method & winmethod_BorderMask) == winmethod_Border) == dwin->hasborder) {
+        /* Nothing changes, so don't rearrange and redraw the whole
+            subtree. */
+        return;
+    }
+
     if ((newbackward && !dwin->backward) || (!newbackward && dwin->backward)) {
         /* switch the children */
         window_t *tmpwin = dwin->child1;
@@ -851,9 +893,31 @@ void gli_window_rearrange(window_t *win, grect_t *box)
     }
 }
 
+/* Told how long each screen update took, if the program asks. */
+static void (*update_timer)(void *rock, long long nanoseconds) = NULL;
+static void *update_timer_rock = NULL;
+
+void glkunix_set_update_timer(
+    void (*timer)(void *rock, long long nanoseconds), void *rock)
+{
+    update_timer = timer;
+    update_timer_rock = rock;
+}
+
+static long long monotonic_nsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
 void gli_windows_update()
 {
     window_t *win;
+    long long start = 0;
+    
+    if (update_timer)
+        start = monotonic_nsec();
     
     for (win=gli_windowlist; win; win=win->next) {
         switch (win->type) {
@@ -865,6 +929,9 @@ void gli_windows_update()
                 break;
         }
     }
+    
+    if (update_timer)
+        (*update_timer)(update_timer_rock, monotonic_nsec() - start);
 }
 
 void gli_window_redraw(window_t *win)
@@ -899,13 +966,13 @@ void gli_windows_redraw()
     }
     else {
         /* There are no windows at all. */
-        clear();
+        gli_clear();
         ix = (content_box.left+content_box.right) / 2 - 7;
         if (ix < 0)
             ix = 0;
         jx = (content_box.top+content_box.bottom) / 2;
-        move(jx, ix);
-        addstr("Please wait...");
+        gli_move(jx, ix);
+        gli_addstr("Please wait...");
     }
 }
 
@@ -937,10 +1004,10 @@ void gli_windows_place_cursor()
             default:
                 break;
         }
-        move(gli_focuswin->bbox.top + ypos, gli_focuswin->bbox.left + xpos);
+        gli_move(gli_focuswin->bbox.top + ypos, gli_focuswin->bbox.left + xpos);
     }
     else {
-        move(content_box.bottom-1, content_box.right-1);
+        gli_move(content_box.bottom-1, content_box.right-1);
     }
 }
 
@@ -1234,12 +1301,12 @@ void glk_window_move_cursor(window_t *win, glui32 xpos, glui32 ypos)
 void gli_print_spaces(int len)
 {
     while (len >= NUMSPACES) {
-        addstr(spacebuffer);
+        gli_addstr(spacebuffer);
         len -= NUMSPACES;
     }
     
     if (len > 0) {
-        addstr(&(spacebuffer[NUMSPACES - len]));
+        gli_addstr(&(spacebuffer[NUMSPACES - len]));
     }
 }
 
@@ -1307,10 +1374,10 @@ void gcmd_win_change_focus(window_t *win, glui32 arg)
 
 void gcmd_win_refresh(window_t *win, glui32 arg)
 {
-    clear();
+    gli_clear();
     gli_windows_redraw();
     gli_msgline_redraw();
-    wrefresh(curscr);
+    gli_repaint();
 }
 
 #ifdef GLK_MODULE_IMAGE
@@ -25,6 +25,9 @@ int pref_window_borders = FALSE;
 int pref_precise_timing = FALSE;
 int pref_historylen = 20;
 int pref_prompt_defaults = TRUE;
+#ifdef OPT_ANSI_SCREEN
+int pref_ansi_screen = FALSE;
+#endif /* OPT_ANSI_SCREEN */
 
 /* Some constants for my wacky little command-line option parser. */
 #define ex_Void (0)
@@ -177,6 +180,10 @@ int main(int argc, char *argv[])
         else if (extract_value(argc, argv, "precise", ex_Bool, &ix, &val, pref_precise_timing))
             pref_precise_timing = val;
 #endif /* !OPT_TIMED_INPUT */
+#ifdef OPT_ANSI_SCREEN
+        else if (extract_value(argc, argv, "ansi", ex_Bool, &ix, &val, pref_ansi_screen))
+            pref_ansi_screen = val;
+#endif /* OPT_ANSI_SCREEN */
         else {
             printf("%s: unknown option: %s\n", argv[0], argv[ix]);
             errflag = TRUE;
@@ -214,6 +221,9 @@ int main(int argc, char *argv[])
 #ifdef OPT_TIMED_INPUT
         printf("  -precise BOOL: more precise timing for timed input (burns more CPU time) (default 'no')\n");
 #endif /* !OPT_TIMED_INPUT */
+#ifdef OPT_ANSI_SCREEN
+        printf("  -ansi BOOL: draw with ANSI escape sequences instead of curses (default 'no')\n");
+#endif /* OPT_ANSI_SCREEN */
         printf("  -version: display Glk library version\n");
         printf("  -help: display this list\n");
         printf("NUM values can be any number. BOOL values can be 'yes' or 'no', or no value to toggle.\n");
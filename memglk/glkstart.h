@@ -0,0 +1,135 @@
+/* glkstart.h: Unix-specific header file for GlkTerm, CheapGlk, and XGlk
+        (Unix implementations of the Glk API).
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+/* This header defines an interface that must be used by program linked
+    with the various Unix Glk libraries -- at least, the three I wrote.
+    (I encourage anyone writing a Unix Glk library to use this interface,
+    but it's not part of the Glk spec.)
+    
+    Because Glk is *almost* perfectly portable, this interface *almost*
+    doesn't have to exist. In practice, it's small.
+*/
+
+#ifndef GT_START_H
+#define GT_START_H
+
+/* We define our own TRUE and FALSE and NULL, because ANSI
+    is a strange world. */
+#ifndef TRUE
+#define TRUE 1
+#endif
+#ifndef FALSE
+#define FALSE 0
+#endif
+#ifndef NULL
+#define NULL 0
+#endif
+
+#define glkunix_arg_End (0)
+#define glkunix_arg_ValueFollows (1)
+#define glkunix_arg_NoValue (2)
+#define glkunix_arg_ValueCanFollow (3)
+#define glkunix_arg_NumberValue (4)
+
+typedef struct glkunix_argumentlist_struct {
+    char *name;
+    int argtype;
+    char *desc;
+} glkunix_argumentlist_t;
+
+typedef struct glkunix_startup_struct {
+    int argc;
+    char **argv;
+} glkunix_startup_t;
+
+extern glkunix_argumentlist_t glkunix_arguments[];
+
+extern int glkunix_startup_code(glkunix_startup_t *data);
+
+extern void glkunix_set_base_file(char *filename);
+extern strid_t glkunix_stream_open_pathname_gen(char *pathname, 
+    glui32 writemode, glui32 textmode, glui32 rock);
+extern strid_t glkunix_stream_open_pathname(char *pathname, glui32 textmode, 
+    glui32 rock);
+
+/* The rest of this header is MemGlk's own. A host -- a server, or a test
+    harness -- links the game with MemGlk and drives it through these
+    calls, usually from glkunix_startup_code() or from the handlers
+    below. */
+
+/* One run of text in a single style. In a text buffer window, line is -1
+    and the spans of a frame follow on from each other. In a text grid
+    window, line is the row, and the spans for that row cover all of it. */
+typedef struct memglk_span_struct {
+    glsi32 line;
+    glui32 style;
+    glui32 *text;
+    glui32 len;
+} memglk_span_t;
+
+/* What happened to one window since the last frame. */
+typedef struct memglk_update_struct {
+    winid_t win;
+    glui32 rock;
+    glui32 type; /* a wintype_* constant */
+    int left, top, width, height; /* position on the virtual screen */
+    int cleared; /* the host should discard the old contents first */
+    int lineinput, charinput; /* the window is waiting for input */
+    int numspans;
+    memglk_span_t *spans;
+} memglk_update_t;
+
+/* Everything the program displayed between two glk_select() calls. If
+    layoutchanged is set, every window has an update (possibly with no
+    spans), and windows not mentioned have been closed. Otherwise only
+    windows with new output or pending input are listed. prompt is the
+    text of a file prompt when the library wants a filename, and exiting
+    is set on the last frame before the program exits. All of this
+    belongs to the library and is only valid during the frame handler. */
+typedef struct memglk_frame_struct {
+    glui32 turn;
+    int layoutchanged;
+    int numupdates;
+    memglk_update_t *updates;
+    char *prompt;
+    int exiting;
+} memglk_frame_t;
+
+/* Input is queued; glk_select() takes from the front of the queue. A line
+    satisfies a line input request, or a character request with its first
+    character (Return if it is empty). A key is any Latin-1 or Unicode
+    value, or a keycode_* constant. */
+extern void memglk_push_line(char *line);
+extern void memglk_push_line_uni(glui32 *line, glui32 len);
+extern void memglk_push_key(glui32 key);
+
+/* The number of lines and keys in the queue. A frame handler can tell
+    from it how much of what it pushed the program has read. */
+extern int memglk_queue_length(void);
+
+/* Resize the virtual screen. The program gets an evtype_Arrange event. */
+extern void memglk_set_screen_size(int width, int height);
+
+/* The frame handler is called once per glk_select(), and at exit. The
+    default prints text buffer output to stdout. */
+extern void memglk_set_frame_handler(
+    void (*handler)(memglk_frame_t *frame, void *rock), void *rock);
+
+/* The input handler is called when the program wants input and the queue
+    is empty. It should push something and return TRUE, or return FALSE to
+    end the program. evtype is evtype_LineInput or evtype_CharInput. The
+    default reads a line from stdin. */
+extern void memglk_set_input_handler(
+    int (*handler)(glui32 evtype, void *rock), void *rock);
+
+/* The timer is called after every frame has been collected and handled,
+    with the time it took on the monotonic clock. This is the same call as
+    in GlkTerm, where it times the screen update. Pass NULL to stop
+    timing. */
+extern void glkunix_set_update_timer(
+    void (*timer)(void *rock, long long nanoseconds), void *rock);
+
+#endif /* GT_START_H */
@@ -0,0 +1,440 @@
+/* mgevent.c: Event handling, including glk_select() and the input queue
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+#include "mgoption.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glk.h"
+#include "memglk.h"
+#include "glkstart.h"
+#include "mgw_grid.h"
+#include "mgw_buf.h"
+
+/* One entry of the input queue. A line has type evtype_LineInput and its
+    text in buf; a key has type evtype_CharInput and its value in key. */
+typedef struct inqueue_struct {
+    glui32 type;
+    glui32 *buf;
+    glui32 len;
+    glui32 key;
+    struct inqueue_struct *next;
+} inqueue_t;
+
+static inqueue_t *queuehead = NULL;
+static inqueue_t *queuetail = NULL;
+static int queuelength = 0;
+
+/* A pointer to the place where the pending glk_select() will store its
+    event. When not inside a glk_select() call, this will be NULL. */
+static event_t *curevent = NULL;
+
+/* An Arrange event which happened outside glk_select(); it is delivered
+    by the next one. */
+static int arrange_pending = FALSE;
+
+static glui32 timing_msec; /* The current timed-event request, exactly as
+    passed to glk_request_timer_events(). */
+
+static int (*input_handler)(glui32 evtype, void *rock) = NULL;
+static void *input_handler_rock = NULL;
+
+static int read_stdin_line(glui32 evtype, void *rock);
+static int deliver_input(void);
+static glui32 wanted_input(void);
+static inqueue_t *front_of_queue(glui32 evtype);
+static void pop_queue(void);
+
+/* Set up the input system. This is called from main(). */
+void gli_initialize_events()
+{
+    timing_msec = 0;
+    arrange_pending = FALSE;
+    input_handler = &read_stdin_line;
+    input_handler_rock = NULL;
+}
+
+void glk_select(event_t *event)
+{
+    glui32 want;
+
+    curevent = event;
+    gli_event_clearevent(curevent);
+
+    /* Everything the program printed since the last call goes to the
+        host in one piece. */
+    gli_frame_emit(NULL, FALSE);
+
+    if (arrange_pending) {
+        arrange_pending = FALSE;
+        gli_event_store(evtype_Arrange, NULL, 0, 0);
+    }
+
+    while (curevent->type == evtype_None) {
+        if (deliver_input())
+            continue;
+
+#ifdef OPT_TIMED_INPUT
+        /* There is no clock to wait for. If the program wants timer
+            events and no input is ready, the timer fires at once. */
+        if (timing_msec) {
+            gli_event_store(evtype_Timer, NULL, 0, 0);
+            continue;
+        }
+#endif /* OPT_TIMED_INPUT */
+
+        want = wanted_input();
+        if (!want) {
+            gli_strict_warning("select: no input or timer was requested");
+            gli_fast_exit();
+        }
+
+        /* Ask the host for more. If there isn't any, the session is
+            over. */
+        if (!(*input_handler)(want, input_handler_rock) || !queuehead)
+            gli_fast_exit();
+    }
+
+    /* An event has occurred; glk_select() is over. */
+    curevent = NULL;
+}
+
+void glk_select_poll(event_t *event)
+{
+    curevent = event;
+    gli_event_clearevent(curevent);
+
+    /* Only Arrange events can be pending without the program waiting
+        for them. Input and timer events belong to glk_select(). */
+    if (arrange_pending) {
+        arrange_pending = FALSE;
+        gli_event_store(evtype_Arrange, NULL, 0, 0);
+    }
+
+    curevent = NULL;
+}
+
+void gli_event_store(glui32 type, window_t *win, glui32 val1, glui32 val2)
+{
+    if (curevent) {
+        curevent->type = type;
+        curevent->win = win;
+        curevent->val1 = val1;
+        curevent->val2 = val2;
+    }
+    else if (type == evtype_Arrange) {
+        arrange_pending = TRUE;
+    }
+}
+
+void glk_request_timer_events(glui32 millisecs)
+{
+    timing_msec = millisecs;
+}
+
+/* Find the window that should get the next input: the one that got the
+    last input, if it is still waiting, or else the first waiting window
+    in tree order. */
+static window_t *input_window(void)
+{
+    window_t *win;
+
+    if (gli_focuswin
+        && (gli_focuswin->line_request || gli_focuswin->char_request))
+        return gli_focuswin;
+
+    for (win = gli_window_iterate_treeorder(NULL);
+        win;
+        win = gli_window_iterate_treeorder(win)) {
+        if (win->line_request || win->char_request)
+            return win;
+    }
+
+    return NULL;
+}
+
+static glui32 wanted_input()
+{
+    window_t *win = input_window();
+
+    if (!win)
+        return 0;
+    if (win->line_request)
+        return evtype_LineInput;
+    return evtype_CharInput;
+}
+
+/* Hand the front of the queue to the window waiting for input. Returns
+    TRUE if an event was stored. */
+static int deliver_input()
+{
+    window_t *win;
+    inqueue_t *ent = queuehead;
+    glui32 key;
+
+    if (!ent)
+        return FALSE;
+
+    win = input_window();
+    if (!win)
+        return FALSE;
+    gli_focuswin = win;
+
+    if (win->char_request) {
+        if (ent->type == evtype_LineInput)
+            key = (ent->len ? ent->buf[0] : keycode_Return);
+        else
+            key = ent->key;
+        pop_queue();
+
+        /* A Latin-1 request can't be handed anything larger, except the
+            special keycodes. */
+        if (!win->char_request_uni && key >= 0x100
+            && key <= (0xFFFFFFFF - keycode_MAXVAL))
+            key = '?';
+        win->char_request = FALSE;
+        gli_event_store(evtype_CharInput, win, key, 0);
+        return TRUE;
+    }
+
+    if (ent->type == evtype_CharInput) {
+        /* A key during line input. Return sends an empty line and a
+            printable key sends just that character; other special keys
+            have nothing to do, since MemGlk has no editing. */
+        key = ent->key;
+        if (key == keycode_Return) {
+            ent->len = 0;
+        }
+        else if (key <= (0xFFFFFFFF - keycode_MAXVAL)) {
+            ent->len = 1;
+            ent->buf = (glui32 *)malloc(sizeof(glui32));
+            if (ent->buf)
+                ent->buf[0] = key;
+            else
+                ent->len = 0;
+        }
+        else {
+            pop_queue();
+            return FALSE;
+        }
+    }
+
+    switch (win->type) {
+        case wintype_TextBuffer:
+            win_textbuffer_accept_line(win, ent->buf, ent->len, 0);
+            break;
+        case wintype_TextGrid:
+            win_textgrid_accept_line(win, ent->buf, ent->len, 0);
+            break;
+    }
+    pop_queue();
+
+    return TRUE;
+}
+
+/* Return the front of the queue, asking the host for input if it's
+    empty. Returns NULL if there is no input to be had. */
+static inqueue_t *front_of_queue(glui32 evtype)
+{
+    if (!queuehead) {
+        if (!(*input_handler)(evtype, input_handler_rock))
+            return NULL;
+    }
+    return queuehead;
+}
+
+static void pop_queue()
+{
+    inqueue_t *ent = queuehead;
+
+    if (!ent)
+        return;
+
+    queuehead = ent->next;
+    if (!queuehead)
+        queuetail = NULL;
+    queuelength--;
+
+    if (ent->buf)
+        free(ent->buf);
+    free(ent);
+}
+
+static void push_queue(inqueue_t *ent)
+{
+    ent->next = NULL;
+    if (queuetail)
+        queuetail->next = ent;
+    else
+        queuehead = ent;
+    queuetail = ent;
+    queuelength++;
+}
+
+int memglk_queue_length()
+{
+    return queuelength;
+}
+
+void memglk_push_line_uni(glui32 *line, glui32 len)
+{
+    inqueue_t *ent = (inqueue_t *)malloc(sizeof(inqueue_t));
+    if (!ent)
+        return;
+
+    ent->type = evtype_LineInput;
+    ent->key = 0;
+    ent->len = len;
+    ent->buf = NULL;
+    if (len) {
+        ent->buf = (glui32 *)malloc(len * sizeof(glui32));
+        if (!ent->buf) {
+            free(ent);
+            return;
+        }
+        memcpy(ent->buf, line, len * sizeof(glui32));
+    }
+
+    push_queue(ent);
+}
+
+void memglk_push_line(char *line)
+{
+    glui32 ix, len = strlen(line);
+    inqueue_t *ent = (inqueue_t *)malloc(sizeof(inqueue_t));
+    if (!ent)
+        return;
+
+    ent->type = evtype_LineInput;
+    ent->key = 0;
+    ent->len = len;
+    ent->buf = NULL;
+    if (len) {
+        ent->buf = (glui32 *)malloc(len * sizeof(glui32));
+        if (!ent->buf) {
+            free(ent);
+            return;
+        }
+        for (ix=0; ix<len; ix++)
+            ent->buf[ix] = (unsigned char)line[ix];
+    }
+
+    push_queue(ent);
+}
+
+void memglk_push_key(glui32 key)
+{
+    inqueue_t *ent = (inqueue_t *)malloc(sizeof(inqueue_t));
+    if (!ent)
+        return;
+
+    ent->type = evtype_CharInput;
+    ent->key = key;
+    ent->len = 0;
+    ent->buf = NULL;
+
+    push_queue(ent);
+}
+
+void memglk_set_input_handler(
+    int (*handler)(glui32 evtype, void *rock), void *rock)
+{
+    if (handler) {
+        input_handler = handler;
+        input_handler_rock = rock;
+    }
+    else {
+        input_handler = &read_stdin_line;
+        input_handler_rock = NULL;
+    }
+}
+
+void memglk_set_screen_size(int width, int height)
+{
+    if (width < 0 || height < 0)
+        return;
+    gli_windows_size_change(width, height);
+}
+
+/* The default input handler. Read one line of UTF-8 from stdin and queue
+    it. */
+static int read_stdin_line(glui32 evtype, void *rock)
+{
+    char buf[1024];
+    glui32 ubuf[1024];
+    int len, ulen;
+
+    fflush(stdout);
+
+    if (!fgets(buf, sizeof(buf), stdin))
+        return FALSE;
+
+    len = strlen(buf);
+    while (len && (buf[len-1] == '\n' || buf[len-1] == '\r'))
+        len--;
+
+    ulen = gli_parse_utf8((unsigned char *)buf, len, ubuf, 1024);
+    memglk_push_line_uni(ubuf, ulen);
+    return TRUE;
+}
+
+/* Get a line for a file prompt. The prompt goes to the host in a frame of
+    its own, and the front of the queue is the answer. */
+int gli_msgin_getline(char *prompt, char *buf, int maxlen, int *length)
+{
+    int ix, len;
+    inqueue_t *ent;
+
+    gli_frame_emit(prompt, FALSE);
+
+    ent = front_of_queue(evtype_LineInput);
+    if (!ent)
+        return FALSE;
+
+    if (ent->type == evtype_CharInput) {
+        /* Only Return can answer a file prompt with a key. */
+        ix = (ent->key == keycode_Return);
+        pop_queue();
+        if (ix)
+            *length = 0;
+        return ix;
+    }
+
+    len = ent->len;
+    if (len > maxlen)
+        len = maxlen;
+    for (ix=0; ix<len; ix++) {
+        glui32 val = ent->buf[ix];
+        buf[ix] = (val < 0x100) ? val : '?';
+    }
+    *length = len;
+    pop_queue();
+
+    return TRUE;
+}
+
+/* Get a single key for a yes/no question. */
+int gli_msgin_getchar(char *prompt, int hilite)
+{
+    int res;
+    inqueue_t *ent;
+
+    gli_frame_emit(prompt, FALSE);
+
+    ent = front_of_queue(evtype_CharInput);
+    if (!ent)
+        return '\033';
+
+    if (ent->type == evtype_CharInput)
+        res = (ent->key < 0x100) ? ent->key : '\033';
+    else if (ent->len)
+        res = (ent->buf[0] < 0x100) ? ent->buf[0] : '\033';
+    else
+        res = '\n';
+    pop_queue();
+
+    return res;
+}
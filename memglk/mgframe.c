@@ -0,0 +1,256 @@
+/* mgframe.c: Frames, the per-turn output handed to the host
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+/* clock_gettime() is hidden by -ansi unless we ask for it. */
+#define _GNU_SOURCE
+
+#include "mgoption.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "glk.h"
+#include "memglk.h"
+#include "glkstart.h"
+#include "mgw_grid.h"
+#include "mgw_buf.h"
+
+/* A frame is built in these two arrays, which are reused (and grown as
+    necessary) from one frame to the next. The spans of each update are
+    consecutive in the spans array, in the same order as the updates. */
+static memglk_span_t *spans = NULL;
+static int numspans = 0;
+static int spanssize = 0;
+
+static memglk_update_t *updates = NULL;
+static int numupdates = 0;
+static int updatessize = 0;
+
+static glui32 turn = 0;
+static int exited = FALSE;
+
+static void (*frame_handler)(memglk_frame_t *frame, void *rock) = NULL;
+static void *frame_handler_rock = NULL;
+
+/* Told how long each frame took, if the program asks. */
+static void (*update_timer)(void *rock, long long nanoseconds) = NULL;
+static void *update_timer_rock = NULL;
+
+static void print_frame(memglk_frame_t *frame, void *rock);
+
+/* Set up the frame system. This is called from main(). */
+void gli_initialize_frames()
+{
+    spanssize = 64;
+    spans = (memglk_span_t *)malloc(spanssize * sizeof(memglk_span_t));
+    updatessize = 8;
+    updates = (memglk_update_t *)malloc(updatessize * sizeof(memglk_update_t));
+    if (!spans || !updates) {
+        fprintf(stderr, "memglk: unable to allocate frame\n");
+        exit(1);
+    }
+
+    frame_handler = &print_frame;
+    frame_handler_rock = NULL;
+}
+
+void gli_frame_add_span(glsi32 line, glui32 style, glui32 *text,
+    glui32 len)
+{
+    memglk_span_t *span;
+
+    if (numspans >= spanssize) {
+        spanssize *= 2;
+        spans = (memglk_span_t *)realloc(spans,
+            spanssize * sizeof(memglk_span_t));
+        if (!spans) {
+            fprintf(stderr, "memglk: unable to allocate frame\n");
+            exit(1);
+        }
+    }
+
+    span = &spans[numspans++];
+    span->line = line;
+    span->style = style;
+    span->text = text;
+    span->len = len;
+}
+
+static long long monotonic_nsec()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* Collect everything that changed since the last frame and pass it to the
+    host. prompt is a file prompt to show, or NULL; exiting is set for the
+    last frame of all. */
+void gli_frame_emit(char *prompt, int exiting)
+{
+    window_t *win;
+    memglk_frame_t frame;
+    memglk_update_t *up;
+    int ix, count, cleared, pos;
+    long long start = 0;
+
+    if (exited)
+        return;
+    exited = exiting;
+
+    if (update_timer)
+        start = monotonic_nsec();
+
+    numspans = 0;
+    numupdates = 0;
+
+    for (win = gli_window_iterate_treeorder(NULL);
+        win;
+        win = gli_window_iterate_treeorder(win)) {
+        count = 0;
+        cleared = FALSE;
+        switch (win->type) {
+            case wintype_Pair:
+                continue;
+            case wintype_TextBuffer:
+                cleared = ((window_textbuffer_t *)win->data)->cleared;
+                count = win_textbuffer_frame(win);
+                break;
+            case wintype_TextGrid:
+                cleared = gli_layout_changed;
+                count = win_textgrid_frame(win, gli_layout_changed);
+                break;
+        }
+
+        if (!gli_layout_changed && !count && !cleared
+            && !win->line_request && !win->char_request)
+            continue;
+
+        if (numupdates >= updatessize) {
+            updatessize *= 2;
+            updates = (memglk_update_t *)realloc(updates,
+                updatessize * sizeof(memglk_update_t));
+            if (!updates) {
+                fprintf(stderr, "memglk: unable to allocate frame\n");
+                exit(1);
+            }
+        }
+
+        up = &updates[numupdates++];
+        up->win = win;
+        up->rock = win->rock;
+        up->type = win->type;
+        up->left = win->bbox.left;
+        up->top = win->bbox.top;
+        up->width = win->bbox.right - win->bbox.left;
+        up->height = win->bbox.bottom - win->bbox.top;
+        up->cleared = cleared;
+        up->lineinput = win->line_request;
+        up->charinput = win->char_request;
+        up->numspans = count;
+        up->spans = NULL;
+    }
+
+    /* The spans array may have moved while it grew, so the pointers are
+        only filled in now. */
+    pos = 0;
+    for (ix=0; ix<numupdates; ix++) {
+        updates[ix].spans = &spans[pos];
+        pos += updates[ix].numspans;
+    }
+
+    frame.turn = turn;
+    frame.layoutchanged = gli_layout_changed;
+    frame.numupdates = numupdates;
+    frame.updates = updates;
+    frame.prompt = prompt;
+    frame.exiting = exiting;
+
+    (*frame_handler)(&frame, frame_handler_rock);
+
+    for (win = gli_window_iterate_treeorder(NULL);
+        win;
+        win = gli_window_iterate_treeorder(win)) {
+        if (win->type == wintype_TextBuffer)
+            win_textbuffer_frame_done(win);
+    }
+
+    gli_layout_changed = FALSE;
+    turn++;
+
+    if (update_timer)
+        (*update_timer)(update_timer_rock, monotonic_nsec() - start);
+}
+
+void memglk_set_frame_handler(
+    void (*handler)(memglk_frame_t *frame, void *rock), void *rock)
+{
+    if (handler) {
+        frame_handler = handler;
+        frame_handler_rock = rock;
+    }
+    else {
+        frame_handler = &print_frame;
+        frame_handler_rock = NULL;
+    }
+}
+
+void glkunix_set_update_timer(
+    void (*timer)(void *rock, long long nanoseconds), void *rock)
+{
+    update_timer = timer;
+    update_timer_rock = rock;
+}
+
+/* The default frame handler. Text buffer output goes to stdout as plain
+    UTF-8, so that a game can be run from a script like a CheapGlk one.
+    With the -grids option, changed text grid lines are printed too,
+    each marked with a bar. */
+static void print_frame(memglk_frame_t *frame, void *rock)
+{
+    int ix, jx;
+    glui32 kx, len;
+    glsi32 line;
+
+    for (ix=0; ix<frame->numupdates; ix++) {
+        memglk_update_t *up = &frame->updates[ix];
+        if (up->type == wintype_TextGrid) {
+            if (!pref_print_grids || !up->numspans)
+                continue;
+            line = up->spans[0].line;
+            printf("|");
+            for (jx=0; jx<up->numspans; jx++) {
+                memglk_span_t *span = &up->spans[jx];
+                if (span->line != line) {
+                    printf("\n|");
+                    line = span->line;
+                }
+                len = span->len;
+                if (jx+1 == up->numspans || up->spans[jx+1].line != line) {
+                    /* Leave off the blanks at the end of the row. */
+                    while (len && span->text[len-1] == ' ')
+                        len--;
+                }
+                for (kx=0; kx<len; kx++)
+                    gli_putchar_utf8(span->text[kx], stdout);
+            }
+            printf("\n");
+        }
+        else if (up->type == wintype_TextBuffer) {
+            for (jx=0; jx<up->numspans; jx++) {
+                memglk_span_t *span = &up->spans[jx];
+                for (kx=0; kx<span->len; kx++)
+                    gli_putchar_utf8(span->text[kx], stdout);
+            }
+        }
+    }
+
+    if (frame->prompt)
+        printf("%s", frame->prompt);
+    if (frame->exiting)
+        printf("\n");
+
+    fflush(stdout);
+}
@@ -0,0 +1,73 @@
+/* mgoption.h: Options header file
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+#ifndef MGOPTION_H
+#define MGOPTION_H
+
+/* MemGlk is GlkTerm with the screen taken away. Windows, streams and
+    events live entirely in memory; whatever the program prints is handed
+    to the host as a frame at each glk_select(), and input comes from a
+    queue that the host fills. There is far less to configure than in
+    GlkTerm, because there is no terminal to worry about.
+*/
+
+/* Options: */
+
+#define LIBRARY_VERSION "1.0.4"
+#define LIBRARY_PORT "MemGlk"
+
+#define OPT_TIMED_INPUT
+
+/* OPT_TIMED_INPUT should be defined if timer events should be supported.
+    MemGlk has no clock of its own: when the program asks for timer
+    events, glk_select() reports one as soon as it has no queued input
+    to deliver, so a timed sequence runs at memory speed.
+*/
+
+#define OPT_NATIVE_LATIN_1
+
+/* OPT_NATIVE_LATIN_1 should always be defined for MemGlk. Output is
+    stored as Unicode code points and input arrives the same way, so
+    there is no native character set to translate to or from.
+*/
+
+#define OPT_FRAME_WIDTH (80)
+#define OPT_FRAME_HEIGHT (24)
+
+/* OPT_FRAME_WIDTH and OPT_FRAME_HEIGHT are the size of the virtual
+    screen, in characters, unless the -width and -height options say
+    otherwise. Window sizes and text grid contents are measured against
+    it; text buffer windows do no wrapping of their own.
+*/
+
+/* #define NO_MEMMOVE */
+
+/* NO_MEMMOVE should be defined if your standard library doesn't
+    have a memmove() function. If this is defined, a simple
+    memmove() will be defined in mgmisc.c.
+*/
+
+#define OPT_AO_FF_TYPABLE {  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+    1, 1, 1, 1, 1, 1, 1, 1,  \
+}
+
+/* OPT_AO_FF_TYPABLE is a table of which Latin-1 characters from 0xA0
+    to 0xFF can be typed, exactly as in GlkTerm. The host can push any
+    of them, so they are all 1.
+*/
+
+#endif /* MGOPTION_H */
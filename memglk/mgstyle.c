@@ -0,0 +1,98 @@
+/* mgstyle.c: Style formatting hints.
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+#include "mgoption.h"
+#include <stdio.h>
+#include "glk.h"
+#include "memglk.h"
+
+/* This version of the library doesn't accept style hints. The frame
+    carries the style number of every span, and the host decides what
+    each style looks like. */
+
+void glk_stylehint_set(glui32 wintype, glui32 styl, glui32 hint, 
+    glsi32 val)
+{
+}
+
+void glk_stylehint_clear(glui32 wintype, glui32 styl, glui32 hint)
+{
+}
+
+glui32 glk_style_distinguish(window_t *win, glui32 styl1, glui32 styl2)
+{
+    if (!win) {
+        gli_strict_warning("style_distinguish: invalid ref");
+        return FALSE;
+    }
+    
+    if (styl1 >= style_NUMSTYLES || styl2 >= style_NUMSTYLES)
+        return FALSE;
+    
+    switch (win->type) {
+        case wintype_TextBuffer:
+        case wintype_TextGrid:
+            break;
+        default:
+            return FALSE;
+    }
+    
+    /* Every style reaches the host intact, so any two of them can be
+        told apart. */
+    return (styl1 != styl2);
+}
+
+glui32 glk_style_measure(window_t *win, glui32 styl, glui32 hint, 
+    glui32 *result)
+{
+    glui32 dummy;
+
+    if (!win) {
+        gli_strict_warning("style_measure: invalid ref");
+        return FALSE;
+    }
+    
+    if (styl >= style_NUMSTYLES || hint >= stylehint_NUMHINTS)
+        return FALSE;
+    
+    switch (win->type) {
+        case wintype_TextBuffer:
+        case wintype_TextGrid:
+            break;
+        default:
+            return FALSE;
+    }
+    
+    if (!result)
+        result = &dummy;
+    
+    /* These are the same answers GlkTerm gives with its default
+        attributes. */
+    switch (hint) {
+        case stylehint_Indentation:
+        case stylehint_ParaIndentation:
+            *result = 0;
+            return TRUE;
+        case stylehint_Justification:
+            *result = stylehint_just_LeftFlush;
+            return TRUE;
+        case stylehint_Size:
+            *result = 1;
+            return TRUE;
+        case stylehint_Weight:
+            *result = (styl == style_Header || styl == style_Subheader
+                || styl == style_Input);
+            return TRUE;
+        case stylehint_Oblique:
+            *result = (styl == style_Emphasized || styl == style_Note);
+            return TRUE;
+        case stylehint_Proportional:
+            *result = FALSE;
+            return TRUE;
+    }
+    
+    return FALSE;
+}
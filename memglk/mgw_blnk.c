@@ -0,0 +1,36 @@
+/* mgw_blnk.c: The blank window type
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+#include "mgoption.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include "glk.h"
+#include "memglk.h"
+#include "mgw_blnk.h"
+
+/* This code is even simpler than in GlkTerm. A blank window has no
+    contents at all, so it never appears in a frame except to report its
+    size when the layout changes. */
+
+window_blank_t *win_blank_create(window_t *win)
+{
+    window_blank_t *dwin = (window_blank_t *)malloc(sizeof(window_blank_t));
+    dwin->owner = win;
+    
+    return dwin;
+}
+
+void win_blank_destroy(window_blank_t *dwin)
+{
+    dwin->owner = NULL;
+    free(dwin);
+}
+
+void win_blank_rearrange(window_t *win, grect_t *box)
+{
+    window_blank_t *dwin = win->data;
+    dwin->owner->bbox = *box;
+}
@@ -0,0 +1,305 @@
+/* mgw_buf.c: The buffer window type
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+#include "mgoption.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glk.h"
+#include "memglk.h"
+#include "mgw_buf.h"
+
+/* A buffer window is much simpler than in GlkTerm, because it does no
+    layout at all. It holds the text printed since the last frame, as an
+    array of characters and a list of style runs over it. When the frame
+    has been handed to the host, the text is thrown away. Wrapping,
+    scrollback and "more" prompts are left to whatever displays it.
+*/
+
+static void set_last_run(window_textbuffer_t *dwin, glui32 style);
+static void export_input_line(void *buf, int unicode, long len, glui32 *chars);
+
+window_textbuffer_t *win_textbuffer_create(window_t *win)
+{
+    window_textbuffer_t *dwin = (window_textbuffer_t *)malloc(sizeof(window_textbuffer_t));
+    dwin->owner = win;
+
+    dwin->numchars = 0;
+    dwin->charssize = 500;
+    dwin->chars = (glui32 *)malloc(dwin->charssize * sizeof(glui32));
+
+    dwin->numruns = 0;
+    dwin->runssize = 40;
+    dwin->runs = (tbrun_t *)malloc(dwin->runssize * sizeof(tbrun_t));
+
+    if (!dwin->chars || !dwin->runs)
+        return NULL;
+
+    dwin->inbuf = NULL;
+    dwin->inunicode = FALSE;
+    dwin->inecho = FALSE;
+    dwin->intermkeys = 0;
+    dwin->inlen = 0;
+
+    dwin->numruns = 1;
+    dwin->runs[0].style = style_Normal;
+    dwin->runs[0].pos = 0;
+
+    dwin->cleared = FALSE;
+
+    dwin->width = -1;
+    dwin->height = -1;
+
+    return dwin;
+}
+
+void win_textbuffer_destroy(window_textbuffer_t *dwin)
+{
+    if (dwin->inbuf) {
+        if (gli_unregister_arr) {
+            char *typedesc = (dwin->inunicode ? "&+#!Iu" : "&+#!Cn");
+            (*gli_unregister_arr)(dwin->inbuf, dwin->inmax, typedesc, dwin->inarrayrock);
+        }
+        dwin->inbuf = NULL;
+    }
+
+    dwin->owner = NULL;
+
+    if (dwin->runs) {
+        free(dwin->runs);
+        dwin->runs = NULL;
+    }
+
+    if (dwin->chars) {
+        free(dwin->chars);
+        dwin->chars = NULL;
+    }
+
+    free(dwin);
+}
+
+void win_textbuffer_rearrange(window_t *win, grect_t *box)
+{
+    window_textbuffer_t *dwin = win->data;
+    dwin->owner->bbox = *box;
+
+    dwin->width = box->right - box->left;
+    dwin->height = box->bottom - box->top;
+}
+
+/* Add the text printed since the last frame to the current frame, one
+    span per style run. Returns the number of spans added. */
+int win_textbuffer_frame(window_t *win)
+{
+    long rx, end;
+    int count = 0;
+    window_textbuffer_t *dwin = win->data;
+
+    for (rx=0; rx<dwin->numruns; rx++) {
+        if (rx+1 < dwin->numruns)
+            end = dwin->runs[rx+1].pos;
+        else
+            end = dwin->numchars;
+        if (end <= dwin->runs[rx].pos)
+            continue;
+        gli_frame_add_span(-1, dwin->runs[rx].style,
+            &dwin->chars[dwin->runs[rx].pos], end - dwin->runs[rx].pos);
+        count++;
+    }
+
+    return count;
+}
+
+/* The host has seen the frame; start collecting the next one. */
+void win_textbuffer_frame_done(window_t *win)
+{
+    window_textbuffer_t *dwin = win->data;
+
+    dwin->numchars = 0;
+    dwin->numruns = 1;
+    dwin->runs[0].style = win->style;
+    dwin->runs[0].pos = 0;
+    dwin->cleared = FALSE;
+}
+
+void win_textbuffer_putchar(window_t *win, glui32 ch)
+{
+    window_textbuffer_t *dwin = win->data;
+
+    if (dwin->numchars >= dwin->charssize) {
+        dwin->charssize *= 2;
+        dwin->chars = (glui32 *)realloc(dwin->chars,
+            dwin->charssize * sizeof(glui32));
+    }
+
+    if (win->style != dwin->runs[dwin->numruns-1].style) {
+        set_last_run(dwin, win->style);
+    }
+
+    dwin->chars[dwin->numchars] = ch;
+    dwin->numchars++;
+}
+
+static void set_last_run(window_textbuffer_t *dwin, glui32 style)
+{
+    long lx = dwin->numchars;
+    long rx = dwin->numruns-1;
+
+    if (dwin->runs[rx].pos == lx) {
+        dwin->runs[rx].style = style;
+    }
+    else {
+        rx++;
+        if (rx >= dwin->runssize) {
+            dwin->runssize *= 2;
+            dwin->runs = (tbrun_t *)realloc(dwin->runs,
+                dwin->runssize * sizeof(tbrun_t));
+        }
+        dwin->runs[rx].pos = lx;
+        dwin->runs[rx].style = style;
+        dwin->numruns++;
+    }
+}
+
+void win_textbuffer_clear(window_t *win)
+{
+    window_textbuffer_t *dwin = win->data;
+
+    /* Anything printed before the clear is of no interest to the host. */
+    win_textbuffer_frame_done(win);
+    dwin->cleared = TRUE;
+}
+
+/* Prepare the window for line input. */
+void win_textbuffer_init_line(window_t *win, void *buf, int unicode,
+    int maxlen, int initlen)
+{
+    window_textbuffer_t *dwin = win->data;
+
+    dwin->inbuf = buf;
+    dwin->inunicode = unicode;
+    dwin->inmax = maxlen;
+    dwin->inlen = (initlen > maxlen) ? maxlen : initlen;
+    dwin->inecho = win->echo_line_input;
+    dwin->intermkeys = win->terminate_line_input;
+    dwin->origstyle = win->style;
+
+    if (gli_register_arr) {
+        char *typedesc = (dwin->inunicode ? "&+#!Iu" : "&+#!Cn");
+        dwin->inarrayrock = (*gli_register_arr)(dwin->inbuf, maxlen, typedesc);
+    }
+}
+
+/* Finish line input. The line is text, which is already in the caller's
+    buffer if text is NULL. The event, if any, goes in ev. */
+static void finish_line(window_t *win, event_t *ev, glui32 *text,
+    long len, glui32 termkey)
+{
+    long ix;
+    void *inbuf;
+    int inmax, inunicode, inecho;
+    gidispatch_rock_t inarrayrock;
+    window_textbuffer_t *dwin = win->data;
+
+    inbuf = dwin->inbuf;
+    inmax = dwin->inmax;
+    inarrayrock = dwin->inarrayrock;
+    inunicode = dwin->inunicode;
+    inecho = dwin->inecho;
+
+    if (len > inmax)
+        len = inmax;
+
+    if (text)
+        export_input_line(inbuf, inunicode, len, text);
+
+    if (inecho && win->echostr) {
+        if (!inunicode)
+            gli_stream_echo_line(win->echostr, inbuf, len);
+        else
+            gli_stream_echo_line_uni(win->echostr, inbuf, len);
+    }
+
+    if (inecho) {
+        win->style = style_Input;
+        for (ix=0; ix<len; ix++) {
+            if (!inunicode)
+                win_textbuffer_putchar(win, ((unsigned char *)inbuf)[ix]);
+            else
+                win_textbuffer_putchar(win, ((glui32 *)inbuf)[ix]);
+        }
+    }
+    win->style = dwin->origstyle;
+
+    if (ev) {
+        ev->type = evtype_LineInput;
+        ev->win = win;
+        ev->val1 = len;
+        ev->val2 = termkey;
+    }
+    else {
+        gli_event_store(evtype_LineInput, win, len, termkey);
+    }
+
+    win->line_request = FALSE;
+    dwin->inbuf = NULL;
+    dwin->inmax = 0;
+    dwin->inlen = 0;
+    dwin->inecho = FALSE;
+    dwin->intermkeys = 0;
+
+    if (inecho)
+        win_textbuffer_putchar(win, '\n');
+
+    if (gli_unregister_arr) {
+        char *typedesc = (inunicode ? "&+#!Iu" : "&+#!Cn");
+        (*gli_unregister_arr)(inbuf, inmax, typedesc, inarrayrock);
+    }
+}
+
+/* Abort line input. Nothing has been typed, so what the program gets back
+    is the initial text it supplied. */
+void win_textbuffer_cancel_line(window_t *win, event_t *ev)
+{
+    window_textbuffer_t *dwin = win->data;
+
+    if (!dwin->inbuf)
+        return;
+
+    finish_line(win, ev, NULL, dwin->inlen, 0);
+}
+
+/* A line from the input queue. It ends line input. */
+void win_textbuffer_accept_line(window_t *win, glui32 *buf, long len,
+    glui32 termkey)
+{
+    window_textbuffer_t *dwin = win->data;
+
+    if (!dwin->inbuf)
+        return;
+
+    finish_line(win, NULL, buf, len, termkey);
+}
+
+/* Clone in mgw_grid.c */
+static void export_input_line(void *buf, int unicode, long len, glui32 *chars)
+{
+    int ix;
+
+    if (!unicode) {
+        for (ix=0; ix<len; ix++) {
+            glui32 kval = chars[ix];
+            if (!(kval >= 0 && kval < 256))
+                kval = '?';
+            ((unsigned char *)buf)[ix] = kval;
+        }
+    }
+    else {
+        for (ix=0; ix<len; ix++) {
+            ((glui32 *)buf)[ix] = chars[ix];
+        }
+    }
+}
@@ -0,0 +1,51 @@
+/* mgw_buf.h: The buffer window header
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+/* One style run */
+typedef struct tbrun_struct {
+    short style;
+    long pos;
+} tbrun_t;
+
+/* A buffer window keeps only what has been printed since the last frame.
+    Scrollback, wrapping and paging are the host's business. */
+typedef struct window_textbuffer_struct {
+    window_t *owner;
+    
+    glui32 *chars;
+    long numchars;
+    long charssize;
+    
+    int width, height;
+    
+    int cleared; /* Was the window cleared since the last frame? If so, the
+        host should throw away what it has before adding chars. */
+    
+    tbrun_t *runs;
+    long numruns;
+    long runssize;
+
+    /* The following are meaningful only for the current line input request. */
+    void *inbuf; /* char* or glui32*, depending on inunicode. */
+    int inunicode;
+    int inecho;
+    glui32 intermkeys;
+    int inmax;
+    int inlen; /* Length of the initial text, which cancelling returns. */
+    glui32 origstyle;
+    gidispatch_rock_t inarrayrock;
+} window_textbuffer_t;
+
+extern window_textbuffer_t *win_textbuffer_create(window_t *win);
+extern void win_textbuffer_destroy(window_textbuffer_t *dwin);
+extern void win_textbuffer_rearrange(window_t *win, grect_t *box);
+extern void win_textbuffer_putchar(window_t *win, glui32 ch);
+extern void win_textbuffer_clear(window_t *win);
+extern void win_textbuffer_init_line(window_t *win, void *buf, int unicode, int maxlen, int initlen);
+extern void win_textbuffer_cancel_line(window_t *win, event_t *ev);
+extern void win_textbuffer_accept_line(window_t *win, glui32 *buf, long len, glui32 termkey);
+extern int win_textbuffer_frame(window_t *win);
+extern void win_textbuffer_frame_done(window_t *win);
@@ -0,0 +1,544 @@
+/* mgw_grid.c: The grid window type
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+#include "mgoption.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "glk.h"
+#include "memglk.h"
+#include "mgw_grid.h"
+
+/* A grid of characters, stored just as in GlkTerm: a list of lines, each
+    an array of characters and an array of style bytes of the same size.
+    The characters are full Unicode values here, since nothing has to be
+    squeezed onto a terminal. Each line remembers which cells changed
+    since the last frame, and the frame reports those lines in full, so
+    the host can replace them without keeping any cursor state. A copy of
+    what was last reported is kept too, so that a status line which is
+    cleared and rewritten with the same text stays out of the frame.
+*/
+
+static void init_lines(window_textgrid_t *dwin, int beg, int end, int linewid);
+static void final_lines(window_textgrid_t *dwin);
+static void export_input_line(void *buf, int unicode, long len, glui32 *chars);
+static void import_input_line(tgline_t *ln, int offset, void *buf,
+    int unicode, long len);
+
+/* This macro sets the appropriate dirty values, when a single character
+    (at px, py) is changed. */
+#define setposdirty(dwn, ll, px, py)   \
+    if (dwn->dirtybeg == -1 || (py) < dwn->dirtybeg)   \
+        dwn->dirtybeg = (py);   \
+    if (dwn->dirtyend == -1 || (py)+1 > dwn->dirtyend)   \
+        dwn->dirtyend = (py)+1;   \
+    if (ll->dirtybeg == -1 || (px) < ll->dirtybeg)   \
+        ll->dirtybeg = (px);   \
+    if (ll->dirtyend == -1 || (px)+1 > ll->dirtyend)   \
+        ll->dirtyend = (px)+1;   \
+
+
+window_textgrid_t *win_textgrid_create(window_t *win)
+{
+    window_textgrid_t *dwin = (window_textgrid_t *)malloc(sizeof(window_textgrid_t));
+    dwin->owner = win;
+
+    dwin->width = 0;
+    dwin->height = 0;
+
+    dwin->curx = 0;
+    dwin->cury = 0;
+
+    dwin->linessize = 0;
+    dwin->lines = NULL;
+    dwin->dirtybeg = -1;
+    dwin->dirtyend = -1;
+    dwin->sentvalid = FALSE;
+
+    dwin->inbuf = NULL;
+    dwin->inunicode = FALSE;
+    dwin->inorgx = 0;
+    dwin->inorgy = 0;
+
+    return dwin;
+}
+
+void win_textgrid_destroy(window_textgrid_t *dwin)
+{
+    if (dwin->inbuf) {
+        if (gli_unregister_arr) {
+            char *typedesc = (dwin->inunicode ? "&+#!Iu" : "&+#!Cn");
+            (*gli_unregister_arr)(dwin->inbuf, dwin->inoriglen, typedesc, dwin->inarrayrock);
+        }
+        dwin->inbuf = NULL;
+    }
+
+    dwin->owner = NULL;
+    if (dwin->lines) {
+        final_lines(dwin);
+    }
+    free(dwin);
+}
+
+void win_textgrid_rearrange(window_t *win, grect_t *box)
+{
+    int ix, jx, oldval;
+    int newwid, newhgt;
+    window_textgrid_t *dwin = win->data;
+    dwin->owner->bbox = *box;
+
+    newwid = box->right - box->left;
+    newhgt = box->bottom - box->top;
+
+    if (dwin->lines == NULL) {
+        dwin->linessize = (newhgt+1);
+        dwin->lines = (tgline_t *)malloc(dwin->linessize * sizeof(tgline_t));
+        if (!dwin->lines)
+            return;
+        init_lines(dwin, 0, dwin->linessize, newwid);
+    }
+    else {
+        if (newhgt > dwin->linessize) {
+            oldval = dwin->linessize;
+            dwin->linessize = (newhgt+1) * 2;
+            dwin->lines = (tgline_t *)realloc(dwin->lines,
+                dwin->linessize * sizeof(tgline_t));
+            if (!dwin->lines)
+                return;
+            init_lines(dwin, oldval, dwin->linessize, newwid);
+        }
+        if (newhgt > dwin->height) {
+            for (jx=dwin->height; jx<newhgt; jx++) {
+                tgline_t *ln = &(dwin->lines[jx]);
+                for (ix=0; ix<ln->size; ix++) {
+                    ln->chars[ix] = ' ';
+                    ln->attrs[ix] = style_Normal;
+                }
+            }
+        }
+        for (jx=0; jx<newhgt; jx++) {
+            tgline_t *ln = &(dwin->lines[jx]);
+            if (newwid > ln->size) {
+                oldval = ln->size;
+                ln->size = (newwid+1) * 2;
+                ln->chars = (glui32 *)realloc(ln->chars,
+                    ln->size * sizeof(glui32));
+                ln->attrs = (unsigned char *)realloc(ln->attrs,
+                    ln->size * sizeof(unsigned char));
+                ln->sentchars = (glui32 *)realloc(ln->sentchars,
+                    ln->size * sizeof(glui32));
+                ln->sentattrs = (unsigned char *)realloc(ln->sentattrs,
+                    ln->size * sizeof(unsigned char));
+                if (!ln->chars || !ln->attrs
+                    || !ln->sentchars || !ln->sentattrs) {
+                    dwin->lines = NULL;
+                    return;
+                }
+                for (ix=oldval; ix<ln->size; ix++) {
+                    ln->chars[ix] = ' ';
+                    ln->attrs[ix] = style_Normal;
+                }
+            }
+        }
+    }
+
+    dwin->width = newwid;
+    dwin->height = newhgt;
+
+    /* The host has to lay the window out again, so send all of it. */
+    for (jx=0; jx<dwin->height; jx++) {
+        tgline_t *ln = &(dwin->lines[jx]);
+        ln->dirtybeg = 0;
+        ln->dirtyend = dwin->width;
+    }
+    dwin->dirtybeg = 0;
+    dwin->dirtyend = dwin->height;
+    dwin->sentvalid = FALSE;
+}
+
+static void init_lines(window_textgrid_t *dwin, int beg, int end, int linewid)
+{
+    int ix, jx;
+
+    for (jx=beg; jx<end; jx++) {
+        tgline_t *ln = &(dwin->lines[jx]);
+        ln->size = (linewid+1);
+        ln->dirtybeg = -1;
+        ln->dirtyend = -1;
+        ln->chars = (glui32 *)malloc(ln->size * sizeof(glui32));
+        ln->attrs = (unsigned char *)malloc(ln->size * sizeof(unsigned char));
+        ln->sentchars = (glui32 *)malloc(ln->size * sizeof(glui32));
+        ln->sentattrs = (unsigned char *)malloc(ln->size * sizeof(unsigned char));
+        if (!ln->chars || !ln->attrs || !ln->sentchars || !ln->sentattrs) {
+            dwin->lines = NULL;
+            return;
+        }
+        for (ix=0; ix<ln->size; ix++) {
+            ln->chars[ix] = ' ';
+            ln->attrs[ix] = style_Normal;
+        }
+    }
+}
+
+static void final_lines(window_textgrid_t *dwin)
+{
+    int jx;
+
+    for (jx=0; jx<dwin->linessize; jx++) {
+        tgline_t *ln = &(dwin->lines[jx]);
+        if (ln->chars) {
+            free(ln->chars);
+            ln->chars = NULL;
+        }
+        if (ln->attrs) {
+            free(ln->attrs);
+            ln->attrs = NULL;
+        }
+        if (ln->sentchars) {
+            free(ln->sentchars);
+            ln->sentchars = NULL;
+        }
+        if (ln->sentattrs) {
+            free(ln->sentattrs);
+            ln->sentattrs = NULL;
+        }
+    }
+
+    free(dwin->lines);
+    dwin->lines = NULL;
+}
+
+/* Add the changed lines to the current frame, as one span per style run,
+    and forget that they changed. A line only counts as changed if it
+    differs from what the last frame reported. If all is true, every line
+    goes in. Returns the number of spans added. */
+int win_textgrid_frame(window_t *win, int all)
+{
+    int ix, jx, beg, count;
+    window_textgrid_t *dwin = win->data;
+
+    if (!dwin->lines)
+        return 0;
+
+    if (all || !dwin->sentvalid) {
+        dwin->dirtybeg = 0;
+        dwin->dirtyend = dwin->height;
+        all = TRUE;
+    }
+    if (dwin->dirtyend > dwin->height) {
+        dwin->dirtyend = dwin->height;
+    }
+
+    if (dwin->dirtybeg == -1)
+        return 0;
+
+    count = 0;
+    for (jx=dwin->dirtybeg; jx<dwin->dirtyend; jx++) {
+        tgline_t *ln = &(dwin->lines[jx]);
+        if (!all) {
+            if (ln->dirtybeg == -1)
+                continue;
+            if (ln->dirtyend > dwin->width)
+                ln->dirtyend = dwin->width;
+            for (ix=ln->dirtybeg; ix<ln->dirtyend; ix++) {
+                if (ln->chars[ix] != ln->sentchars[ix]
+                    || ln->attrs[ix] != ln->sentattrs[ix])
+                    break;
+            }
+            if (ix >= ln->dirtyend) {
+                /* Rewritten with the same text. */
+                ln->dirtybeg = -1;
+                ln->dirtyend = -1;
+                continue;
+            }
+        }
+
+        memcpy(ln->sentchars, ln->chars, dwin->width * sizeof(glui32));
+        memcpy(ln->sentattrs, ln->attrs, dwin->width * sizeof(unsigned char));
+
+        ix = 0;
+        while (ix<dwin->width) {
+            beg = ix;
+            for (ix++; ix<dwin->width && ln->attrs[ix] == ln->attrs[beg]; ix++) { }
+            gli_frame_add_span(jx, ln->attrs[beg], &ln->chars[beg], ix-beg);
+            count++;
+        }
+
+        ln->dirtybeg = -1;
+        ln->dirtyend = -1;
+    }
+
+    dwin->dirtybeg = -1;
+    dwin->dirtyend = -1;
+    dwin->sentvalid = TRUE;
+
+    return count;
+}
+
+void win_textgrid_putchar(window_t *win, glui32 ch)
+{
+    window_textgrid_t *dwin = win->data;
+    tgline_t *ln;
+
+    /* Canonicalize the cursor position. That is, the cursor may have been
+        left outside the window area; wrap it if necessary. */
+    if (dwin->curx < 0)
+        dwin->curx = 0;
+    else if (dwin->curx >= dwin->width) {
+        dwin->curx = 0;
+        dwin->cury++;
+    }
+    if (dwin->cury < 0)
+        dwin->cury = 0;
+    else if (dwin->cury >= dwin->height)
+        return; /* outside the window */
+
+    if (ch == '\n') {
+        /* a newline just moves the cursor. */
+        dwin->cury++;
+        dwin->curx = 0;
+        return;
+    }
+
+    ln = &(dwin->lines[dwin->cury]);
+
+    if (ln->chars[dwin->curx] != ch || ln->attrs[dwin->curx] != win->style) {
+        /* A program which rewrites its status line every turn mostly
+            writes what is already there; those lines stay out of the
+            frame. */
+        setposdirty(dwin, ln, dwin->curx, dwin->cury);
+        ln->chars[dwin->curx] = ch;
+        ln->attrs[dwin->curx] = win->style;
+    }
+
+    dwin->curx++;
+    /* We can leave the cursor outside the window, since it will be
+        canonicalized next time a character is printed. */
+}
+
+void win_textgrid_clear(window_t *win)
+{
+    int ix, jx;
+    window_textgrid_t *dwin = win->data;
+
+    for (jx=0; jx<dwin->height; jx++) {
+        tgline_t *ln = &(dwin->lines[jx]);
+        for (ix=0; ix<dwin->width; ix++) {
+            if (ln->chars[ix] != ' ' || ln->attrs[ix] != style_Normal) {
+                setposdirty(dwin, ln, ix, jx);
+                ln->chars[ix] = ' ';
+                ln->attrs[ix] = style_Normal;
+            }
+        }
+    }
+
+    dwin->curx = 0;
+    dwin->cury = 0;
+}
+
+void win_textgrid_move_cursor(window_t *win, int xpos, int ypos)
+{
+    window_textgrid_t *dwin = win->data;
+
+    /* If the values are negative, they're really huge positive numbers --
+        remember that they were cast from glui32. So set them huge and
+        let canonicalization take its course. */
+    if (xpos < 0)
+        xpos = 32767;
+    if (ypos < 0)
+        ypos = 32767;
+
+    dwin->curx = xpos;
+    dwin->cury = ypos;
+}
+
+/* Prepare the window for line input. */
+void win_textgrid_init_line(window_t *win, void *buf, int unicode,
+    int maxlen, int initlen)
+{
+    window_textgrid_t *dwin = win->data;
+
+    /* Canonicalize the cursor position, so the input field starts
+        somewhere inside the window. */
+    if (dwin->curx < 0 || dwin->curx >= dwin->width) {
+        dwin->curx = 0;
+        dwin->cury++;
+    }
+    if (dwin->cury < 0 || dwin->cury >= dwin->height)
+        dwin->cury = (dwin->height > 0) ? dwin->height-1 : 0;
+
+    dwin->inbuf = buf;
+    dwin->inunicode = unicode;
+    dwin->inoriglen = maxlen;
+    if (maxlen > (dwin->width - dwin->curx))
+        maxlen = (dwin->width - dwin->curx);
+    dwin->inmax = maxlen;
+    dwin->inlen = 0;
+    dwin->inorgx = dwin->curx;
+    dwin->inorgy = dwin->cury;
+    dwin->intermkeys = win->terminate_line_input;
+    dwin->origstyle = win->style;
+    win->style = style_Input;
+
+    if (initlen > maxlen)
+        initlen = maxlen;
+
+    if (initlen) {
+        tgline_t *ln = &(dwin->lines[dwin->inorgy]);
+
+        import_input_line(ln, dwin->inorgx, dwin->inbuf,
+            dwin->inunicode, initlen);
+
+        setposdirty(dwin, ln, dwin->inorgx+0, dwin->inorgy);
+        if (initlen > 1) {
+            setposdirty(dwin, ln, dwin->inorgx+(initlen-1), dwin->inorgy);
+        }
+
+        dwin->inlen += initlen;
+        dwin->curx = dwin->inorgx+dwin->inlen;
+        dwin->cury = dwin->inorgy;
+    }
+
+    if (gli_register_arr) {
+        char *typedesc = (dwin->inunicode ? "&+#!Iu" : "&+#!Cn");
+        dwin->inarrayrock = (*gli_register_arr)(dwin->inbuf, dwin->inoriglen, typedesc);
+    }
+}
+
+/* Finish line input. Whatever is in the input field gets stored; the
+    event, if any, goes in ev. */
+static void finish_line(window_t *win, event_t *ev, glui32 termkey)
+{
+    void *inbuf;
+    int inoriglen, inunicode;
+    gidispatch_rock_t inarrayrock;
+    window_textgrid_t *dwin = win->data;
+    tgline_t *ln = &(dwin->lines[dwin->inorgy]);
+
+    inbuf = dwin->inbuf;
+    inoriglen = dwin->inoriglen;
+    inarrayrock = dwin->inarrayrock;
+    inunicode = dwin->inunicode;
+
+    export_input_line(inbuf, inunicode, dwin->inlen, &ln->chars[dwin->inorgx]);
+
+    if (win->echostr) {
+        if (!inunicode)
+            gli_stream_echo_line(win->echostr, inbuf, dwin->inlen);
+        else
+            gli_stream_echo_line_uni(win->echostr, inbuf, dwin->inlen);
+    }
+
+    dwin->cury = dwin->inorgy+1;
+    dwin->curx = 0;
+    win->style = dwin->origstyle;
+
+    if (ev) {
+        ev->type = evtype_LineInput;
+        ev->win = win;
+        ev->val1 = dwin->inlen;
+        ev->val2 = termkey;
+    }
+    else {
+        gli_event_store(evtype_LineInput, win, dwin->inlen, termkey);
+    }
+
+    win->line_request = FALSE;
+    dwin->inbuf = NULL;
+    dwin->inoriglen = 0;
+    dwin->inmax = 0;
+    dwin->inorgx = 0;
+    dwin->inorgy = 0;
+    dwin->intermkeys = 0;
+
+    if (gli_unregister_arr) {
+        char *typedesc = (inunicode ? "&+#!Iu" : "&+#!Cn");
+        (*gli_unregister_arr)(inbuf, inoriglen, typedesc, inarrayrock);
+    }
+}
+
+/* Abort line input, storing whatever's been typed so far. */
+void win_textgrid_cancel_line(window_t *win, event_t *ev)
+{
+    window_textgrid_t *dwin = win->data;
+
+    if (!dwin->inbuf)
+        return;
+
+    finish_line(win, ev, 0);
+}
+
+/* A line from the input queue. It replaces whatever was in the input
+    field, and ends line input. */
+void win_textgrid_accept_line(window_t *win, glui32 *buf, long len,
+    glui32 termkey)
+{
+    int ix;
+    window_textgrid_t *dwin = win->data;
+    tgline_t *ln;
+
+    if (!dwin->inbuf)
+        return;
+
+    ln = &(dwin->lines[dwin->inorgy]);
+
+    if (len > dwin->inmax)
+        len = dwin->inmax;
+
+    for (ix=0; ix<dwin->inlen || ix<len; ix++) {
+        glui32 ch = (ix < len) ? buf[ix] : ' ';
+        glui32 attr = (ix < len) ? style_Input : style_Normal;
+        if (ln->chars[dwin->inorgx+ix] != ch
+            || ln->attrs[dwin->inorgx+ix] != attr) {
+            setposdirty(dwin, ln, dwin->inorgx+ix, dwin->inorgy);
+            ln->chars[dwin->inorgx+ix] = ch;
+            ln->attrs[dwin->inorgx+ix] = attr;
+        }
+    }
+    dwin->inlen = len;
+
+    finish_line(win, NULL, termkey);
+}
+
+static void import_input_line(tgline_t *ln, int offset, void *buf,
+    int unicode, long len)
+{
+    int ix;
+
+    if (!unicode) {
+        for (ix=0; ix<len; ix++) {
+            unsigned char ch = ((unsigned char *)buf)[ix];
+            ln->attrs[offset+ix] = style_Input;
+            ln->chars[offset+ix] = ch;
+        }
+    }
+    else {
+        for (ix=0; ix<len; ix++) {
+            ln->attrs[offset+ix] = style_Input;
+            ln->chars[offset+ix] = ((glui32 *)buf)[ix];
+        }
+    }
+}
+
+/* Clone in mgw_buf.c */
+static void export_input_line(void *buf, int unicode, long len, glui32 *chars)
+{
+    int ix;
+
+    if (!unicode) {
+        for (ix=0; ix<len; ix++) {
+            glui32 kval = chars[ix];
+            if (!(kval >= 0 && kval < 256))
+                kval = '?';
+            ((unsigned char *)buf)[ix] = kval;
+        }
+    }
+    else {
+        for (ix=0; ix<len; ix++) {
+            ((glui32 *)buf)[ix] = chars[ix];
+        }
+    }
+}
@@ -0,0 +1,52 @@
+/* mgw_grid.h: The grid window header
+        for MemGlk, in-memory implementation of the Glk API.
+    Designed by Andrew Plotkin <erkyrath@eblong.com>
+    http://www.eblong.com/zarf/glk/index.html
+*/
+
+/* One line of the window. */
+typedef struct tgline_struct {
+    int size; /* this is the allocated size; only width is valid */
+    glui32 *chars;
+    unsigned char *attrs;
+    glui32 *sentchars; /* what the last frame reported; same size as chars */
+    unsigned char *sentattrs;
+    int dirtybeg, dirtyend; /* characters [dirtybeg, dirtyend) have changed
+        since the last frame */
+} tgline_t;
+
+typedef struct window_textgrid_struct {
+    window_t *owner;
+    
+    int width, height;
+    tgline_t *lines;
+    int linessize; /* this is the allocated size of the lines array;
+        only the first height entries are valid. */
+    
+    int curx, cury; /* the window cursor position */
+    
+    int dirtybeg, dirtyend; /* lines [dirtybeg, dirtyend) may go in the
+        next frame */
+    int sentvalid; /* the sent arrays match what the host has */
+    
+    /* for line input */
+    void *inbuf; /* char* or glui32*, depending on inunicode. */
+    int inunicode;
+    int inorgx, inorgy;
+    glui32 intermkeys;
+    int inoriglen, inmax;
+    int inlen;
+    glui32 origstyle;
+    gidispatch_rock_t inarrayrock;
+} window_textgrid_t;
+
+extern window_textgrid_t *win_textgrid_create(window_t *win);
+extern void win_textgrid_destroy(window_textgrid_t *dwin);
+extern void win_textgrid_rearrange(window_t *win, grect_t *box);
+extern void win_textgrid_putchar(window_t *win, glui32 ch);
+extern void win_textgrid_clear(window_t *win);
+extern void win_textgrid_move_cursor(window_t *win, int xpos, int ypos);
+extern void win_textgrid_init_line(window_t *win, void *buf, int unicode, int maxlen, int initlen);
+extern void win_textgrid_cancel_line(window_t *win, event_t *ev);
+extern void win_textgrid_accept_line(window_t *win, glui32 *buf, long len, glui32 termkey);
+extern int win_textgrid_frame(window_t *win, int all);
@@ -1,8 +1,10 @@
 #include <string.h>
 
+#include "coverage.h"
 #include "glk.h"
 #include "load_TI99_4a.h"
 #include "scott.h"
+#include "speculate.h"
 #include "TI99_4a_terp.h"
 
 static ActionResultType PerformTI99Line(const uint8_t *action_line)
@@ -18,18 +20,22 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 
     int try_index;
     int try[32];
+    int line = Coverage != NULL ? TI99CoverageLine(action_line) : 0;
 
     try_index = 0;
+    CoverLine(line);
 
     while (run_code == 0) {
         opcode = *(ptr++);
+        if (opcode < TI99_FIRST_CONDITION || opcode > TI99_LAST_CONDITION)
+            CoverCommand(line, opcode == 255 ? NOT_A_COMMAND : opcode);
 
         switch (opcode) {
         case 183: /* is p in inventory? */
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Does the player carry %s?\n", Items[*ptr].Text);
 #endif
-            if (Items[*(ptr++)].Location != CARRIED) {
+            if (ItemLocations[*(ptr++)] != CARRIED) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -39,7 +45,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s in location?\n", Items[*ptr].Text);
 #endif
-            if (Items[*(ptr++)].Location != MyLoc) {
+            if (ItemLocations[*(ptr++)] != MyLoc) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -50,7 +56,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s held or in location?\n", Items[*ptr].Text);
 #endif
-            if (Items[*ptr].Location != CARRIED && Items[*ptr].Location != MyLoc) {
+            if (ItemLocations[*ptr] != CARRIED && ItemLocations[*ptr] != MyLoc) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -61,7 +67,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s NOT in location?\n", Items[*ptr].Text);
 #endif
-            if (Items[*(ptr++)].Location == MyLoc) {
+            if (ItemLocations[*(ptr++)] == MyLoc) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -71,7 +77,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Does the player NOT carry %s?\n", Items[*ptr].Text);
 #endif
-            if (Items[*(ptr++)].Location == CARRIED) {
+            if (ItemLocations[*(ptr++)] == CARRIED) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -82,7 +88,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
             fprintf(stderr, "Is %s neither carried nor in room?\n", Items[*ptr].Text);
 #endif
 
-            if (Items[*ptr].Location == CARRIED || Items[*ptr].Location == MyLoc) {
+            if (ItemLocations[*ptr] == CARRIED || ItemLocations[*ptr] == MyLoc) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -93,7 +99,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s (%d) in play?\n", Items[*ptr].Text, dv);
 #endif
-            if (Items[*(ptr++)].Location == 0) {
+            if (ItemLocations[*(ptr++)] == 0) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -103,7 +109,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s NOT in play?\n", Items[*ptr].Text);
 #endif
-            if (Items[*(ptr++)].Location != 0) {
+            if (ItemLocations[*(ptr++)] != 0) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -203,7 +209,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s still in initial room?\n", Items[*ptr].Text);
 #endif
-            if (Items[*ptr].Location != Items[*ptr].InitialLoc) {
+            if (ItemLocations[*ptr] != InitialLocations[*ptr]) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -214,7 +220,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Has %s been moved?\n", Items[*ptr].Text);
 #endif
-            if (Items[*ptr].Location == Items[*ptr].InitialLoc) {
+            if (ItemLocations[*ptr] == InitialLocations[*ptr]) {
                 run_code = 1;
                 result = ACT_FAILURE;
             }
@@ -222,7 +228,8 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
             break;
 
         case 212: /* clear screen */
-            glk_window_clear(Bottom);
+            if (!Speculating)
+                glk_window_clear(Bottom);
             break;
 
         case 214: /* inv */
@@ -252,7 +259,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
                 result = ACT_FAILURE;
                 break;
             } else {
-                Items[*ptr].Location = CARRIED;
+                MoveItem(*ptr, CARRIED);
             }
             ptr++;
             break;
@@ -262,7 +269,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
             fprintf(stderr, "item %d (\"%s\") is now in location.\n", *ptr,
                 Items[*ptr].Text);
 #endif
-            Items[*(ptr++)].Location = MyLoc;
+            MoveItem(*(ptr++), MyLoc);
             should_look_in_transcript = 1;
             break;
 
@@ -282,7 +289,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
                 "Item %d (%s) is removed from the game (put in room 0).\n",
                     *ptr, Items[*ptr].Text);
 #endif
-            Items[*(ptr++)].Location = 0;
+            MoveItem(*(ptr++), 0);
             break;
 
         case 223: /* darkness */
@@ -352,7 +359,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
 
         case 234: /* refill lightsource */
             GameHeader.LightTime = LightRefill;
-            Items[LIGHT_SOURCE].Location = CARRIED;
+            MoveItem(LIGHT_SOURCE, CARRIED);
             BitFlags &= ~(1 << LIGHTOUTBIT);
             break;
 
@@ -372,7 +379,7 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
                 "Player now carries item %d (%s).\n",
                     *ptr, Items[*ptr].Text);
 #endif
-            Items[*(ptr++)].Location = CARRIED;
+            MoveItem(*(ptr++), CARRIED);
             break;
 
         case 238: /* make item p same room as item p2 */
@@ -474,6 +481,13 @@ static ActionResultType PerformTI99Line(const uint8_t *action_line)
             break;
         }
 
+        if (opcode >= TI99_FIRST_CONDITION && opcode <= TI99_LAST_CONDITION) {
+            if (run_code)
+                CoverFailure(line, opcode - TI99_FIRST_CONDITION);
+            else
+                CoverCondition(line, opcode - TI99_FIRST_CONDITION);
+        }
+
         /* we are on the 0xff opcode, or have fallen through */
         if (run_code == 1 && try_index > 0) {
             if (opcode == 0xff) {
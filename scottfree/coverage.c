@@ -0,0 +1,280 @@
+//
+//  coverage.c
+//  scott
+//
+//  Records which action lines of the game have been tried and which have
+//  run, which types of condition passed and failed on each line, and
+//  which commands were carried out, to show how much of a game a set of
+//  walkthroughs plays. While the game runs this costs a few bits set per
+//  line tried.
+//
+//  When the process exits, what it recorded is merged into a coverage
+//  file, which holds the same for every run before it. The file is
+//  locked while it is merged, so any number of games and hosted sessions
+//  can share one. It is text, one line for each action line of the game,
+//  and doubles as the report: grep it for "unreached" or "tested" to see
+//  the lines that never ran.
+//
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "coverage.h"
+#include "load_TI99_4a.h"
+#include "scott.h"
+
+LineCoverage *Coverage = NULL;
+uint32_t CommandsRun[8];
+
+static char *coverage_file = NULL;
+static char game_line[300];
+static int number_of_lines = 0;
+
+/* The verb and noun of each TI-99/4A action line, packed like the Vocab
+   of other games, and the line starting at each offset of the action
+   code, the implicit actions first */
+static uint32_t *ti99_vocab = NULL;
+static int *ti99_lines = NULL;
+
+static const char *state_names[] = { "unreached", "tested", "run", "run" };
+
+int TI99CoverageLine(const uint8_t *action_line)
+{
+    if (action_line >= ti99_implicit_actions && action_line < ti99_implicit_actions + ti99_implicit_extent + 2)
+        return ti99_lines[action_line - ti99_implicit_actions];
+    return ti99_lines[ti99_implicit_extent + 2 + (action_line - ti99_explicit_actions)];
+}
+
+/* Walks the action code the same way the interpreter does, numbering
+   the lines in the order they are found */
+static void FindTI99Lines(void)
+{
+    size_t size = ti99_implicit_extent + ti99_explicit_extent + 4;
+    uint8_t *ptr;
+    int line = 0;
+
+    ti99_lines = MemAlloc((int)(size * sizeof(int)));
+    ti99_vocab = MemAlloc((int)(size * sizeof(uint32_t)));
+    memset(ti99_lines, 0, size * sizeof(int));
+
+    ptr = ti99_implicit_actions;
+    while (ptr != NULL && *ptr != 0) {
+        ti99_lines[ptr + 2 - ti99_implicit_actions] = line;
+        ti99_vocab[line++] = ptr[0];
+        if (ptr[1] == 0 || ptr - ti99_implicit_actions >= ti99_implicit_extent)
+            break;
+        ptr += 1 + ptr[1];
+    }
+
+    for (int verb = 0; verb <= ti99_num_verbs; verb++) {
+        ptr = VerbActionOffsets[verb];
+        while (ptr != NULL) {
+            ti99_lines[ti99_implicit_extent + 2 + (ptr + 2 - ti99_explicit_actions)] = line;
+            ti99_vocab[line++] = verb * 150 + ptr[0];
+            if (ptr[1] == 0)
+                break;
+            ptr += 1 + ptr[1];
+        }
+    }
+    number_of_lines = line;
+}
+
+static int LineVocab(int line)
+{
+    if (CurrentGame == TI994A)
+        return ti99_vocab[line];
+    return ActionVocab(line);
+}
+
+static void WriteConditions(FILE *f, uint32_t bits)
+{
+    int base = CurrentGame == TI994A ? TI99_FIRST_CONDITION : 0;
+
+    /* Type 0 of other games only passes a parameter to the commands */
+    if (CurrentGame != TI994A)
+        bits &= ~1u;
+    if (bits == 0)
+        fprintf(f, " -");
+    for (int type = 0; type < 32; type++)
+        if (bits & (1u << type))
+            fprintf(f, " %d", base + type);
+}
+
+static void WriteCoverage(FILE *f, int runs)
+{
+    int run = 0, tested = 0;
+    uint32_t used[8] = { 0 };
+
+    for (int i = 0; i < number_of_lines; i++) {
+        if (Coverage[i].flags & LINE_RAN)
+            run++;
+        else if (Coverage[i].flags & LINE_REACHED)
+            tested++;
+    }
+
+    fprintf(f, "# Action line coverage\n%s\nruns %d\ncommands", game_line, runs);
+    for (int i = 0; i < 256; i++)
+        if (CommandsRun[i >> 5] & (1u << (i & 31)))
+            fprintf(f, " %d", i);
+    fprintf(f, "\n# %d of %d lines run, %d more tested but never run, %d never reached\n",
+        run, number_of_lines, tested, number_of_lines - run - tested);
+
+    /* The commands other games use are easy to find */
+    if (CurrentGame != TI994A) {
+        for (int i = 0; i < number_of_lines; i++)
+            for (int j = 0; j < 2; j++) {
+                int command = ActionSubcommand(i, j);
+                used[(command / 150) >> 5] |= 1u << ((command / 150) & 31);
+                used[(command % 150) >> 5] |= 1u << ((command % 150) & 31);
+            }
+        used[0] &= ~1u;
+        fprintf(f, "# commands of the game that never ran:");
+        for (int i = 0; i < 256; i++)
+            if ((used[i >> 5] & ~CommandsRun[i >> 5]) & (1u << (i & 31)))
+                fprintf(f, " %d", i);
+        fprintf(f, "\n");
+    }
+
+    for (int i = 0; i < number_of_lines; i++) {
+        int verb = LineVocab(i) / 150, noun = LineVocab(i) % 150;
+        fprintf(f, "line %d %s passed", i, state_names[Coverage[i].flags & 3]);
+        WriteConditions(f, Coverage[i].passed);
+        fprintf(f, " failed");
+        WriteConditions(f, Coverage[i].failed);
+        if (verb == 0)
+            fprintf(f, " # auto %d%%\n", noun);
+        else if (noun == 0)
+            fprintf(f, " # %s\n", Verbs[verb]);
+        else
+            fprintf(f, " # %s %s\n", Verbs[verb], Nouns[noun]);
+    }
+}
+
+/* Adds the coverage in f to what this process recorded, and returns the
+   number of runs it came from, or -1 if it is not the coverage of this
+   game */
+static int ReadCoverage(FILE *f)
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+    int runs = 0, seen_game = 0;
+
+    while ((length = getline(&line, &size, f)) > 0) {
+        char *word, *rest;
+        uint32_t *bits = NULL;
+        int number = -1, base = CurrentGame == TI994A ? TI99_FIRST_CONDITION : 0;
+
+        if (line[length - 1] == '\n')
+            line[--length] = 0;
+        if (line[0] == '#')
+            continue;
+        if (strncmp(line, "game ", 5) == 0) {
+            if (strcmp(line, game_line) != 0)
+                break;
+            seen_game = 1;
+            continue;
+        }
+        if (!seen_game)
+            break;
+
+        word = strtok_r(line, " ", &rest);
+        if (word == NULL)
+            continue;
+        if (strcmp(word, "runs") == 0) {
+            runs = atoi(rest);
+        } else if (strcmp(word, "commands") == 0) {
+            while ((word = strtok_r(NULL, " ", &rest)) != NULL) {
+                number = atoi(word);
+                if (number >= 0 && number < 256)
+                    CommandsRun[number >> 5] |= 1u << (number & 31);
+            }
+        } else if (strcmp(word, "line") == 0) {
+            LineCoverage *c;
+            word = strtok_r(NULL, " ", &rest);
+            number = word ? atoi(word) : -1;
+            if (number < 0 || number >= number_of_lines)
+                continue;
+            c = &Coverage[number];
+            while ((word = strtok_r(NULL, " ", &rest)) != NULL && word[0] != '#') {
+                if (strcmp(word, "run") == 0)
+                    c->flags |= LINE_REACHED | LINE_RAN;
+                else if (strcmp(word, "tested") == 0)
+                    c->flags |= LINE_REACHED;
+                else if (strcmp(word, "passed") == 0)
+                    bits = &c->passed;
+                else if (strcmp(word, "failed") == 0)
+                    bits = &c->failed;
+                else if (bits != NULL && word[0] != '-' && atoi(word) - base >= 0 && atoi(word) - base < 32)
+                    *bits |= 1u << (atoi(word) - base);
+            }
+        }
+    }
+    free(line);
+    if (!seen_game && !feof(f))
+        return -1;
+    return runs;
+}
+
+static void MergeCoverage(void)
+{
+    int fd, runs, i;
+    FILE *f;
+
+    /* The session host itself plays nothing */
+    for (i = 0; i < number_of_lines; i++)
+        if (Coverage[i].flags)
+            break;
+    if (i == number_of_lines)
+        return;
+
+    fd = open(coverage_file, O_RDWR | O_CREAT, 0666);
+    if (fd == -1 || flock(fd, LOCK_EX) == -1 || (f = fdopen(fd, "r+")) == NULL) {
+        fprintf(stderr, "%s: %s\n", coverage_file, strerror(errno));
+        if (fd != -1)
+            close(fd);
+        return;
+    }
+    runs = ReadCoverage(f);
+    if (runs == -1) {
+        fprintf(stderr, "%s is the coverage of another game\n", coverage_file);
+    } else {
+        rewind(f);
+        WriteCoverage(f, runs + 1);
+        fflush(f);
+        if (ftruncate(fd, ftell(f)) == -1 || ferror(f))
+            fprintf(stderr, "%s: %s\n", coverage_file, strerror(errno));
+    }
+    fclose(f);
+}
+
+/* Given a directory, each game has a file of its own there */
+void StartCoverage(const char *path, const char *game_name)
+{
+    struct stat st;
+    size_t size = strlen(path) + strlen(game_name) + 11;
+
+    coverage_file = MemAlloc((int)size);
+    if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+        snprintf(coverage_file, size, "%s/%s.coverage", path, game_name);
+    else
+        snprintf(coverage_file, size, "%s", path);
+
+    if (CurrentGame == TI994A)
+        FindTI99Lines();
+    else
+        number_of_lines = GameHeader.NumActions + 1;
+    if (number_of_lines == 0)
+        return;
+    snprintf(game_line, sizeof(game_line), "game %s %d", game_name, number_of_lines);
+
+    Coverage = MemAlloc(number_of_lines * (int)sizeof(LineCoverage));
+    memset(Coverage, 0, number_of_lines * sizeof(LineCoverage));
+    atexit(MergeCoverage);
+}
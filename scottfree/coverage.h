@@ -0,0 +1,68 @@
+//
+//  coverage.h
+//  scott
+//
+
+#ifndef coverage_h
+#define coverage_h
+
+#include <stdint.h>
+
+#include "definitions.h"
+
+#define LINE_REACHED 1
+#define LINE_RAN 2
+
+/* The condition opcodes of TI-99/4A action lines, which are recorded as
+   bits counting from the first */
+#define TI99_FIRST_CONDITION 183
+#define TI99_LAST_CONDITION 201
+
+typedef struct {
+    uint8_t flags;
+    uint32_t passed; /* condition types, as bits */
+    uint32_t failed;
+} LineCoverage;
+
+/* One for each action line, or NULL when nothing is recorded */
+extern LineCoverage *Coverage;
+extern uint32_t CommandsRun[8];
+
+static inline void CoverLine(int line)
+{
+    if (Coverage != NULL)
+        Coverage[line].flags |= LINE_REACHED;
+}
+
+static inline void CoverCondition(int line, int type)
+{
+    if (Coverage != NULL)
+        Coverage[line].passed |= 1u << type;
+}
+
+/* Returns ACT_FAILURE, so that a failed condition can be noted as it
+   returns */
+static inline ActionResultType CoverFailure(int line, int type)
+{
+    if (Coverage != NULL)
+        Coverage[line].failed |= 1u << type;
+    return ACT_FAILURE;
+}
+
+/* For the opcodes that only pad out or end a line: the line has run,
+   but no command */
+#define NOT_A_COMMAND -1
+
+static inline void CoverCommand(int line, int command)
+{
+    if (Coverage != NULL) {
+        Coverage[line].flags |= LINE_RAN;
+        if (command != NOT_A_COMMAND)
+            CommandsRun[command >> 5] |= 1u << (command & 31);
+    }
+}
+
+void StartCoverage(const char *path, const char *game_name);
+int TI99CoverageLine(const uint8_t *action_line);
+
+#endif /* coverage_h */
@@ -124,24 +124,28 @@ GameIDType DetectGame(const char *file_name)
 
     file_length = GetFileLength(f);
 
-    if (file_length > MAX_GAMEFILE_SIZE) {
-        fprintf(stderr, "File too large to be a vaild game file (%zu, max is %d)\n", file_length, MAX_GAMEFILE_SIZE);
-        return 0;
-    }
-
     Game = (struct GameInfo *)MemAlloc(sizeof(struct GameInfo));
 
-    // Check if the original ScottFree LoadDatabase() function can read the file.
-    CurrentGame = LoadDatabase(f, Options & DEBUGGING);
-
-    if (!CurrentGame) {
-        entire_file = MemAlloc(file_length);
-        fseek(f, 0, SEEK_SET);
-        size_t result = fread(entire_file, 1, file_length, f);
-        fclose(f);
-        if (result == 0)
-            Fatal("File empty or read error!");
+    entire_file = MemAlloc(file_length + 1);
+    size_t result = fread(entire_file, 1, file_length, f);
+    fclose(f);
+    if (result == 0)
+        Fatal("File empty or read error!");
+    file_length = result;
 
+    // Check if the original ScottFree LoadDatabase() function can read the file.
+    CurrentGame = LoadDatabase(entire_file, file_length, Options & DEBUGGING);
+
+    if (CurrentGame) {
+        free(entire_file);
+        entire_file = NULL;
+    } else {
+        /* Text databases can be any size, but nothing larger than this
+           is a TI-99/4A game */
+        if (file_length > MAX_GAMEFILE_SIZE) {
+            fprintf(stderr, "File too large to be a vaild game file (%zu, max is %d)\n", file_length, MAX_GAMEFILE_SIZE);
+            return 0;
+        }
         CurrentGame = DetectTI994A();
     }
 
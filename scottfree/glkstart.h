@@ -62,6 +62,17 @@ extern int glkunix_startup_code(glkunix_startup_t *data);
 extern strid_t glkunix_stream_open_pathname(char *pathname, glui32 textmode, 
   glui32 rock);
 
+/* Provided by GlkTerm and MemGlk: the timer is called after every screen
+   update, with the time it took on the monotonic clock. Other libraries
+   don't have it, so it is only a weak reference, which is NULL when the
+   library leaves it out. */
+extern void glkunix_set_update_timer(
+  void (*timer)(void *rock, long long nanoseconds), void *rock)
+#ifdef __GNUC__
+  __attribute__((__weak__))
+#endif
+  ;
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,371 @@
+//
+//  journal.c
+//  scott
+//
+//  Keeps a session that crashes or is killed from losing the game. Every
+//  line and key the player types is added to a journal file as it is
+//  read, together with the random seed, and every so often the whole
+//  state of the game is written to a checkpoint file next to it. When the
+//  game is started again with the same journal, it loads the checkpoint
+//  and runs the commands typed since then through the game once more,
+//  without showing their output, so coming back takes no longer than the
+//  commands between two checkpoints.
+//
+//  The journal is flushed after every record, so a killed process loses
+//  nothing, and synced to disk in batches and at every checkpoint.
+//
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "journal.h"
+#include "latency.h"
+#include "parser.h"
+#include "restorestate.h"
+#include "scott.h"
+#include "utf8.h"
+
+/* Commands between checkpoints */
+#define CHECKPOINT_INTERVAL 50
+/* Records between syncs */
+#define SYNC_INTERVAL 16
+
+int Replaying = 0;
+
+static FILE *journal = NULL;
+static char *journal_name = NULL;
+static char *checkpoint_name = NULL;
+
+static int commands_since_checkpoint = 0;
+static int records_since_sync = 0;
+static int checkpoint_wanted = 1;
+
+/* The checkpoint to carry on from, read up to the saved states, and the
+   seed that was used from there on */
+static FILE *checkpoint = NULL;
+static unsigned int checkpoint_seed = 0;
+
+/* The records written since the checkpoint, to be replayed */
+static char *replay = NULL;
+static size_t replay_pos = 0;
+static size_t replay_length = 0;
+static int replayed = 0;
+static double replay_start;
+
+static char *NameWithSuffix(const char *name, const char *suffix)
+{
+    size_t size = strlen(name) + strlen(suffix) + 1;
+    char *result = MemAlloc((int)size);
+    snprintf(result, size, "%s%s", name, suffix);
+    return result;
+}
+
+/* Reads the checkpoint header and the journal after it, and cuts off a
+   last record that was only partly written. Returns the offset in the
+   journal where new records go. */
+static long ReadJournal(void)
+{
+    int64_t offset = 0;
+    long length;
+    FILE *f;
+
+    checkpoint = fopen(checkpoint_name, "rb");
+    if (checkpoint != NULL) {
+        uint32_t seed;
+        if (fread(&offset, sizeof(offset), 1, checkpoint) != 1
+            || fread(&seed, sizeof(seed), 1, checkpoint) != 1 || offset < 0)
+            Fatal("Journal checkpoint is damaged");
+        checkpoint_seed = seed;
+    }
+
+    f = fopen(journal_name, "rb");
+    if (f == NULL)
+        return 0;
+    fseek(f, 0, SEEK_END);
+    length = ftell(f);
+    if (length > offset) {
+        replay_length = length - offset;
+        replay = MemAlloc((int)replay_length + 1);
+        fseek(f, (long)offset, SEEK_SET);
+        replay_length = fread(replay, 1, replay_length, f);
+        while (replay_length > 0 && replay[replay_length - 1] != '\n')
+            replay_length--;
+        replay[replay_length] = 0;
+    }
+    fclose(f);
+
+    if (length > offset + (long)replay_length) {
+        length = (long)offset + (long)replay_length;
+        if (truncate(journal_name, length) == -1)
+            fprintf(stderr, "%s: %s\n", journal_name, strerror(errno));
+    }
+    return length;
+}
+
+/* Returns 1 if the game carries on from a checkpoint, and so should skip
+   its introduction */
+int OpenJournal(const char *path)
+{
+    long length;
+
+    journal_name = NameWithSuffix(path, "");
+    checkpoint_name = NameWithSuffix(path, ".checkpoint");
+
+    length = ReadJournal();
+    Replaying = (replay_length > 0);
+    /* The checkpoints come where they did before, so that the game goes
+       on with the same random numbers as it would have */
+    checkpoint_wanted = (checkpoint == NULL);
+    replay_start = Milliseconds();
+
+    journal = fopen(journal_name, length ? "ab" : "wb");
+    if (journal == NULL) {
+        fprintf(stderr, "%s: %s\n", journal_name, strerror(errno));
+        Fatal("Cannot open journal");
+    }
+    return checkpoint != NULL;
+}
+
+static void WriteRecord(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(journal, fmt, ap);
+    va_end(ap);
+    fflush(journal);
+
+    if (++records_since_sync == SYNC_INTERVAL) {
+        fsync(fileno(journal));
+        records_since_sync = 0;
+    }
+}
+
+/* The seed to start the random numbers from: the one the session had
+   when recovering it, otherwise the given one, which is recorded */
+unsigned int JournalSeed(unsigned int seed)
+{
+    if (journal == NULL)
+        return seed;
+    if (checkpoint != NULL)
+        return checkpoint_seed;
+    if (Replaying) {
+        unsigned int recorded;
+        if (sscanf(replay, "S %u", &recorded) != 1) {
+            fprintf(stderr, "%s: damaged\n", journal_name);
+            Fatal("Journal is damaged");
+        }
+        replay_pos = strchr(replay, '\n') - replay + 1;
+        return recorded;
+    }
+    WriteRecord("S %u\n", seed);
+    return seed;
+}
+
+void RecoverCheckpoint(void)
+{
+    if (checkpoint == NULL)
+        return;
+    if (!ReadSession(checkpoint, NULL)) {
+        fprintf(stderr, "%s: damaged\n", checkpoint_name);
+        Fatal("Journal checkpoint is damaged");
+    }
+    fclose(checkpoint);
+    checkpoint = NULL;
+}
+
+static void EndReplay(void)
+{
+    fprintf(stderr, "Journal: replayed %d commands in %.3f ms\n", replayed,
+        Milliseconds() - replay_start);
+    Replaying = 0;
+    free(replay);
+    replay = NULL;
+    replay_pos = replay_length = 0;
+}
+
+/* The seeds written at checkpoints are picked up at the prompt, where
+   they were written */
+static void ReplaySeeds(void)
+{
+    unsigned int seed;
+    while (replay_pos < replay_length && sscanf(replay + replay_pos, "S %u", &seed) == 1) {
+        srand(seed);
+        replay_pos = strchr(replay + replay_pos, '\n') - replay + 1;
+    }
+}
+
+/* Returns the next record, which should be of the given kind, or NULL
+   once the replay is over */
+static const char *NextRecord(char kind)
+{
+    char *record, *end;
+
+    if (!Replaying)
+        return NULL;
+    ReplaySeeds();
+    if (replay_pos == replay_length) {
+        EndReplay();
+        return NULL;
+    }
+
+    record = replay + replay_pos;
+    end = strchr(record, '\n');
+    *end = 0;
+    replay_pos = end - replay + 1;
+    if (record[0] == kind && record[1] == ' ')
+        return record + 2;
+
+    /* The game has taken a different turn from the one journaled */
+    fprintf(stderr, "Journal: unexpected record \"%s\"\n", record);
+    EndReplay();
+    return NULL;
+}
+
+int ReplayLine(glui32 *buf, glui32 *length)
+{
+    const char *text = NextRecord('L'), *end;
+    glui32 len = 0;
+
+    if (text == NULL)
+        return 0;
+
+    end = text + strlen(text);
+    while (text < end && len < 511)
+        buf[len++] = DecodeUtf8(&text, end);
+    buf[len] = 0;
+    *length = len;
+    replayed++;
+    commands_since_checkpoint++;
+    return 1;
+}
+
+int ReplayChar(glui32 *ch)
+{
+    const char *text = NextRecord('C');
+    if (text == NULL)
+        return 0;
+    *ch = (glui32)strtoul(text, NULL, 10);
+    return 1;
+}
+
+/* Called at the command prompt. Once everything has been replayed, the
+   player is shown where the game has got to. */
+void FinishReplay(void)
+{
+    if (!Replaying)
+        return;
+    ReplaySeeds();
+    if (replay_pos < replay_length)
+        return;
+    EndReplay();
+    Look();
+}
+
+void JournalLine(const glui32 *buf, glui32 length)
+{
+    char text[512 * UTF8_MAX + 1];
+    int len = 0;
+
+    if (journal == NULL || Replaying)
+        return;
+
+    for (glui32 i = 0; i < length; i++)
+        len += EncodeUtf8(buf[i], text + len);
+    text[len] = 0;
+
+    WriteRecord("L %s\n", text);
+    commands_since_checkpoint++;
+}
+
+void JournalChar(glui32 ch)
+{
+    if (journal != NULL && !Replaying)
+        WriteRecord("C %u\n", ch);
+}
+
+/* After something that can't be replayed, such as a restore from a file */
+void CheckpointSoon(void)
+{
+    checkpoint_wanted = 1;
+}
+
+/* Called at the command prompt, when nothing is queued. The random
+   numbers are reseeded, and the seed recorded, so that they can be
+   picked up from here. */
+void JournalCheckpoint(void)
+{
+    char *newname;
+    double start;
+    unsigned int seed;
+    int64_t offset;
+    uint32_t seed32;
+    long size;
+    FILE *f;
+
+    if (journal == NULL || Replaying
+        || (!checkpoint_wanted && commands_since_checkpoint < CHECKPOINT_INTERVAL))
+        return;
+
+    start = Milliseconds();
+    seed = (unsigned int)rand();
+    srand(seed);
+    WriteRecord("S %u\n", seed);
+    fsync(fileno(journal));
+    records_since_sync = 0;
+    offset = ftell(journal);
+    seed32 = seed;
+
+    /* Written beside the old one and renamed, so that there is always one
+       whole checkpoint */
+    newname = NameWithSuffix(checkpoint_name, ".new");
+    f = fopen(newname, "wb");
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", newname, strerror(errno));
+        free(newname);
+        return;
+    }
+    fwrite(&offset, sizeof(offset), 1, f);
+    fwrite(&seed32, sizeof(seed32), 1, f);
+    WriteSession(f, 0);
+    size = ftell(f);
+    if (ferror(f) | fflush(f) | fsync(fileno(f)) | fclose(f)
+        || rename(newname, checkpoint_name) == -1) {
+        fprintf(stderr, "%s: %s\n", newname, strerror(errno));
+        unlink(newname);
+        free(newname);
+        return;
+    }
+    free(newname);
+
+    commands_since_checkpoint = 0;
+    checkpoint_wanted = 0;
+    if (Options & DEBUGGING)
+        fprintf(stderr, "Journal: checkpoint of %ld bytes in %.3f ms\n", size,
+            Milliseconds() - start);
+}
+
+/* Whatever else stops the game, the journal is kept to carry on from */
+void CloseJournal(void)
+{
+    if (journal == NULL)
+        return;
+    fclose(journal);
+    journal = NULL;
+}
+
+/* When the game ends normally there is nothing to recover */
+void DeleteJournal(void)
+{
+    if (journal == NULL)
+        return;
+    CloseJournal();
+    unlink(journal_name);
+    unlink(checkpoint_name);
+}
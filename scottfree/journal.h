@@ -0,0 +1,26 @@
+//
+//  journal.h
+//  scott
+//
+
+#ifndef journal_h
+#define journal_h
+
+#include "glk.h"
+
+extern int Replaying;
+
+int OpenJournal(const char *path);
+unsigned int JournalSeed(unsigned int seed);
+void RecoverCheckpoint(void);
+int ReplayLine(glui32 *buf, glui32 *length);
+int ReplayChar(glui32 *ch);
+void FinishReplay(void);
+void JournalLine(const glui32 *buf, glui32 length);
+void JournalChar(glui32 ch);
+void CheckpointSoon(void);
+void JournalCheckpoint(void);
+void CloseJournal(void);
+void DeleteJournal(void);
+
+#endif /* journal_h */
@@ -0,0 +1,677 @@
+//
+//  jsonapi.c
+//  scott
+//
+//  A protocol for programs that play the game, such as bots, test
+//  harnesses and web front ends, so that they don't have to pretend to be
+//  a terminal. Every request is one line of JSON:
+//
+//    {"id": 7, "commands": ["get lamp", "n", "score"]}
+//
+//  "command" may be given instead of "commands" for a single one. The
+//  "id" is optional, and may be a string, a number or null; it is sent
+//  back as it came in the answer to that request. All the commands of
+//  a request are handed to MemGlk at once, and the game runs them one
+//  after the other without waiting for the client. The answer is one
+//  line of JSON too, with the text each command wrote to the main window,
+//  what the upper window shows, the score and a hash of the game state:
+//
+//    {"id": 7, "turns": [{"command": "get lamp", "text": "..."}, ...],
+//     "room": "...", "location": 12, "score": {"stored": 1,
+//     "treasures": 13, "percent": 7}, "hash": "5cf1c3e12f0d0c2a",
+//     "waiting": "line"}
+//
+//  "waiting" is what the game wants next: a "line", a "key" (which the
+//  first letter of a command gives it) or a "file" name, with "prompt"
+//  saying what for. The first answer, with the introduction, is sent
+//  before any request, and the last one has "exiting": true. A request
+//  with no commands is answered with the state as it is, and one that
+//  can't be read with an "error".
+//
+//  "whatif", a line or an array of lines, asks what commands would do.
+//  Each is tried from the state before the commands of the request and
+//  taken back, and the answer gets
+//
+//    "whatif": [{"command": "get lamp", "text": "O.K.\n", "ended": "line",
+//     "changes": {"items": [[9, 1, 255]]}, "hash": "8ef78562d2d71f36"}]
+//
+//  "ended" is "line" when the game came back for the next command, "key"
+//  or "file" where it stopped to wait for one, and "untried" for the
+//  commands about the game itself, such as undo. The "changes" are the
+//  ones of "items", "flags", "counters" and "roomsaved" as [index, from,
+//  to], and of "location", "counter", "savedroom", "light" and
+//  "autoinventory" as [from, to].
+//
+//  MemGlk collects the output between two glk_select() calls in a frame,
+//  and every command after the first is read by a glk_select() of its
+//  own, so each frame goes to the turn of the last command read before
+//  it. This needs the MemGlk build.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "glk.h"
+#ifdef MEMGLK
+/* The frame and input handlers, from ../memglk rather than this
+   directory's glkstart.h */
+#include <glkstart.h>
+#endif
+
+#include "jsonapi.h"
+#include "layouttext.h"
+#include "parser.h"
+#include "restorestate.h"
+#include "scott.h"
+#include "speculate.h"
+#include "utf8.h"
+
+int JsonApi = 0;
+
+#ifdef MEMGLK
+
+/* Longer commands are cut short, as they would be if they were typed */
+#define MAX_COMMAND_LENGTH 511
+
+struct Turn {
+    glui32 *input;
+    int inputlength;
+    TextBuilder command; /* both escaped for JSON */
+    TextBuilder text;
+};
+
+/* The turns of the answer being put together */
+static struct Turn *turns = NULL;
+static int numturns = 0;
+static int turnssize = 0;
+static int pushed = 0;
+
+/* The commands only tried, with what they did in the text */
+static struct Turn *whatifs = NULL;
+static int numwhatifs = 0;
+static int whatifssize = 0;
+
+static char *request_id = NULL;
+static int exiting = 0;
+
+/* What the game asked for at the end of the last frame */
+static const char *waiting = NULL;
+static TextBuilder file_prompt = { NULL, 0, 0 };
+
+/* The upper window, as it was last drawn */
+static glui32 *grid = NULL;
+static int gridwidth = 0;
+static int gridheight = 0;
+
+static void AppendJsonChar(TextBuilder *tb, glui32 ch)
+{
+    char buf[UTF8_MAX + 1];
+    int len = 0;
+
+    if (ch == '"' || ch == '\\') {
+        buf[len++] = '\\';
+        buf[len++] = (char)ch;
+    } else if (ch == '\n') {
+        buf[len++] = '\\';
+        buf[len++] = 'n';
+    } else if (ch < 0x20) {
+        AppendText(tb, "\\u%04x", ch);
+        return;
+    } else {
+        len = EncodeUtf8(ch, buf);
+    }
+    buf[len] = 0;
+    AppendString(tb, buf);
+}
+
+static struct Turn *AddTurn(struct Turn **list, int *count, int *size)
+{
+    struct Turn *turn;
+
+    if (*count == *size) {
+        *size = *size ? *size * 2 : 16;
+        *list = realloc(*list, *size * sizeof(struct Turn));
+        if (*list == NULL)
+            Fatal("Out of memory");
+        memset(*list + *count, 0, (*size - *count) * sizeof(struct Turn));
+    }
+    turn = &(*list)[(*count)++];
+    free(turn->input);
+    turn->input = NULL;
+    turn->inputlength = 0;
+    ClearText(&turn->command);
+    ClearText(&turn->text);
+    return turn;
+}
+
+static void UpdateGrid(memglk_update_t *update)
+{
+    int row = -1, column = 0, cleared = update->cleared;
+
+    if (update->width != gridwidth || update->height != gridheight) {
+        gridwidth = update->width;
+        gridheight = update->height;
+        free(grid);
+        grid = MemAlloc(gridwidth * gridheight * sizeof(glui32) + 1);
+        cleared = 1;
+    }
+    if (cleared)
+        for (int i = 0; i < gridwidth * gridheight; i++)
+            grid[i] = ' ';
+
+    /* The spans of a row cover all of it */
+    for (int i = 0; i < update->numspans; i++) {
+        memglk_span_t *span = &update->spans[i];
+        if (span->line != row) {
+            row = span->line;
+            column = 0;
+        }
+        for (glui32 j = 0; j < span->len; j++, column++)
+            if (row >= 0 && row < gridheight && column < gridwidth)
+                grid[row * gridwidth + column] = span->text[j];
+    }
+}
+
+static void WriteAnswer(void);
+
+static void TakeFrame(memglk_frame_t *frame, void *rock)
+{
+    int read = pushed - memglk_queue_length();
+    int gridseen = 0;
+    struct Turn *turn;
+
+    if (numturns == 0)
+        AddTurn(&turns, &numturns, &turnssize);
+    turn = &turns[read > 1 ? (read <= numturns ? read - 1 : numturns - 1) : 0];
+
+    waiting = NULL;
+    for (int i = 0; i < frame->numupdates; i++) {
+        memglk_update_t *update = &frame->updates[i];
+        if (update->type == wintype_TextBuffer) {
+            for (int j = 0; j < update->numspans; j++)
+                for (glui32 k = 0; k < update->spans[j].len; k++)
+                    AppendJsonChar(&turn->text, update->spans[j].text[k]);
+        } else if (update->type == wintype_TextGrid) {
+            UpdateGrid(update);
+            gridseen = 1;
+        }
+        if (update->lineinput)
+            waiting = "line";
+        else if (update->charinput && waiting == NULL)
+            waiting = "key";
+    }
+
+    /* After a change of layout, a window that isn't mentioned is gone */
+    if (frame->layoutchanged && !gridseen)
+        gridheight = 0;
+
+    ClearText(&file_prompt);
+    if (frame->prompt) {
+        waiting = "file";
+        for (const char *p = frame->prompt; *p; p++)
+            AppendJsonChar(&file_prompt, (unsigned char)*p);
+    }
+
+    if (frame->exiting) {
+        exiting = 1;
+        WriteAnswer();
+    }
+}
+
+/* The upper window without the spaces at the ends of its lines */
+static void AppendRoom(TextBuilder *tb)
+{
+    int rows = gridheight;
+
+    while (rows > 0) {
+        int column;
+        for (column = 0; column < gridwidth; column++)
+            if (grid[(rows - 1) * gridwidth + column] != ' ')
+                break;
+        if (column < gridwidth)
+            break;
+        rows--;
+    }
+
+    for (int row = 0; row < rows; row++) {
+        glui32 *line = &grid[row * gridwidth];
+        int length = gridwidth;
+        while (length > 0 && line[length - 1] == ' ')
+            length--;
+        if (row)
+            AppendJsonChar(tb, '\n');
+        for (int column = 0; column < length; column++)
+            AppendJsonChar(tb, line[column]);
+    }
+}
+
+static void AppendState(TextBuilder *tb)
+{
+    int stored = CountStoredTreasures();
+
+    AppendString(tb, "\"room\":\"");
+    AppendRoom(tb);
+    AppendText(tb, "\",\"location\":%d", MyLoc);
+    AppendText(tb, ",\"score\":{\"stored\":%d,\"treasures\":%d,\"percent\":%d}",
+        stored, GameHeader.Treasures,
+        GameHeader.Treasures ? stored * 100 / GameHeader.Treasures : 0);
+    AppendText(tb, ",\"hash\":\"%016llx\"", (unsigned long long)StateHash());
+}
+
+/* Each request is answered once, so the id goes with the answer. Anything
+   sent after that, such as the last answer when the input runs out, has
+   none. */
+static void Send(TextBuilder *tb)
+{
+    AppendString(tb, "}\n");
+    fwrite(tb->text, 1, tb->length, stdout);
+    fflush(stdout);
+    free(tb->text);
+    free(request_id);
+    request_id = NULL;
+}
+
+static void StartAnswer(TextBuilder *tb)
+{
+    tb->text = NULL;
+    tb->length = tb->size = 0;
+    AppendString(tb, "{");
+    if (request_id != NULL)
+        AppendText(tb, "\"id\":%s,", request_id);
+}
+
+static void WriteAnswer(void)
+{
+    TextBuilder answer;
+
+    StartAnswer(&answer);
+    AppendString(&answer, "\"turns\":[");
+    for (int i = 0, first = 1; i < numturns; i++) {
+        /* Such as what the game writes after the input runs out */
+        if (turns[i].input == NULL && turns[i].text.length == 0)
+            continue;
+        AppendString(&answer, first ? "{" : ",{");
+        first = 0;
+        if (turns[i].input != NULL)
+            AppendText(&answer, "\"command\":\"%s\",", turns[i].command.text);
+        AppendText(&answer, "\"text\":\"%s\"}", turns[i].text.text);
+    }
+    AppendString(&answer, "],");
+    if (numwhatifs > 0) {
+        AppendString(&answer, "\"whatif\":[");
+        for (int i = 0; i < numwhatifs; i++)
+            AppendText(&answer, "%s{\"command\":\"%s\",%s}", i ? "," : "",
+                whatifs[i].command.text, whatifs[i].text.text);
+        AppendString(&answer, "],");
+    }
+    AppendState(&answer);
+    if (waiting != NULL && !exiting)
+        AppendText(&answer, ",\"waiting\":\"%s\"", waiting);
+    if (file_prompt.length && !exiting)
+        AppendText(&answer, ",\"prompt\":\"%s\"", file_prompt.text);
+    if (exiting)
+        AppendString(&answer, ",\"exiting\":true");
+    Send(&answer);
+
+    numturns = 0;
+    numwhatifs = 0;
+    pushed = 0;
+}
+
+static void WriteError(const char *error)
+{
+    TextBuilder answer;
+
+    StartAnswer(&answer);
+    AppendText(&answer, "\"error\":\"%s\"", error);
+    Send(&answer);
+}
+
+struct Json {
+    const char *p;
+    const char *end;
+};
+
+static void SkipSpace(struct Json *j)
+{
+    while (j->p < j->end && (*j->p == ' ' || *j->p == '\t' || *j->p == '\r' || *j->p == '\n'))
+        j->p++;
+}
+
+static int Next(struct Json *j, char c)
+{
+    SkipSpace(j);
+    if (j->p < j->end && *j->p == c) {
+        j->p++;
+        return 1;
+    }
+    return 0;
+}
+
+static int HexDigits(struct Json *j, glui32 *value)
+{
+    *value = 0;
+    for (int i = 0; i < 4; i++, j->p++) {
+        char c = j->p < j->end ? *j->p : 0;
+        int digit;
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            return 0;
+        *value = (*value << 4) | digit;
+    }
+    return 1;
+}
+
+/* Reads a string into buf, if given, as code points, up to max of them.
+   Returns 0 if it isn't a string. */
+static int ReadString(struct Json *j, glui32 *buf, int max, int *length)
+{
+    int len = 0;
+
+    if (!Next(j, '"'))
+        return 0;
+    while (j->p < j->end && *j->p != '"') {
+        glui32 val;
+        if (*j->p == '\\') {
+            if (++j->p == j->end)
+                return 0;
+            switch (*j->p++) {
+            case '"': val = '"'; break;
+            case '\\': val = '\\'; break;
+            case '/': val = '/'; break;
+            case 'b': val = 8; break;
+            case 'f': val = 12; break;
+            case 'n': val = '\n'; break;
+            case 'r': val = '\r'; break;
+            case 't': val = '\t'; break;
+            case 'u':
+                if (!HexDigits(j, &val))
+                    return 0;
+                if (val >= 0xD800 && val < 0xDC00 && j->end - j->p >= 6
+                    && j->p[0] == '\\' && j->p[1] == 'u') {
+                    glui32 low;
+                    j->p += 2;
+                    if (!HexDigits(j, &low) || low < 0xDC00 || low >= 0xE000)
+                        return 0;
+                    val = 0x10000 + ((val - 0xD800) << 10) + (low - 0xDC00);
+                }
+                break;
+            default:
+                return 0;
+            }
+        } else {
+            val = DecodeUtf8(&j->p, j->end);
+        }
+        /* A command is one line */
+        if (val == '\n' || val == '\r')
+            val = ' ';
+        if (buf != NULL && len < max)
+            buf[len++] = val;
+    }
+    if (j->p == j->end)
+        return 0;
+    j->p++;
+    if (length != NULL)
+        *length = len;
+    return 1;
+}
+
+static int SkipValue(struct Json *j)
+{
+    SkipSpace(j);
+    if (j->p == j->end)
+        return 0;
+    if (*j->p == '"')
+        return ReadString(j, NULL, 0, NULL);
+    if (*j->p == '[' || *j->p == '{') {
+        char close = (*j->p == '[') ? ']' : '}';
+        j->p++;
+        if (Next(j, close))
+            return 1;
+        do {
+            if (close == '}' && (!ReadString(j, NULL, 0, NULL) || !Next(j, ':')))
+                return 0;
+            if (!SkipValue(j))
+                return 0;
+        } while (Next(j, ','));
+        return Next(j, close);
+    }
+    /* A number, true, false or null */
+    const char *start = j->p;
+    while (j->p < j->end && strchr(",]} \t\r\n", *j->p) == NULL)
+        j->p++;
+    return j->p > start;
+}
+
+static int SkipDigits(struct Json *j)
+{
+    const char *start = j->p;
+    while (j->p < j->end && *j->p >= '0' && *j->p <= '9')
+        j->p++;
+    return j->p > start;
+}
+
+static int SkipNumber(struct Json *j)
+{
+    if (j->p < j->end && *j->p == '-')
+        j->p++;
+    if (j->p < j->end && *j->p == '0')
+        j->p++;
+    else if (!SkipDigits(j))
+        return 0;
+    if (j->p < j->end && *j->p == '.') {
+        j->p++;
+        if (!SkipDigits(j))
+            return 0;
+    }
+    if (j->p < j->end && (*j->p == 'e' || *j->p == 'E')) {
+        j->p++;
+        if (j->p < j->end && (*j->p == '+' || *j->p == '-'))
+            j->p++;
+        if (!SkipDigits(j))
+            return 0;
+    }
+    return 1;
+}
+
+/* The id is kept as it came, to be sent back in the answer, so it has to
+   be valid JSON */
+static int ReadId(struct Json *j)
+{
+    const char *start;
+
+    SkipSpace(j);
+    start = j->p;
+    if (j->p == j->end)
+        return 0;
+    if (*j->p == '"') {
+        if (!ReadString(j, NULL, 0, NULL))
+            return 0;
+    } else if (j->end - j->p >= 4 && memcmp(j->p, "null", 4) == 0) {
+        j->p += 4;
+    } else if (!SkipNumber(j)) {
+        return 0;
+    }
+    /* Such as 12x, which isn't a number */
+    if (j->p < j->end && strchr(",} \t\r\n", *j->p) == NULL)
+        return 0;
+    free(request_id);
+    request_id = MemAlloc((int)(j->p - start) + 1);
+    memcpy(request_id, start, j->p - start);
+    request_id[j->p - start] = 0;
+    return 1;
+}
+
+static int AddCommand(struct Json *j, int whatif)
+{
+    glui32 buf[MAX_COMMAND_LENGTH];
+    int length;
+    struct Turn *turn;
+
+    if (!ReadString(j, buf, MAX_COMMAND_LENGTH, &length))
+        return 0;
+    if (whatif)
+        turn = AddTurn(&whatifs, &numwhatifs, &whatifssize);
+    else
+        turn = AddTurn(&turns, &numturns, &turnssize);
+    turn->input = MemAlloc((length + 1) * sizeof(glui32));
+    memcpy(turn->input, buf, length * sizeof(glui32));
+    turn->inputlength = length;
+    for (int i = 0; i < length; i++)
+        AppendJsonChar(&turn->command, buf[i]);
+    return 1;
+}
+
+static int AddCommands(struct Json *j, int whatif)
+{
+    if (!Next(j, '['))
+        return 0;
+    if (Next(j, ']'))
+        return 1;
+    do {
+        if (!AddCommand(j, whatif))
+            return 0;
+    } while (Next(j, ','));
+    return Next(j, ']');
+}
+
+/* Tries each of the whatif commands from the state the game is in, and
+   keeps what they did for the answer */
+static void TryWhatIfs(void)
+{
+    static const char *endings[] = { "line", "key", "file", "untried" };
+
+    for (int i = 0; i < numwhatifs; i++) {
+        struct Turn *turn = &whatifs[i];
+        const Speculation *s = WhatIf(turn->input, turn->inputlength);
+        AppendString(&turn->text, "\"text\":\"");
+        for (int k = 0; k < s->length; k++)
+            AppendJsonChar(&turn->text, s->text[k]);
+        AppendText(&turn->text, "\",\"ended\":\"%s\",\"changes\":%s,\"hash\":\"%016llx\"",
+            endings[s->end], s->changes, (unsigned long long)s->hash);
+    }
+}
+
+static const char *ReadMember(struct Json *j)
+{
+    glui32 key[16];
+    char name[16];
+    int length;
+
+    if (!ReadString(j, key, 15, &length) || !Next(j, ':'))
+        return "Expected a name and a colon";
+    for (int i = 0; i < length; i++)
+        name[i] = key[i] < 0x80 ? (char)key[i] : '?';
+    name[length] = 0;
+
+    if (strcmp(name, "id") == 0) {
+        if (!ReadId(j))
+            return "The id must be a string, a number or null";
+    } else if (strcmp(name, "command") == 0) {
+        if (!AddCommand(j, 0))
+            return "The command must be a string";
+    } else if (strcmp(name, "commands") == 0) {
+        if (!AddCommands(j, 0))
+            return "The commands must be an array of strings";
+    } else if (strcmp(name, "whatif") == 0) {
+        SkipSpace(j);
+        if (j->p < j->end && *j->p == '"') {
+            if (!AddCommand(j, 1))
+                return "The whatif must be a string or an array of strings";
+        } else if (!AddCommands(j, 1)) {
+            return "The whatif must be a string or an array of strings";
+        }
+    } else if (!SkipValue(j)) {
+        return "Bad JSON";
+    }
+    return NULL;
+}
+
+/* Returns 1 if the request gave the game something to do */
+static int ReadRequest(const char *line, size_t length)
+{
+    struct Json j = { line, line + length };
+    const char *error = NULL;
+
+    free(request_id);
+    request_id = NULL;
+    numturns = 0;
+    numwhatifs = 0;
+
+    if (!Next(&j, '{')) {
+        error = "A request must be a JSON object";
+    } else if (!Next(&j, '}')) {
+        do {
+            error = ReadMember(&j);
+        } while (error == NULL && Next(&j, ','));
+        if (error == NULL && !Next(&j, '}'))
+            error = "Expected a comma or a closing brace";
+    }
+    SkipSpace(&j);
+    if (error == NULL && j.p != j.end)
+        error = "Expected the end of the line";
+    if (error == NULL && numwhatifs > 0 && !WaitingForCommand)
+        error = "Commands can only be tried while the game waits for one";
+
+    if (error != NULL) {
+        numturns = 0;
+        numwhatifs = 0;
+        WriteError(error);
+        return 0;
+    }
+    TryWhatIfs();
+    if (numturns == 0) {
+        WriteAnswer();
+        return 0;
+    }
+
+    for (int i = 0; i < numturns; i++)
+        memglk_push_line_uni(turns[i].input, turns[i].inputlength);
+    pushed = numturns;
+    return 1;
+}
+
+static int ReadRequests(glui32 evtype, void *rock)
+{
+    char *line = NULL;
+    size_t size = 0;
+    ssize_t length;
+
+    WriteAnswer();
+
+    while ((length = getline(&line, &size, stdin)) != -1) {
+        struct Json j = { line, line + length };
+        SkipSpace(&j);
+        if (j.p == j.end)
+            continue;
+        if (ReadRequest(line, length)) {
+            free(line);
+            return TRUE;
+        }
+    }
+    free(line);
+    return FALSE;
+}
+
+void StartJsonApi(void)
+{
+    /* Nobody is there to wait for */
+    Options |= NO_DELAYS;
+    memglk_set_frame_handler(TakeFrame, NULL);
+    memglk_set_input_handler(ReadRequests, NULL);
+}
+
+#else
+
+void StartJsonApi(void)
+{
+    Fatal("The JSON API needs the MemGlk build");
+}
+
+#endif /* MEMGLK */
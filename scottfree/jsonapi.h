@@ -0,0 +1,13 @@
+//
+//  jsonapi.h
+//  scott
+//
+
+#ifndef jsonapi_h
+#define jsonapi_h
+
+extern int JsonApi;
+
+void StartJsonApi(void);
+
+#endif /* jsonapi_h */
@@ -0,0 +1,219 @@
+//
+//  latency.c
+//  scott
+//
+//  Times the phases of every turn: parsing the command, running the
+//  actions it matches, running the actions that happen every turn,
+//  drawing the room, saving the undo state and updating the screen. Each
+//  phase has a histogram in the style of HdrHistogram: every power of two
+//  is split into 32 buckets, so a value is kept to within about 3% of it
+//  whatever its size, and recording one is a few shifts and an increment.
+//
+//  The percentiles are written to stderr when the game exits, and
+//  whenever the process gets SIGUSR1. Everything written from the signal
+//  handler is formatted by hand, since stdio can't be used there.
+//
+
+#include <signal.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "glk.h"
+#include "glkstart.h"
+#include "latency.h"
+
+#define SUB_BUCKET_BITS 5
+#define SUB_BUCKETS (1 << SUB_BUCKET_BITS)
+/* Anything longer, about 18 minutes, counts as this long */
+#define MAGNITUDES 40
+#define BUCKETS ((MAGNITUDES - SUB_BUCKET_BITS + 1) * SUB_BUCKETS)
+
+struct Histogram {
+    uint64_t count;
+    uint64_t total;
+    uint64_t max;
+    uint32_t buckets[BUCKETS];
+};
+
+int TimingPhases = 0;
+
+static struct Histogram histograms[NUMBER_OF_PHASES];
+
+static const char *phase_names[NUMBER_OF_PHASES] = {
+    "parse",
+    "explicit actions",
+    "implicit actions",
+    "look",
+    "save undo",
+    "screen update",
+};
+
+/* Values below 64 have a bucket each. Above that, the top five bits
+   below the highest one pick the bucket within its power of two. */
+static int BucketIndex(uint64_t value)
+{
+    int magnitude;
+
+    if (value >= (uint64_t)1 << MAGNITUDES)
+        value = ((uint64_t)1 << MAGNITUDES) - 1;
+    if (value < SUB_BUCKETS)
+        return (int)value;
+    magnitude = 63 - __builtin_clzll(value);
+    return (magnitude - SUB_BUCKET_BITS + 1) * SUB_BUCKETS
+        + (int)(value >> (magnitude - SUB_BUCKET_BITS)) - SUB_BUCKETS;
+}
+
+/* The highest value that goes in a bucket */
+static uint64_t BucketTop(int bucket)
+{
+    int shift;
+
+    if (bucket < 2 * SUB_BUCKETS)
+        return bucket;
+    shift = bucket / SUB_BUCKETS - 1;
+    return (((uint64_t)(SUB_BUCKETS + bucket % SUB_BUCKETS) + 1) << shift) - 1;
+}
+
+static void RecordLatency(Phase phase, uint64_t nanoseconds)
+{
+    struct Histogram *h = &histograms[phase];
+    h->buckets[BucketIndex(nanoseconds)]++;
+    h->count++;
+    h->total += nanoseconds;
+    if (nanoseconds > h->max)
+        h->max = nanoseconds;
+}
+
+void EndPhase(Phase phase, uint64_t start)
+{
+    if (start != 0)
+        RecordLatency(phase, PhaseClock() - start);
+}
+
+static void ScreenUpdateTimer(void *rock, long long nanoseconds)
+{
+    RecordLatency(PHASE_SCREEN_UPDATE, (uint64_t)nanoseconds);
+}
+
+/* The value below which the given millionths of the values fall */
+static uint64_t Percentile(const struct Histogram *h, uint64_t millionths)
+{
+    uint64_t rank = (h->count * millionths + 999999) / 1000000;
+    uint64_t seen = 0;
+
+    if (rank == 0)
+        rank = 1;
+    for (int i = 0; i < BUCKETS; i++) {
+        seen += h->buckets[i];
+        if (seen >= rank)
+            return BucketTop(i) < h->max ? BucketTop(i) : h->max;
+    }
+    return h->max;
+}
+
+/* Not counting the newline */
+#define LINE_LENGTH 127
+
+struct Line {
+    char text[LINE_LENGTH + 1];
+    int length;
+};
+
+static void AddText(struct Line *line, const char *text, int width)
+{
+    int length = 0;
+    while (text[length])
+        length++;
+    while (width-- > length && line->length < LINE_LENGTH)
+        line->text[line->length++] = ' ';
+    for (int i = 0; i < length && line->length < LINE_LENGTH; i++)
+        line->text[line->length++] = text[i];
+}
+
+/* Right-aligned in width, as microseconds with three decimals if
+   fraction is set */
+static void AddNumber(struct Line *line, uint64_t value, int fraction, int width)
+{
+    char digits[32];
+    int pos = sizeof(digits) - 1;
+
+    digits[pos] = 0;
+    if (fraction) {
+        for (int i = 0; i < 3; i++) {
+            digits[--pos] = '0' + value % 10;
+            value /= 10;
+        }
+        digits[--pos] = '.';
+    }
+    do {
+        digits[--pos] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    AddText(line, digits + pos, width);
+}
+
+static void WriteLine(int fd, struct Line *line)
+{
+    line->text[line->length] = '\n';
+    if (write(fd, line->text, line->length + 1) == -1) {
+        /* Nowhere to report it */
+    }
+    line->length = 0;
+}
+
+/* Safe to call from a signal handler */
+void WriteLatencies(int fd)
+{
+    struct Line line = { { 0 }, 0 };
+
+    AddText(&line, "Turn latencies of process ", 0);
+    AddNumber(&line, (uint64_t)getpid(), 0, 0);
+    AddText(&line, ", in microseconds:", 0);
+    WriteLine(fd, &line);
+    AddText(&line, "phase", 0);
+    AddText(&line, "", 18 - line.length);
+    AddText(&line, "count", 11);
+    AddText(&line, "p50", 11);
+    AddText(&line, "p99", 11);
+    AddText(&line, "p999", 11);
+    AddText(&line, "max", 11);
+    AddText(&line, "mean", 11);
+    WriteLine(fd, &line);
+
+    for (int phase = 0; phase < NUMBER_OF_PHASES; phase++) {
+        const struct Histogram *h = &histograms[phase];
+        AddText(&line, phase_names[phase], 0);
+        AddText(&line, "", 18 - line.length);
+        AddNumber(&line, h->count, 0, 11);
+        if (h->count) {
+            AddNumber(&line, Percentile(h, 500000), 1, 11);
+            AddNumber(&line, Percentile(h, 990000), 1, 11);
+            AddNumber(&line, Percentile(h, 999000), 1, 11);
+            AddNumber(&line, h->max, 1, 11);
+            AddNumber(&line, h->total / h->count, 1, 11);
+        }
+        WriteLine(fd, &line);
+    }
+}
+
+static void LatenciesOnSignal(int sig)
+{
+    WriteLatencies(STDERR_FILENO);
+}
+
+static void LatenciesAtExit(void)
+{
+    WriteLatencies(STDERR_FILENO);
+}
+
+void StartTimingPhases(void)
+{
+    TimingPhases = 1;
+#ifdef __GNUC__
+    /* Without it the screen update is not timed */
+    if (glkunix_set_update_timer != NULL)
+#endif
+        glkunix_set_update_timer(ScreenUpdateTimer, NULL);
+    signal(SIGUSR1, LatenciesOnSignal);
+    atexit(LatenciesAtExit);
+}
@@ -0,0 +1,46 @@
+//
+//  latency.h
+//  scott
+//
+
+#ifndef latency_h
+#define latency_h
+
+#include <stdint.h>
+#include <time.h>
+
+typedef enum {
+    PHASE_PARSE,
+    PHASE_EXPLICIT_ACTIONS,
+    PHASE_IMPLICIT_ACTIONS,
+    PHASE_LOOK,
+    PHASE_SAVE_UNDO,
+    PHASE_SCREEN_UPDATE,
+    NUMBER_OF_PHASES
+} Phase;
+
+extern int TimingPhases;
+
+/* The start of a phase, or 0 when nothing is timed */
+static inline uint64_t PhaseClock(void)
+{
+    struct timespec ts;
+    if (!TimingPhases)
+        return 0;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+/* For timing the things that are only done now and then */
+static inline double Milliseconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+void EndPhase(Phase phase, uint64_t start);
+void StartTimingPhases(void);
+void WriteLatencies(int fd);
+
+#endif /* latency_h */
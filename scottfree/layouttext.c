@@ -9,45 +9,116 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include "scott.h"
+
 #include "layouttext.h"
 
-static int FindBreak(const char *buf, int pos, int columns)
+/* Make room for at least extra more characters and a terminating zero */
+static void ReserveText(TextBuilder *tb, size_t extra)
+{
+    size_t needed = tb->length + extra + 1;
+    if (needed <= tb->size)
+        return;
+
+    size_t newsize = tb->size ? tb->size : 1024;
+    while (newsize < needed)
+        newsize *= 2;
+
+    char *newtext = realloc(tb->text, newsize);
+    if (newtext == NULL)
+        Fatal("Out of memory");
+    tb->text = newtext;
+    tb->size = newsize;
+}
+
+void ClearText(TextBuilder *tb)
+{
+    ReserveText(tb, 0);
+    tb->length = 0;
+    tb->text[0] = '\0';
+}
+
+void AppendString(TextBuilder *tb, const char *s)
+{
+    size_t len = strlen(s);
+    ReserveText(tb, len);
+    memcpy(tb->text + tb->length, s, len + 1);
+    tb->length += len;
+}
+
+void AppendTextV(TextBuilder *tb, const char *fmt, va_list ap)
+{
+    va_list copy;
+
+    ReserveText(tb, 0);
+    va_copy(copy, ap);
+    int len = vsnprintf(tb->text + tb->length, tb->size - tb->length, fmt, copy);
+    va_end(copy);
+    if (len < 0) {
+        tb->text[tb->length] = '\0';
+        return;
+    }
+
+    /* Only format a second time if the first attempt didn't fit */
+    if (tb->length + len >= tb->size) {
+        ReserveText(tb, len);
+        vsnprintf(tb->text + tb->length, tb->size - tb->length, fmt, ap);
+    }
+    tb->length += len;
+}
+
+void AppendText(TextBuilder *tb, const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    AppendTextV(tb, fmt, ap);
+    va_end(ap);
+}
+
+/* Look back from the end of the line written so far for a space to break
+   at. Returns the number of characters to move down to the next line, or
+   -1 if there is no space */
+static int FindBreak(const char *buf, int nextpos, int destpos, int columns)
 {
 
-    if (isspace((unsigned char)buf[pos]))
+    if (isspace((unsigned char)buf[nextpos]))
         return 0;
 
-    int diff = 0;
+    int diff = 1;
 
-    while (diff < columns && !isspace((unsigned char)buf[pos])) {
-        pos--;
+    while (diff < columns && diff <= destpos && !isspace((unsigned char)buf[destpos - diff])) {
         diff++;
     }
 
-    if (diff >= columns || diff < 1) /* Found no space */ {
+    if (diff >= columns || diff > destpos) /* Found no space */ {
         return -1;
     }
 
     return diff;
 }
 
-/* Breaks a null-terminated string up by inserting newlines, moving words
- down to the next line when reaching the end of the line */
-char *LineBreakText(char *source, int columns, int *rows, int *length)
+/* Breaks the text up by inserting newlines, moving words down to the next
+ line when reaching the end of the line. A space we break at is replaced by
+ the newline, and spaces before a line break are dropped, so the text never
+ gets longer and can be rewritten in place */
+int LineBreakText(TextBuilder *tb, int columns)
 {
     columns -= 1;
 
-    char *result = NULL;
-    char buf[768];
+    char *buf = tb->text;
     int col = 0;
     int row = 0;
     int sourcepos = 0;
     int destpos = 0;
     int diff = 0;
-    *rows = 0;
-    while (source[sourcepos] != '\0') {
-        while (col < columns && source[sourcepos] != '\0') {
-            if (source[sourcepos] == 10 || source[sourcepos] == 13) {
+
+    if (buf == NULL)
+        return 0;
+
+    while (buf[sourcepos] != '\0') {
+        while (col < columns && buf[sourcepos] != '\0') {
+            if (buf[sourcepos] == 10 || buf[sourcepos] == 13) {
                 /* Found a line break. */
                 /* Any spaces before a line break may cause trouble, */
                 /* so we delete them */
@@ -60,9 +131,9 @@ char *LineBreakText(char *source, int columns, int *rows, int *length)
                 col++;
             }
 
-            buf[destpos++] = source[sourcepos++];
+            buf[destpos++] = buf[sourcepos++];
 
-            if (source[sourcepos] == 10 || source[sourcepos] == 13)
+            if (buf[sourcepos] == 10 || buf[sourcepos] == 13)
                 col--;
         }
 
@@ -70,28 +141,22 @@ char *LineBreakText(char *source, int columns, int *rows, int *length)
         row++;
         col = 0;
 
-        if (source[sourcepos] == '\0') {
+        if (buf[sourcepos] == '\0') {
             break;
         }
 
-        diff = FindBreak(source, sourcepos, columns);
-        if (diff > -1) { /* We found a suitable break */
-            sourcepos = sourcepos - diff;
-            destpos = destpos - diff;
+        diff = FindBreak(buf, sourcepos, destpos, columns);
+        if (diff == 0) { /* The next character is a space */
             buf[destpos++] = '\n';
-
-            if (isspace((unsigned char)source[sourcepos])) {
-                sourcepos++;
-            }
+            sourcepos++;
+        } else if (diff > 0) { /* We found a suitable break */
+            /* The end of the word is already in place after the space,
+               and starts the next line */
+            buf[destpos - diff] = '\n';
+            col = diff - 1;
         }
     }
-    *rows = row;
-    *length = 0;
-    result = malloc(destpos + 1);
-    if (result == NULL)
-        return NULL;
-    memcpy(result, buf, destpos);
-    result[destpos] = '\0';
-    *length = destpos;
-    return result;
+    buf[destpos] = '\0';
+    tb->length = destpos;
+    return row;
 }
@@ -8,10 +8,31 @@
 #ifndef layouttext_h
 #define layouttext_h
 
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
 
-/* Breaks a null-terminated string up by inserting newlines,*/
-/* moving words down to the next line when reaching the end of the line */
-char *LineBreakText(char *source, int columns, int *rows, int *length);
+/* Text that grows as it is written. The buffer is kept when the text is
+   cleared, so once it has grown big enough, building text again does not
+   allocate anything */
+typedef struct {
+    char *text;
+    size_t length;
+    size_t size;
+} TextBuilder;
+
+void ClearText(TextBuilder *tb);
+void AppendString(TextBuilder *tb, const char *s);
+void AppendText(TextBuilder *tb, const char *fmt, ...)
+#ifdef __GNUC__
+    __attribute__((__format__(__printf__, 2, 3)))
+#endif
+    ;
+void AppendTextV(TextBuilder *tb, const char *fmt, va_list ap);
+
+/* Breaks the text up by inserting newlines, */
+/* moving words down to the next line when reaching the end of the line. */
+/* This is done in place, and returns the number of rows */
+int LineBreakText(TextBuilder *tb, int columns);
 
 #endif /* layouttext_h */
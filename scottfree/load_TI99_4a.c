@@ -53,6 +53,7 @@ uint8_t *ti99_implicit_actions = NULL;
 uint8_t *ti99_explicit_actions = NULL;
 size_t ti99_implicit_extent = 0;
 size_t ti99_explicit_extent = 0;
+int ti99_num_verbs = 0;
 
 uint8_t **VerbActionOffsets;
 
@@ -285,6 +286,7 @@ static void ReadTI99ExplicitActions(struct DATAHEADER dh)
     blockstart = entire_file + explicit_offset;
 
     VerbActionOffsets = MemAlloc((dh.num_verbs + 1) * sizeof(uint8_t *));
+    ti99_num_verbs = dh.num_verbs;
 
     for (i = 0; i <= dh.num_verbs; i++) {
         ptr = blockstart;
@@ -396,6 +398,8 @@ static int TryLoadingTI994A(struct DATAHEADER dh, int loud)
 
     GameHeader.NumItems = ni;
     Items = (Item *)MemAlloc(sizeof(Item) * (ni + 1));
+    ItemLocations = MemAlloc(sizeof(uint16_t) * (ni + 1));
+    InitialLocations = MemAlloc(sizeof(uint16_t) * (ni + 1));
     GameHeader.NumActions = 0;
     GameHeader.NumWords = nw;
     GameHeader.WordLength = wl;
@@ -494,8 +498,8 @@ static int TryLoadingTI994A(struct DATAHEADER dh, int loud)
     ct = 0;
     ip = Items;
     while (ct < ni + 1) {
-        ip->Location = *(ptr++ - file_baseline_offset);
-        ip->InitialLoc = ip->Location;
+        ItemLocations[ct] = *(ptr++ - file_baseline_offset);
+        InitialLocations[ct] = ItemLocations[ct];
         ip++;
         ct++;
     }
@@ -17,6 +17,8 @@ GameIDType DetectTI994A(void);
 extern uint8_t *ti99_implicit_actions;
 extern uint8_t *ti99_explicit_actions;
 extern size_t ti99_implicit_extent;
+extern size_t ti99_explicit_extent;
+extern int ti99_num_verbs;
 extern uint8_t **VerbActionOffsets;
 
 #endif /* load_TI99_4a_h */
@@ -0,0 +1,315 @@
+//
+//  metrics.c
+//  scott
+//
+//  Counts what the game does, for running it as a service: turns,
+//  commands that were not understood or could not be done yet, undos,
+//  saves and restores, allocations, and the text written to the windows.
+//
+//  Every process counts into a slot of its own, so a counter never has
+//  more than one writer and nothing has to be locked. The slots are in
+//  memory shared by the session host and all the processes it forks, and
+//  when a session ends its counts are added to the totals of its game.
+//  The host answers each connection to the metrics socket with the totals
+//  of each game in the Prometheus text format, labelled with the game's
+//  name, so that summing over the label gives all of them. A game run on
+//  its own writes the same text to a file instead, at most once a second.
+//
+
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "metrics.h"
+#include "scott.h"
+
+#define METRICS_GAMES 64
+#define METRICS_SLOTS 1024
+
+struct MetricsGame {
+    int used;
+    char name[64];
+    uint64_t ended[NUMBER_OF_METRICS]; /* from the processes that have ended */
+};
+
+struct MetricsSlot {
+    pid_t pid; /* 0 if free */
+    int game;
+    int session;
+    uint64_t counts[NUMBER_OF_METRICS];
+};
+
+struct MetricsTable {
+    /* Each slot that ends counts up both, first the one and then the
+       other, so a reader knows whether one ended while it was reading */
+    unsigned long ends_begun;
+    unsigned long ends_done;
+    struct MetricsGame games[METRICS_GAMES];
+    struct MetricsSlot slots[METRICS_SLOTS];
+};
+
+static const struct {
+    const char *name;
+    const char *help;
+} metric_names[NUMBER_OF_METRICS] = {
+    { "scottfree_turns_total", "Commands carried out." },
+    { "scottfree_not_understood_total", "Commands that no action of the game matched." },
+    { "scottfree_cant_do_yet_total", "Commands that matched an action whose conditions were not met." },
+    { "scottfree_undos_total", "Moves taken back." },
+    { "scottfree_saves_total", "Games saved, to a file or in memory." },
+    { "scottfree_restores_total", "Games restored, from a file or from memory." },
+    { "scottfree_allocations_total", "Blocks of memory allocated." },
+    { "scottfree_allocated_bytes_total", "Bytes of memory allocated." },
+    { "scottfree_rendered_bytes_total", "Bytes of text written to the windows." },
+};
+
+static uint64_t local_counts[NUMBER_OF_METRICS];
+uint64_t *MetricCounts = local_counts;
+
+static struct MetricsTable *table = NULL;
+static struct MetricsSlot *my_slot = NULL;
+static int my_game = -1;
+
+/* A game run on its own writes its metrics here */
+static const char *metrics_file = NULL;
+static time_t last_written = 0;
+
+static void ReleaseSlot(void);
+
+static void WriteMetricsFile(void)
+{
+    size_t size = strlen(metrics_file) + 5;
+    char *newname = MemAlloc((int)size);
+    FILE *f;
+
+    snprintf(newname, size, "%s.new", metrics_file);
+    f = fopen(newname, "w");
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", newname, strerror(errno));
+        free(newname);
+        return;
+    }
+    WriteMetrics(f);
+    if (ferror(f) | fclose(f) || rename(newname, metrics_file) == -1) {
+        fprintf(stderr, "%s: %s\n", metrics_file, strerror(errno));
+        unlink(newname);
+    }
+    free(newname);
+    last_written = time(NULL);
+}
+
+static void ExitMetrics(void)
+{
+    if (metrics_file != NULL && my_slot != NULL)
+        WriteMetricsFile();
+    ReleaseSlot();
+}
+
+/* Hosted, the table is shared with everything the host forks, and the
+   host serves it on a socket; otherwise it is written to the file at
+   path */
+void OpenMetrics(const char *path, int hosted)
+{
+    table = mmap(NULL, sizeof(struct MetricsTable), PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (table == MAP_FAILED) {
+        table = NULL;
+        fprintf(stderr, "Cannot map metrics: %s\n", strerror(errno));
+        return;
+    }
+    if (!hosted)
+        metrics_file = path;
+    atexit(ExitMetrics);
+}
+
+static void ClaimSlot(int session)
+{
+    my_slot = NULL;
+    MetricCounts = local_counts;
+    for (int i = 0; i < METRICS_SLOTS; i++) {
+        struct MetricsSlot *s = &table->slots[i];
+        pid_t none = 0;
+        if (__atomic_compare_exchange_n(&s->pid, &none, getpid(), 0,
+                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            s->game = my_game;
+            s->session = session;
+            my_slot = s;
+            MetricCounts = s->counts;
+            return;
+        }
+    }
+    fprintf(stderr, "No room for the metrics of process %ld\n", (long)getpid());
+}
+
+/* Adds the counts of a slot to the totals of its game and frees it */
+static void EndSlot(struct MetricsSlot *s)
+{
+    struct MetricsGame *g = &table->games[s->game];
+    __atomic_fetch_add(&table->ends_begun, 1, __ATOMIC_SEQ_CST);
+    for (int i = 0; i < NUMBER_OF_METRICS; i++) {
+        __atomic_fetch_add(&g->ended[i], __atomic_load_n(&s->counts[i], __ATOMIC_RELAXED),
+            __ATOMIC_RELAXED);
+        __atomic_store_n(&s->counts[i], 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&s->pid, 0, __ATOMIC_RELEASE);
+    __atomic_fetch_add(&table->ends_done, 1, __ATOMIC_SEQ_CST);
+}
+
+static void ReleaseSlot(void)
+{
+    if (my_slot == NULL)
+        return;
+    MetricCounts = local_counts;
+    EndSlot(my_slot);
+    my_slot = NULL;
+}
+
+/* Called once the game is loaded. What was counted while loading it
+   goes to the game. */
+void MetricsForGame(const char *name)
+{
+    int i;
+
+    if (table == NULL)
+        return;
+
+    /* A game can be loaded again after its process has been shut down,
+       and then carries on from the same totals */
+    for (i = 0; i < METRICS_GAMES; i++) {
+        struct MetricsGame *g = &table->games[i];
+        int unused = 0;
+        if (__atomic_load_n(&g->used, __ATOMIC_ACQUIRE) == 2 && strcmp(g->name, name) == 0)
+            break;
+        if (__atomic_compare_exchange_n(&g->used, &unused, 1, 0,
+                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            snprintf(g->name, sizeof(g->name), "%s", name);
+            __atomic_store_n(&g->used, 2, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+    if (i == METRICS_GAMES) {
+        fprintf(stderr, "No room for the metrics of %s\n", name);
+        return;
+    }
+    my_game = i;
+
+    /* A game run on its own is a session; a host only forks them */
+    ClaimSlot(metrics_file != NULL);
+    if (my_slot != NULL)
+        for (i = 0; i < NUMBER_OF_METRICS; i++)
+            CountMetric(i, local_counts[i]);
+    memset(local_counts, 0, sizeof(local_counts));
+}
+
+/* Called in a newly forked session, which counts from nothing */
+void MetricsForSession(void)
+{
+    if (table == NULL || my_game == -1)
+        return;
+    ClaimSlot(1);
+}
+
+/* Called when a child has been reaped, in case it could not clean up
+   after itself */
+void EndMetrics(pid_t pid)
+{
+    if (table == NULL)
+        return;
+    for (int i = 0; i < METRICS_SLOTS; i++)
+        if (__atomic_load_n(&table->slots[i].pid, __ATOMIC_ACQUIRE) == pid)
+            EndSlot(&table->slots[i]);
+}
+
+static void WriteLabel(FILE *f, const char *name)
+{
+    fputs("{game=\"", f);
+    for (; *name; name++) {
+        if (*name == '\\' || *name == '"')
+            fputc('\\', f);
+        if (*name == '\n')
+            fputs("\\n", f);
+        else
+            fputc(*name, f);
+    }
+    fputs("\"}", f);
+}
+
+/* Adds up the ended and running counts of every game, or returns 0 if a
+   slot ended meanwhile, which would have had its counts either missed
+   or counted twice */
+static int ReadTotals(uint64_t totals[][NUMBER_OF_METRICS], int *sessions, int *used)
+{
+    unsigned long begun = __atomic_load_n(&table->ends_begun, __ATOMIC_SEQ_CST);
+    int g, m;
+
+    if (__atomic_load_n(&table->ends_done, __ATOMIC_SEQ_CST) != begun)
+        return 0;
+
+    memset(totals, 0, METRICS_GAMES * sizeof(totals[0]));
+    memset(sessions, 0, METRICS_GAMES * sizeof(int));
+    for (g = 0; g < METRICS_GAMES; g++) {
+        used[g] = (__atomic_load_n(&table->games[g].used, __ATOMIC_ACQUIRE) == 2);
+        for (m = 0; used[g] && m < NUMBER_OF_METRICS; m++)
+            totals[g][m] = __atomic_load_n(&table->games[g].ended[m], __ATOMIC_RELAXED);
+    }
+    for (int i = 0; i < METRICS_SLOTS; i++) {
+        struct MetricsSlot *s = &table->slots[i];
+        if (__atomic_load_n(&s->pid, __ATOMIC_ACQUIRE) == 0)
+            continue;
+        g = s->game;
+        if (g < 0 || g >= METRICS_GAMES)
+            continue;
+        sessions[g] += s->session;
+        for (m = 0; m < NUMBER_OF_METRICS; m++)
+            totals[g][m] += __atomic_load_n(&s->counts[m], __ATOMIC_RELAXED);
+    }
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_load_n(&table->ends_begun, __ATOMIC_SEQ_CST) == begun;
+}
+
+void WriteMetrics(FILE *f)
+{
+    uint64_t totals[METRICS_GAMES][NUMBER_OF_METRICS];
+    int sessions[METRICS_GAMES];
+    int used[METRICS_GAMES];
+    int g, m;
+
+    if (table == NULL)
+        return;
+
+    while (!ReadTotals(totals, sessions, used))
+        sched_yield();
+
+    for (m = 0; m < NUMBER_OF_METRICS; m++) {
+        fprintf(f, "# HELP %s %s\n# TYPE %s counter\n", metric_names[m].name,
+            metric_names[m].help, metric_names[m].name);
+        for (g = 0; g < METRICS_GAMES; g++) {
+            if (!used[g])
+                continue;
+            fputs(metric_names[m].name, f);
+            WriteLabel(f, table->games[g].name);
+            fprintf(f, " %llu\n", (unsigned long long)totals[g][m]);
+        }
+    }
+
+    fputs("# HELP scottfree_sessions Sessions running now.\n# TYPE scottfree_sessions gauge\n", f);
+    for (g = 0; g < METRICS_GAMES; g++) {
+        if (!used[g])
+            continue;
+        fputs("scottfree_sessions", f);
+        WriteLabel(f, table->games[g].name);
+        fprintf(f, " %d\n", sessions[g]);
+    }
+}
+
+/* Called after every turn */
+void MetricsTick(void)
+{
+    if (metrics_file != NULL && time(NULL) != last_written)
+        WriteMetricsFile();
+}
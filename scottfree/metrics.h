@@ -0,0 +1,45 @@
+//
+//  metrics.h
+//  scott
+//
+
+#ifndef metrics_h
+#define metrics_h
+
+#include <stdint.h>
+#include <stdio.h>
+#include <sys/types.h>
+
+typedef enum {
+    METRIC_TURNS,
+    METRIC_NOT_UNDERSTOOD,
+    METRIC_CANT_DO_YET,
+    METRIC_UNDOS,
+    METRIC_SAVES,
+    METRIC_RESTORES,
+    METRIC_ALLOCATIONS,
+    METRIC_ALLOCATED_BYTES,
+    METRIC_RENDERED_BYTES,
+    NUMBER_OF_METRICS
+} Metric;
+
+/* The counters of this process. Nothing else writes to them, so they
+   are only read and written atomically to keep the reader from seeing
+   half of a value. */
+extern uint64_t *MetricCounts;
+
+static inline void CountMetric(Metric metric, uint64_t n)
+{
+    __atomic_store_n(&MetricCounts[metric],
+        __atomic_load_n(&MetricCounts[metric], __ATOMIC_RELAXED) + n,
+        __ATOMIC_RELAXED);
+}
+
+void OpenMetrics(const char *path, int hosted);
+void MetricsForGame(const char *name);
+void MetricsForSession(void);
+void EndMetrics(pid_t pid);
+void WriteMetrics(FILE *f);
+void MetricsTick(void);
+
+#endif /* metrics_h */
@@ -4,13 +4,18 @@
 //
 //  Created by Administrator on 2022-01-19.
 //
+#include <ctype.h>
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "definitions.h"
+#include "journal.h"
+#include "latency.h"
+#include "layouttext.h"
 #include "parser.h"
 #include "scott.h"
+#include "speculate.h"
 
 #include "bsd.h"
 
@@ -26,7 +31,14 @@ glui32 **UnicodeWords = NULL;
 char **CharWords = NULL;
 static int WordsInInput = 0;
 
-static int lastnoun = 0;
+/* Set while waiting for the player to type a command */
+int WaitingForCommand = 0;
+
+/* Set when the prompt is on the screen already, as when a session wakes
+   from sleep */
+int PromptShown = 0;
+
+int LastNoun = 0;
 
 static glui32 *FirstErrorMessage = NULL;
 
@@ -81,6 +93,46 @@ static void CreateErrorMessage(const char *fchar, glui32 *second, const char *tc
     free(first);
 }
 
+/* The TI-99/4A games use a few characters of their own for letters that
+   aren't in ASCII. These are what they stand for, in Latin-1. Everything
+   else is printed as it is */
+static const char *const TI99Characters[256] = {
+    [12] = "\xf6",
+    ['@'] = "\xa9 ",
+    ['{'] = "\xe4",
+    ['}'] = "\xfc",
+};
+
+static const char *TranslateCharacter(unsigned char c)
+{
+    if (Game && CurrentGame == TI994A)
+        return TI99Characters[c];
+    return NULL;
+}
+
+/* Write length characters of string to stream as Latin-1. Runs of
+   characters that need no translation are written in one go */
+void PutTranslatedString(strid_t stream, const char *string, size_t length)
+{
+    size_t start = 0;
+    size_t i;
+
+    if (Game && CurrentGame == TI994A) {
+        for (i = 0; i < length; i++) {
+            const char *special = TI99Characters[(unsigned char)string[i]];
+            if (special == NULL)
+                continue;
+            if (i > start)
+                glk_put_buffer_stream(stream, (char *)string + start, i - start);
+            glk_put_string_stream(stream, (char *)special);
+            start = i + 1;
+        }
+    }
+
+    if (length > start)
+        glk_put_buffer_stream(stream, (char *)string + start, length - start);
+}
+
 glui32 *ToUnicode(const char *string)
 {
     if (string == NULL)
@@ -88,29 +140,15 @@ glui32 *ToUnicode(const char *string)
     glui32 unicode[2048];
     int i;
     int dest = 0;
-    for (i = 0; string[i] != 0 && i < 2047; i++) {
-        char c = string[i];
-        if (c == '\n')
-            c = 10;
-        glui32 unichar = (glui32)c;
-        if (Game && CurrentGame == TI994A) {
-            switch (c) {
-            case '@':
-                unicode[dest++] = 0xa9;
-                unichar = ' ';
-                break;
-            case '}':
-                unichar = 0xfc;
-                break;
-                case 12:
-                    unichar = 0xf6;
-                break;
-            case '{':
-                unichar = 0xe4;
-                break;
-            }
+    for (i = 0; string[i] != 0 && dest < 2047; i++) {
+        unsigned char c = string[i];
+        const char *special = TranslateCharacter(c);
+        if (special == NULL) {
+            unicode[dest++] = c;
+            continue;
         }
-        unicode[dest++] = unichar;
+        while (*special != 0 && dest < 2047)
+            unicode[dest++] = (unsigned char)*special++;
     }
     unicode[dest] = 0;
     glui32 *result = MemAlloc((dest + 1) * 4);
@@ -278,6 +316,52 @@ static char **SplitIntoWords(glui32 *string, int length)
     return words8;
 }
 
+/* Input waiting to be read as if it had been typed, one command line per
+   line. Scripted clients use this to send a whole batch of commands */
+static TextBuilder queued_input = { NULL, 0, 0 };
+static size_t queued_input_pos = 0;
+
+void QueueInput(const char *lines)
+{
+    if (lines == NULL || lines[0] == 0)
+        return;
+    AppendString(&queued_input, lines);
+    if (queued_input.text[queued_input.length - 1] != '\n')
+        AppendString(&queued_input, "\n");
+}
+
+/* Returns 1 if there is input to be read without asking the player */
+int InputPending(void)
+{
+    return queued_input_pos < queued_input.length || InputRecording != NULL;
+}
+
+static int ReadLineFromQueue(glui32 *buf, glui32 *length)
+{
+    if (queued_input_pos >= queued_input.length)
+        return 0;
+
+    const char *line = queued_input.text + queued_input_pos;
+    const char *end = strchr(line, '\n');
+    int linelength = (int)(end - line);
+    int i;
+
+    queued_input_pos += linelength + 1;
+    if (linelength > 511)
+        linelength = 511;
+    for (i = 0; i < linelength; i++)
+        buf[i] = (unsigned char)line[i];
+    buf[i] = 0;
+    Display(Bottom, "%.*s\n", linelength, line);
+    *length = i;
+
+    if (queued_input_pos >= queued_input.length) {
+        ClearText(&queued_input);
+        queued_input_pos = 0;
+    }
+    return 1;
+}
+
 static int ReadLineFromRecording(glui32 *buf, glui32 *length)
 {
     if (InputRecording == NULL)
@@ -308,17 +392,37 @@ static int ReadLineFromRecording(glui32 *buf, glui32 *length)
     return 1;
 }
 
-static char **LineInput(void)
+/* When the words of the last line were split, for timing the parse */
+static uint64_t parse_start = 0;
+
+/* A line from the queue, a replayed journal, a recording or the player,
+   in that order */
+static void ReadLine(glui32 *unibuf, glui32 *length)
 {
     event_t ev;
-    glui32 unibuf[512];
 
-    do {
+    if (!InputPending()) {
+        FinishReplay();
+        JournalCheckpoint();
+    }
+
+    if (PromptShown)
+        PromptShown = 0;
+    else
         Display(Bottom, "\n%s", sys[WHAT_NOW]);
 
+    if (ReadLineFromQueue(unibuf, &ev.val1) == 0
+        && ReplayLine(unibuf, &ev.val1) == 0) {
         if (ReadLineFromRecording(unibuf, &ev.val1) == 0) {
+            /* A room description skipped while running queued
+               commands has to be drawn before the player gets to see
+               the screen. (Without an upper window, Top is Bottom and
+               nothing was skipped) */
+            if ((Options & PIPELINE) && Top != Bottom)
+                Look();
             glk_request_line_event_uni(Bottom, unibuf, (glui32)511, 0);
 
+            WaitingForCommand = 1;
             while (1) {
                 glk_select(&ev);
 
@@ -327,16 +431,37 @@ static char **LineInput(void)
                 else
                     Updates(ev);
             }
+            WaitingForCommand = 0;
 
             unibuf[ev.val1] = 0;
         }
+        /* Queued commands come from a line that is in the journal
+           already */
+        JournalLine(unibuf, ev.val1);
+    }
 
-        if (Transcript) {
-            glk_put_string_stream_uni(Transcript, unibuf);
-            glk_put_char_stream_uni(Transcript, 10);
-        }
+    if (Transcript) {
+        glk_put_string_stream_uni(Transcript, unibuf);
+        glk_put_char_stream_uni(Transcript, 10);
+    }
+    *length = ev.val1;
+}
 
-        CharWords = SplitIntoWords(unibuf, ev.val1);
+static char **LineInput(void)
+{
+    glui32 unibuf[512];
+    glui32 length;
+
+    do {
+        /* A command that is only tried has nothing to do with the
+           journal or the transcript */
+        if (Speculating)
+            ReadSpeculativeLine(unibuf, &length);
+        else
+            ReadLine(unibuf, &length);
+
+        parse_start = PhaseClock();
+        CharWords = SplitIntoWords(unibuf, length);
 
         if (WordsInInput == 0 || CharWords == NULL)
             Output(sys[HUH]);
@@ -348,22 +473,39 @@ static char **LineInput(void)
     return NULL;
 }
 
-int WhichWord(const char *word, const char **list, int word_length, int list_length)
+/* Words are only compared by their first few letters, ignoring case. To
+   make that a single integer compare, the first eight letters of every
+   word in the lists below are folded and packed into a key when the game
+   is loaded, first letter in the lowest byte. Only when more than eight
+   letters count are the words compared letter by letter as well. */
+uint64_t WordKey(const char *word, int length)
 {
-    int n = 1;
-    int ne = 1;
-    const char *tp;
-    while (ne < list_length) {
-        tp = list[ne];
-        if (*tp == '*')
-            tp++;
-        else
-            n = ne;
-        if (xstrncasecmp(word, tp, word_length) == 0)
-            return (n);
-        ne++;
-    }
-    return (0);
+    uint64_t key = 0;
+    if (length > 8)
+        length = 8;
+    for (int i = 0; i < length && word[i]; i++)
+        key |= (uint64_t)tolower((unsigned char)word[i]) << (8 * i);
+    return key;
+}
+
+static uint64_t KeyMask(int length)
+{
+    if (length >= 8)
+        return ~(uint64_t)0;
+    if (length <= 0)
+        return 0;
+    return ((uint64_t)1 << (8 * length)) - 1;
+}
+
+/* Same result as xstrncasecmp(word1, word2, length) == 0, given the keys
+   of the two words */
+int WordsMatch(uint64_t key1, const char *word1, uint64_t key2,
+    const char *word2, int length)
+{
+    uint64_t mask = KeyMask(length);
+    if ((key1 & mask) != (key2 & mask))
+        return 0;
+    return (length <= 8 || xstrncasecmp(word1, word2, length) == 0);
 }
 
 const char *EnglishDirections[NUMBER_OF_DIRECTIONS] = { NULL, "north", "south", "east", "west", "up", "down", "n", "s", "e", "w", "u", "d", " " };
@@ -458,6 +600,268 @@ const char *GermanDelimiterList[NUMBER_OF_DELIMITERS] = { NULL, ",", "und",
     "dann", "and" };
 const char *DelimiterList[NUMBER_OF_DELIMITERS];
 
+static uint64_t *VerbKeys = NULL;
+static uint64_t *NounKeys = NULL;
+static uint64_t DirectionKeys[NUMBER_OF_DIRECTIONS];
+static uint64_t SkipListKeys[NUMBER_OF_SKIPPABLE_WORDS];
+static uint64_t DelimiterKeys[NUMBER_OF_DELIMITERS];
+static uint64_t ExtraCommandKeys[NUMBER_OF_EXTRA_COMMANDS];
+static uint64_t ExtraNounKeys[NUMBER_OF_EXTRA_NOUNS];
+static uint64_t AbbreviationKeys[NUMBER_OF_ABBREVIATIONS];
+
+/* Synonyms are marked with a leading asterisk, which is not part of the
+   key */
+static void KeyList(uint64_t *keys, const char **list, int list_length)
+{
+    for (int i = 0; i < list_length; i++) {
+        const char *tp = list[i];
+        keys[i] = 0;
+        if (tp == NULL)
+            continue;
+        if (*tp == '*')
+            tp++;
+        keys[i] = WordKey(tp, 8);
+    }
+}
+
+/* Which items each noun picks up and drops, and which noun each item is
+   taken or dropped by in TAKE ALL and DROP ALL. An item goes with a noun
+   when its AutoGet word matches the noun, or the word the noun is a
+   synonym of. The items of noun n are NounItems[NounItemsStart[n]] up to
+   NounItems[NounItemsEnd[n]], in item order. */
+static int *NounItems = NULL;
+static int *NounItemsStart = NULL;
+static int *NounItemsEnd = NULL;
+static int *ItemNouns = NULL;
+
+struct ItemKey {
+    uint64_t key;
+    int item;
+};
+
+static int CompareItemKeys(const void *a, const void *b)
+{
+    const struct ItemKey *ka = a, *kb = b;
+    if (ka->key != kb->key)
+        return (ka->key < kb->key) ? -1 : 1;
+    return ka->item - kb->item;
+}
+
+/* The first of the sorted item keys that is not less than key */
+static int FindItemKey(const struct ItemKey *keys, int count, uint64_t key)
+{
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        int mid = lo + (hi - lo) / 2;
+        if (keys[mid].key < key)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int ItemMatchesWord(int item, const char *word)
+{
+    return (GameHeader.WordLength <= 8 || xstrncasecmp(Items[item].AutoGet, word, GameHeader.WordLength) == 0);
+}
+
+/* The word a noun stands for, as MapSynonym() finds it */
+static int NounWord(int noun)
+{
+    int n = noun;
+    if (noun == 0)
+        return 0;
+    while (n > 0 && *Nouns[n] == '*')
+        n--;
+    return n;
+}
+
+static void IndexItemNouns(void)
+{
+    int ni = GameHeader.NumItems + 1;
+    int nw = GameHeader.NumWords + 1;
+    uint64_t mask = KeyMask(GameHeader.WordLength);
+    struct ItemKey *keys = MemAlloc(sizeof(struct ItemKey) * ni);
+    int count = 0, total = 0;
+    int n, i, j;
+
+    for (i = 0; i < ni; i++) {
+        if (Items[i].AutoGet == NULL)
+            continue;
+        keys[count].key = Items[i].AutoGetKey & mask;
+        keys[count].item = i;
+        count++;
+    }
+    qsort(keys, count, sizeof(struct ItemKey), CompareItemKeys);
+
+    free(NounItems);
+    free(NounItemsStart);
+    free(NounItemsEnd);
+    free(ItemNouns);
+    NounItemsStart = MemAlloc(sizeof(int) * nw);
+    NounItemsEnd = MemAlloc(sizeof(int) * nw);
+    ItemNouns = MemAlloc(sizeof(int) * ni);
+
+    /* First count the items of each word, then fill them in */
+    for (int pass = 0; pass < 2; pass++) {
+        if (pass == 1)
+            NounItems = MemAlloc(sizeof(int) * (total + 1));
+        total = 0;
+        for (n = 0; n < nw; n++) {
+            int w = NounWord(n);
+            const char *word;
+            uint64_t key;
+            if (w != n) {
+                /* A synonym, which shares the items of its word */
+                NounItemsStart[n] = NounItemsStart[w];
+                NounItemsEnd[n] = NounItemsEnd[w];
+                continue;
+            }
+            word = Nouns[n];
+            if (n > 0 && *word == '*')
+                word++;
+            key = (n == 0) ? WordKey(word, 8) & mask : NounKeys[n] & mask;
+            NounItemsStart[n] = total;
+            for (j = FindItemKey(keys, count, key); j < count && keys[j].key == key; j++) {
+                if (!ItemMatchesWord(keys[j].item, word))
+                    continue;
+                if (pass == 1)
+                    NounItems[total] = keys[j].item;
+                total++;
+            }
+            NounItemsEnd[n] = total;
+        }
+    }
+
+    /* An item is taken by the first noun that matches it, as WhichWord()
+       would find it */
+    for (i = 0; i < ni; i++)
+        ItemNouns[i] = 0;
+    for (n = nw - 2; n >= 1; n--) {
+        const char *word = Nouns[n];
+        if (*word == '*')
+            word++;
+        uint64_t key = NounKeys[n] & mask;
+        int w = n;
+        while (w > 1 && *Nouns[w] == '*')
+            w--;
+        for (j = FindItemKey(keys, count, key); j < count && keys[j].key == key; j++) {
+            if (ItemMatchesWord(keys[j].item, word))
+                ItemNouns[keys[j].item] = w;
+        }
+    }
+
+    free(keys);
+}
+
+/* The items a noun stands for, in item order */
+const int *ItemsForNoun(int noun, int *count)
+{
+    if (noun < 0 || noun > GameHeader.NumWords || NounItems == NULL) {
+        *count = 0;
+        return NULL;
+    }
+    *count = NounItemsEnd[noun] - NounItemsStart[noun];
+    return &NounItems[NounItemsStart[noun]];
+}
+
+/* The noun an item is taken and dropped by, or 0 */
+int NounForItem(int item)
+{
+    if (item < 0 || item > GameHeader.NumItems || ItemNouns == NULL)
+        return 0;
+    return ItemNouns[item];
+}
+
+/* Make the keys for the game vocabulary and the system word lists. This is
+   called once the game is loaded */
+void IndexWords(void)
+{
+    int nw = GameHeader.NumWords + 1;
+
+    free(VerbKeys);
+    free(NounKeys);
+    VerbKeys = MemAlloc(sizeof(uint64_t) * nw);
+    NounKeys = MemAlloc(sizeof(uint64_t) * nw);
+    KeyList(VerbKeys, Verbs, nw);
+    KeyList(NounKeys, Nouns, nw);
+
+    KeyList(DirectionKeys, Directions, NUMBER_OF_DIRECTIONS);
+    KeyList(SkipListKeys, SkipList, NUMBER_OF_SKIPPABLE_WORDS);
+    KeyList(DelimiterKeys, DelimiterList, NUMBER_OF_DELIMITERS);
+    KeyList(ExtraCommandKeys, ExtraCommands, NUMBER_OF_EXTRA_COMMANDS);
+    KeyList(ExtraNounKeys, ExtraNouns, NUMBER_OF_EXTRA_NOUNS);
+    KeyList(AbbreviationKeys, Abbreviations, NUMBER_OF_ABBREVIATIONS);
+
+    for (int i = 0; i <= GameHeader.NumItems; i++)
+        Items[i].AutoGetKey = Items[i].AutoGet ? WordKey(Items[i].AutoGet, 8) : 0;
+
+    IndexItemNouns();
+}
+
+static const uint64_t *KeysForList(const char **list)
+{
+    if (list == Verbs)
+        return VerbKeys;
+    if (list == Nouns)
+        return NounKeys;
+    if (list == Directions)
+        return DirectionKeys;
+    if (list == SkipList)
+        return SkipListKeys;
+    if (list == DelimiterList)
+        return DelimiterKeys;
+    if (list == ExtraCommands)
+        return ExtraCommandKeys;
+    if (list == ExtraNouns)
+        return ExtraNounKeys;
+    if (list == Abbreviations)
+        return AbbreviationKeys;
+    return NULL;
+}
+
+int WhichWord(const char *word, const char **list, int word_length, int list_length)
+{
+    int n = 1;
+    int ne = 1;
+    const char *tp;
+    const uint64_t *keys = KeysForList(list);
+
+    if (keys != NULL) {
+        uint64_t key = WordKey(word, word_length);
+        uint64_t mask = KeyMask(word_length);
+        for (ne = 1; ne < list_length; ne++) {
+            if ((keys[ne] & mask) != key)
+                continue;
+            if (word_length > 8) {
+                tp = list[ne];
+                if (*tp == '*')
+                    tp++;
+                if (xstrncasecmp(word, tp, word_length) != 0)
+                    continue;
+            }
+            /* A synonym gives the word it follows */
+            for (n = ne; n > 1 && *list[n] == '*'; n--)
+                ;
+            return (n);
+        }
+        return (0);
+    }
+
+    while (ne < list_length) {
+        tp = list[ne];
+        if (*tp == '*')
+            tp++;
+        else
+            n = ne;
+        if (xstrncasecmp(word, tp, word_length) == 0)
+            return (n);
+        ne++;
+    }
+    return (0);
+}
+
 /* For the verb position in a command string sequence, we try the following
  lists in this order: Verbs, Directions, Abbreviations, SkipList, Nouns,
  ExtraCommands, Delimiters */
@@ -766,8 +1170,10 @@ static int CreateAllCommands(struct Command *command)
     /* Check if the ALL command is followed by EXCEPT */
     /* and if it is, build an array of items to be excepted */
     while (next && next->verb == GameHeader.NumWords + EXCEPT) {
+        const char *word = CharWords[next->nounwordindex];
+        uint64_t key = WordKey(word, GameHeader.WordLength);
         for (int i = 0; i <= GameHeader.NumItems; i++) {
-            if (Items[i].AutoGet && xstrncasecmp(Items[i].AutoGet, CharWords[next->nounwordindex], GameHeader.WordLength) == 0) {
+            if (Items[i].AutoGet && WordsMatch(Items[i].AutoGetKey, Items[i].AutoGet, key, word, GameHeader.WordLength)) {
                 exceptions[exceptioncount++] = i;
             }
         }
@@ -780,7 +1186,7 @@ static int CreateAllCommands(struct Command *command)
     struct Command *c = command;
     int found = 0;
     for (int i = 0; i < GameHeader.NumItems; i++) {
-        if (Items[i].AutoGet != NULL && Items[i].AutoGet[0] != '*' && Items[i].Location == location) {
+        if (Items[i].AutoGet != NULL && Items[i].AutoGet[0] != '*' && ItemLocations[i] == location) {
             int exception = 0;
             for (int j = 0; j < exceptioncount; j++) {
                 if (exceptions[j] == i) {
@@ -796,8 +1202,7 @@ static int CreateAllCommands(struct Command *command)
                 }
                 found = 1;
                 c->verb = command->verb;
-                c->noun = WhichWord(Items[i].AutoGet, Nouns, GameHeader.WordLength,
-                                    GameHeader.NumWords);
+                c->noun = NounForItem(i);
                 c->item = i;
                 c->next = NULL;
                 c->nounwordindex = 0;
@@ -837,7 +1242,7 @@ void FreeCommands(void)
 static void PrintPendingError(void)
 {
     if (FirstErrorMessage) {
-        glk_put_string_stream_uni(glk_window_get_stream(Bottom), FirstErrorMessage);
+        glk_put_string_stream_uni(Speculating ? SpeculativeOutput : glk_window_get_stream(Bottom), FirstErrorMessage);
         free(FirstErrorMessage);
         FirstErrorMessage = NULL;
         stop_time = 1;
@@ -858,6 +1263,7 @@ int GetInput(int *vb, int *no)
             return 0;
 
         CurrentCommand = CommandFromStrings(0, NULL);
+        EndPhase(PHASE_PARSE, parse_start);
     }
 
     if (CurrentCommand == NULL) {
@@ -884,7 +1290,7 @@ int GetInput(int *vb, int *no)
             if (!CreateAllCommands(CurrentCommand))
                 return 1;
         } else if (CurrentCommand->noun == IT) {
-            CurrentCommand->noun = lastnoun;
+            CurrentCommand->noun = LastNoun;
         }
     }
 
@@ -892,7 +1298,7 @@ int GetInput(int *vb, int *no)
     *no = CurrentCommand->noun;
 
     if (*no > 6) {
-        lastnoun = *no;
+        LastNoun = *no;
     }
 
     return 0;
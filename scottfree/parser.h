@@ -8,6 +8,7 @@
 #ifndef parser_h
 #define parser_h
 
+#include <stdint.h>
 #include <stdio.h>
 #include "glk.h"
 
@@ -45,11 +46,23 @@ typedef enum
 int GetInput(int *vb, int *no);
 void FreeCommands(void);
 glui32 *ToUnicode(const char *string);
+void PutTranslatedString(strid_t stream, const char *string, size_t length);
+void QueueInput(const char *lines);
+int InputPending(void);
 int RecheckForExtraCommand(void);
 int WhichWord(const char *word, const char **list, int word_length,
     int list_length);
+uint64_t WordKey(const char *word, int length);
+int WordsMatch(uint64_t key1, const char *word1, uint64_t key2,
+    const char *word2, int length);
+void IndexWords(void);
+const int *ItemsForNoun(int noun, int *count);
+int NounForItem(int item);
 
 extern glui32 **UnicodeWords;
+extern int LastNoun;
+extern int WaitingForCommand;
+extern int PromptShown;
 extern char **CharWords;
 
 #define NUMBER_OF_DIRECTIONS 14
@@ -5,13 +5,19 @@
 //  Created by Administrator on 2022-01-10.
 //
 #include <stdlib.h>
+#include <string.h>
 
 #include "restorestate.h"
 
+#include "metrics.h"
+#include "parser.h"
 #include "scott.h"
 
 #define MAX_UNDOS 100
 
+#define SESSION_MAGIC 0x53464842 /* "SFHB" */
+#define SESSION_VERSION 1
+
 extern int CurrentCounter;
 extern int RoomSaved[]; /* Range unknown */
 
@@ -41,11 +47,8 @@ struct SavedState *SaveCurrentState(void)
     s->LightTime = GameHeader.LightTime;
     s->AutoInventory = AutoInventory;
 
-    s->ItemLocations = MemAlloc(GameHeader.NumItems + 1);
-
-    for (int ct = 0; ct <= GameHeader.NumItems; ct++) {
-        s->ItemLocations[ct] = Items[ct].Location;
-    }
+    s->ItemLocations = MemAlloc(sizeof(uint16_t) * (GameHeader.NumItems + 1));
+    memcpy(s->ItemLocations, ItemLocations, sizeof(uint16_t) * (GameHeader.NumItems + 1));
 
     s->previousState = NULL;
     s->nextState = NULL;
@@ -75,13 +78,42 @@ void RestoreState(struct SavedState *state)
     GameHeader.LightTime = state->LightTime;
     AutoInventory = state->AutoInventory;
 
-    for (int ct = 0; ct <= GameHeader.NumItems; ct++) {
-        Items[ct].Location = state->ItemLocations[ct];
-    }
+    SetItemLocations(state->ItemLocations);
 
     stop_time = 1;
 }
 
+static uint64_t HashValue(uint64_t hash, int32_t value)
+{
+    for (int i = 0; i < 4; i++) {
+        hash ^= (uint8_t)(value >> (8 * i));
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+/* A 64-bit FNV-1a hash of everything a saved state holds, the same on
+   every machine, so that clients can tell whether two games have got to
+   the same place */
+uint64_t StateHash(void)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+
+    for (int ct = 0; ct < 16; ct++) {
+        hash = HashValue(hash, Counters[ct]);
+        hash = HashValue(hash, RoomSaved[ct]);
+    }
+    hash = HashValue(hash, (int32_t)BitFlags);
+    hash = HashValue(hash, MyLoc);
+    hash = HashValue(hash, CurrentCounter);
+    hash = HashValue(hash, SavedRoom);
+    hash = HashValue(hash, GameHeader.LightTime);
+    hash = HashValue(hash, AutoInventory);
+    for (int i = 0; i <= GameHeader.NumItems; i++)
+        hash = HashValue(hash, ItemLocations[i]);
+    return hash;
+}
+
 void SaveUndo(void)
 {
     if (just_undid) {
@@ -125,6 +157,7 @@ void RestoreUndo(void)
     }
     struct SavedState *current = last_undo;
     last_undo = current->previousState;
+    last_undo->nextState = NULL;
     if (last_undo->previousState == NULL)
         oldest_undo = last_undo;
     RestoreState(last_undo);
@@ -133,6 +166,7 @@ void RestoreUndo(void)
     free(current);
     number_of_undos--;
     just_undid = 1;
+    CountMetric(METRIC_UNDOS, 1);
 }
 
 void RamSave(void)
@@ -144,6 +178,7 @@ void RamSave(void)
 
     ramsave = SaveCurrentState();
     Output(sys[STATE_SAVED]);
+    CountMetric(METRIC_SAVES, 1);
 }
 
 void RamRestore(void)
@@ -155,5 +190,205 @@ void RamRestore(void)
 
     RestoreState(ramsave);
     Output(sys[STATE_RESTORED]);
+    CountMetric(METRIC_RESTORES, 1);
     SaveUndo();
 }
+
+/* Writing and reading all the states at once, for putting an idle session
+   to sleep. Only the items that are not where they started are written
+   for each state, since in most states most items have not moved. The
+   data is meant to be read back by the same program on the same machine,
+   so it is in native byte order. */
+
+static void WriteInt(FILE *f, int32_t value)
+{
+    fwrite(&value, sizeof(value), 1, f);
+}
+
+static int ReadInt(FILE *f, int32_t *value)
+{
+    return (fread(value, sizeof(*value), 1, f) == 1);
+}
+
+static void WriteState(FILE *f, const struct SavedState *s)
+{
+    int32_t moved = 0;
+    int ct;
+
+    for (ct = 0; ct < 16; ct++) {
+        WriteInt(f, s->Counters[ct]);
+        WriteInt(f, s->RoomSaved[ct]);
+    }
+    WriteInt(f, (int32_t)s->BitFlags);
+    WriteInt(f, s->CurrentLoc);
+    WriteInt(f, s->CurrentCounter);
+    WriteInt(f, s->SavedRoom);
+    WriteInt(f, s->LightTime);
+    WriteInt(f, s->AutoInventory);
+
+    for (ct = 0; ct <= GameHeader.NumItems; ct++)
+        if (s->ItemLocations[ct] != InitialLocations[ct])
+            moved++;
+    WriteInt(f, moved);
+    for (ct = 0; ct <= GameHeader.NumItems; ct++) {
+        if (s->ItemLocations[ct] != InitialLocations[ct]) {
+            WriteInt(f, ct);
+            fwrite(&s->ItemLocations[ct], sizeof(uint16_t), 1, f);
+        }
+    }
+}
+
+static struct SavedState *ReadState(FILE *f)
+{
+    struct SavedState *s = MemAlloc(sizeof(struct SavedState));
+    int32_t value[6], moved, item;
+    int ct, ok = 1;
+
+    for (ct = 0; ct < 16; ct++) {
+        ok = ok && ReadInt(f, &value[0]) && ReadInt(f, &value[1]);
+        s->Counters[ct] = value[0];
+        s->RoomSaved[ct] = value[1];
+    }
+    for (ct = 0; ct < 6; ct++)
+        ok = ok && ReadInt(f, &value[ct]);
+    s->BitFlags = (uint32_t)value[0];
+    s->CurrentLoc = value[1];
+    s->CurrentCounter = value[2];
+    s->SavedRoom = value[3];
+    s->LightTime = value[4];
+    s->AutoInventory = value[5];
+
+    s->ItemLocations = MemAlloc(sizeof(uint16_t) * (GameHeader.NumItems + 1));
+    memcpy(s->ItemLocations, InitialLocations, sizeof(uint16_t) * (GameHeader.NumItems + 1));
+    ok = ok && ReadInt(f, &moved);
+    for (ct = 0; ok && ct < moved; ct++) {
+        ok = ReadInt(f, &item) && item >= 0 && item <= GameHeader.NumItems
+            && fread(&s->ItemLocations[item], sizeof(uint16_t), 1, f) == 1;
+    }
+
+    s->previousState = NULL;
+    s->nextState = NULL;
+
+    if (!ok) {
+        free(s->ItemLocations);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+/* The current state, then the RAM save slot, then the undo history from
+   the oldest state on */
+void WriteAllStates(FILE *f)
+{
+    struct SavedState *current = SaveCurrentState();
+    struct SavedState *s;
+
+    WriteState(f, current);
+    free(current->ItemLocations);
+    free(current);
+
+    WriteInt(f, ramsave != NULL);
+    if (ramsave != NULL)
+        WriteState(f, ramsave);
+
+    WriteInt(f, number_of_undos);
+    WriteInt(f, just_undid);
+    for (s = oldest_undo; s != NULL; s = s->nextState)
+        WriteState(f, s);
+}
+
+static void FreeStates(struct SavedState *s)
+{
+    while (s != NULL) {
+        struct SavedState *next = s->nextState;
+        free(s->ItemLocations);
+        free(s);
+        s = next;
+    }
+}
+
+/* Returns 0 if the data is damaged. Nothing is changed unless everything
+   could be read. */
+int ReadAllStates(FILE *f)
+{
+    struct SavedState *current, *saved = NULL, *s, *previous = NULL, *oldest = NULL;
+    int32_t hasramsave = 0, undos = 0, undid = 0;
+    int ct, ok;
+
+    current = ReadState(f);
+    ok = (current != NULL && ReadInt(f, &hasramsave));
+    if (ok && hasramsave) {
+        saved = ReadState(f);
+        ok = (saved != NULL);
+    }
+    ok = ok && ReadInt(f, &undos) && ReadInt(f, &undid) && undos >= 0 && undos <= MAX_UNDOS;
+    for (ct = 0; ok && ct < undos; ct++) {
+        s = ReadState(f);
+        if (s == NULL) {
+            ok = 0;
+            break;
+        }
+        s->previousState = previous;
+        if (previous != NULL)
+            previous->nextState = s;
+        else
+            oldest = s;
+        previous = s;
+    }
+    /* The states end the file, so anything after them means more were
+       written than counted */
+    ok = ok && getc(f) == EOF;
+
+    if (!ok) {
+        FreeStates(current);
+        FreeStates(saved);
+        FreeStates(oldest);
+        return 0;
+    }
+
+    if (saved != NULL) {
+        FreeStates(ramsave);
+        ramsave = saved;
+    }
+    FreeStates(oldest_undo);
+    oldest_undo = oldest;
+    last_undo = previous;
+    number_of_undos = undos;
+
+    RestoreState(current);
+    FreeStates(current);
+    just_undid = undid;
+    return 1;
+}
+
+/* Everything needed to carry on a session from the command prompt: a
+   header for the game and what the main loop keeps, then all the states.
+   The caller can store one number of its own in the header. */
+void WriteSession(FILE *f, int32_t extra)
+{
+    int32_t header[10] = { SESSION_MAGIC, SESSION_VERSION, GameHeader.NumItems,
+        GameHeader.NumRooms, GameHeader.NumActions, GameHeader.NumWords,
+        just_started, stop_time, LastNoun, extra };
+    fwrite(header, sizeof(header), 1, f);
+    WriteAllStates(f);
+}
+
+/* Returns 0 if the data is damaged or from another game */
+int ReadSession(FILE *f, int32_t *extra)
+{
+    int32_t header[10];
+
+    if (fread(header, sizeof(header), 1, f) != 1 || header[0] != SESSION_MAGIC
+        || header[1] != SESSION_VERSION || header[2] != GameHeader.NumItems
+        || header[3] != GameHeader.NumRooms || header[4] != GameHeader.NumActions
+        || header[5] != GameHeader.NumWords || !ReadAllStates(f))
+        return 0;
+
+    just_started = header[6];
+    stop_time = header[7];
+    LastNoun = header[8];
+    if (extra != NULL)
+        *extra = header[9];
+    return 1;
+}
@@ -20,7 +20,7 @@ struct SavedState {
     int SavedRoom;
     int LightTime;
     int AutoInventory;
-    uint8_t *ItemLocations;
+    uint16_t *ItemLocations;
     struct SavedState *previousState;
     struct SavedState *nextState;
 };
@@ -32,5 +32,10 @@ void RamRestore(void);
 struct SavedState *SaveCurrentState(void);
 void RestoreState(struct SavedState *state);
 void RecoverFromBadRestore(struct SavedState *state);
+void WriteAllStates(FILE *f);
+int ReadAllStates(FILE *f);
+void WriteSession(FILE *f, int32_t extra);
+int ReadSession(FILE *f, int32_t *extra);
+uint64_t StateHash(void);
 
 #endif /* restorestate_h */
@@ -44,9 +44,16 @@
 #include "glk.h"
 #include "glkstart.h"
 
+#include "coverage.h"
 #include "detectgame.h"
+#include "journal.h"
+#include "jsonapi.h"
+#include "latency.h"
 #include "layouttext.h"
+#include "metrics.h"
 #include "restorestate.h"
+#include "sessionhost.h"
+#include "speculate.h"
 
 #include "TI99_4a_terp.h"
 #include "parser.h"
@@ -59,17 +66,31 @@ extern glui32 gli_determinism;
 #endif
 
 static const char *game_file;
+static const char *listen_path = NULL;
+static int idle_seconds = 0;
+static int cache_megabytes = 0;
+static const char *journal_path = NULL;
+static const char *metrics_path = NULL;
+static const char *coverage_path = NULL;
+/* Set by -r, so that the same commands always give the same output */
+static const char *random_seed = NULL;
 
 Header GameHeader;
 Item *Items;
+/* Item locations, up to CARRIED, in arrays of their own, so that scans over
+   all items only read two bytes per item */
+uint16_t *ItemLocations;
+uint16_t *InitialLocations;
 Room *Rooms;
 const char **Verbs;
 const char **Nouns;
 const char **Messages;
 Action *Actions;
+WideAction *WideActions;
 int LightRefill;
 int Counters[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }; /* Range unknown */
 int CurrentCounter;
+int CarriedLocation = CLASSIC_CARRIED;
 int SavedRoom;
 int RoomSaved[16] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 }; /* Range unknown */
 int AutoInventory = 0;
@@ -103,6 +124,9 @@ static int print_look_to_transcript = 0;
 static int pause_next_room_description = 0;
 
 static int split_screen = 1;
+
+/* Bumped by MoveItem() whenever an item changes location */
+static unsigned long items_moved = 0;
 winid_t Bottom, Top;
 winid_t Graphics;
 
@@ -122,22 +146,38 @@ static int YesOrNo(void);
 
 static int PerformActions(int vb, int no);
 
+static void WriteToWindow(winid_t w, const char *text, size_t length)
+{
+    /* The player has seen all this before the game was recovered. The
+       upper window is still drawn, as it is not redrawn unless the room
+       has changed. */
+    if (Replaying && w == Bottom && w != Top)
+        return;
+    /* Only the main window's text of a command that is tried is kept */
+    if (Speculating) {
+        if (w == Bottom)
+            PutTranslatedString(SpeculativeOutput, text, length);
+        return;
+    }
+    CountMetric(METRIC_RENDERED_BYTES, length);
+    PutTranslatedString(glk_window_get_stream(w), text, length);
+    if (Transcript)
+        PutTranslatedString(Transcript, text, length);
+}
+
 void Display(winid_t w, const char *fmt, ...)
 {
+    /* Kept between calls, so that formatting only allocates until the
+       buffer has grown to fit the longest message */
+    static TextBuilder msg = { NULL, 0, 0 };
     va_list ap;
-    char msg[2048];
-
-    int size = sizeof msg;
 
+    ClearText(&msg);
     va_start(ap, fmt);
-    vsnprintf(msg, size, fmt, ap);
+    AppendTextV(&msg, fmt, ap);
     va_end(ap);
 
-    glui32 *unistring = ToUnicode(msg);
-    glk_put_string_stream_uni(glk_window_get_stream(w), unistring);
-    if (Transcript)
-        glk_put_string_stream_uni(Transcript, unistring);
-    free(unistring);
+    WriteToWindow(w, msg.text, msg.length);
 }
 
 void Updates(event_t ev)
@@ -149,9 +189,18 @@ void Updates(event_t ev)
     }
 }
 
+/* Returns 1 if another command is to be run straight after this one, so
+   that anything drawn now would only be drawn over */
+static int MoreCommandsPending(void)
+{
+    if (!(Options & PIPELINE))
+        return 0;
+    return (CurrentCommand && CurrentCommand->next) || InputPending();
+}
+
 void Delay(float seconds)
 {
-    if (Options & NO_DELAYS)
+    if ((Options & NO_DELAYS) || Replaying || Speculating || MoreCommandsPending())
         return;
     event_t ev;
 
@@ -206,6 +255,7 @@ static void OpenTopWindow(void)
 long BitFlags = 0; /* Might be >32 flags - I haven't seen >32 yet */
 
 static void CleanupAndExit(void) {
+    CloseJournal();
     if (Transcript)
         glk_stream_close(Transcript, NULL);
     glk_exit();
@@ -219,7 +269,8 @@ void Fatal(const char *x)
 
 static void ClearScreen(void)
 {
-    glk_window_clear(Bottom);
+    if (!Speculating)
+        glk_window_clear(Bottom);
 }
 
 void *MemAlloc(int size)
@@ -227,12 +278,14 @@ void *MemAlloc(int size)
     void *t = (void *)malloc(size);
     if (t == NULL)
         Fatal("Out of memory");
+    CountMetric(METRIC_ALLOCATIONS, 1);
+    CountMetric(METRIC_ALLOCATED_BYTES, size);
     return (t);
 }
 
 int RandomPercent(int n)
 {
-    unsigned int rv = rand() << 6;
+    unsigned int rv = (Speculating ? rand_r(&SpeculativeSeed) : rand()) << 6;
     rv %= 100;
     if (rv < n)
         return (1);
@@ -241,14 +294,7 @@ int RandomPercent(int n)
 
 int CountCarried(void)
 {
-    int ct = 0;
-    int n = 0;
-    while (ct <= GameHeader.NumItems) {
-        if (Items[ct].Location == CARRIED)
-            n++;
-        ct++;
-    }
-    return (n);
+    return CountItemsAt(CARRIED);
 }
 
 const char *MapSynonym(int noun)
@@ -271,50 +317,77 @@ const char *MapSynonym(int noun)
 
 static int MatchUpItem(int noun, int loc)
 {
-    const char *word = MapSynonym(noun);
-    int ct = 0;
-
-    if (word == NULL)
-        word = Nouns[noun];
+    int count;
+    const int *items = ItemsForNoun(noun, &count);
 
-    while (ct <= GameHeader.NumItems) {
-        if (Items[ct].AutoGet && (loc == 0 || Items[ct].Location == loc) &&
-            xstrncasecmp(Items[ct].AutoGet, word, GameHeader.WordLength) == 0)
-            return (ct);
-        ct++;
+    for (int ct = 0; ct < count; ct++) {
+        if (loc == 0 || ItemLocations[items[ct]] == loc)
+            return (items[ct]);
     }
     return (-1);
 }
 
-static char *ReadString(FILE *f)
+/* The text database is read from memory. These do the same as the fscanf()
+   and fgetc() calls they replace, without the per-call overhead */
+struct DatabaseScanner {
+    const uint8_t *pos;
+    const uint8_t *end;
+    char *strings; /* Where the next string is to be stored */
+};
+
+/* All the strings of the database, one after another */
+static char *database_strings = NULL;
+
+static int ScanNumber(struct DatabaseScanner *s, int *value)
 {
-    char tmp[1024];
-    char *t;
-    int c, nc;
-    int ct = 0;
-    do {
-        c = fgetc(f);
-    } while (c != EOF && isspace((unsigned char)c));
-    if (c != '"') {
+    const uint8_t *p = s->pos;
+    int negative = 0;
+    unsigned int n = 0;
+
+    while (p < s->end && isspace(*p))
+        p++;
+    s->pos = p;
+    if (p < s->end && (*p == '-' || *p == '+')) {
+        negative = (*p == '-');
+        p++;
+    }
+    if (p >= s->end || !isdigit(*p))
+        return 0;
+    while (p < s->end && isdigit(*p))
+        n = n * 10 + (*p++ - '0');
+    s->pos = p;
+    *value = negative ? -(int)n : (int)n;
+    return 1;
+}
+
+static char *ReadString(struct DatabaseScanner *s)
+{
+    const uint8_t *p = s->pos;
+    char *start = s->strings;
+    char *t = start;
+    int c;
+
+    while (p < s->end && isspace(*p))
+        p++;
+    if (p >= s->end || *p != '"') {
         Fatal("Initial quote expected");
     }
+    p++;
     do {
-        c = fgetc(f);
-        if (c == EOF)
+        if (p >= s->end)
             Fatal("EOF in string");
+        c = *p++;
         if (c == '"') {
-            nc = fgetc(f);
-            if (nc != '"') {
-                ungetc(nc, f);
+            if (p >= s->end || *p != '"')
                 break;
-            }
+            p++;
         }
         if (c == '`')
             c = '"'; /* pdd */
 
         /* Ensure a valid Glk newline is sent. */
         if (c == '\n')
-            tmp[ct++] = 10;
+            *t++ = 10;
         /* Special case: assume CR is part of CRLF in a
          * DOS-formatted file, and ignore it.
          */
@@ -325,14 +398,14 @@ static char *ReadString(FILE *f)
          * assume that Scott Adams games are ASCII only.
          */
         else if ((c >= 32 && c <= 126))
-            tmp[ct++] = c;
+            *t++ = c;
         else
-            tmp[ct++] = '?';
+            *t++ = '?';
     } while (1);
-    tmp[ct] = 0;
-    t = MemAlloc(ct + 1);
-    memcpy(t, tmp, ct + 1);
-    return (t);
+    *t++ = 0;
+    s->pos = p;
+    s->strings = t;
+    return start;
 }
 
 size_t GetFileLength(FILE *in)
@@ -344,41 +417,116 @@ size_t GetFileLength(FILE *in)
     if (length == -1) {
         return 0;
     }
-    fseek(in, SEEK_SET, 0);
+    fseek(in, 0, SEEK_SET);
     return length;
 }
 
 int header[24];
 
+/* Lines of the action table by verb, in table order. The lines for verb
+   vb are ActionIndex[ActionIndexStart[vb]] up to, but not including,
+   ActionIndex[ActionIndexStart[vb + 1]], so that running a command only
+   visits the lines that can match it */
+static int *ActionIndex = NULL;
+static int *ActionIndexStart = NULL;
+static int ActionIndexVerbs = 0;
+
+static void IndexActions(void)
+{
+    int ct, vb;
+
+    /* Verbs above NumWords can't be typed, so in extended games their
+       lines are left out. Classic ones cover every 16 bit vocab value */
+    ActionIndexVerbs = MAX(GameHeader.NumWords, 0xFFFF / 150) + 1;
+    ActionIndexStart = MemAlloc(sizeof(int) * (ActionIndexVerbs + 1));
+    ActionIndex = MemAlloc(sizeof(int) * (GameHeader.NumActions + 1));
+    memset(ActionIndexStart, 0, sizeof(int) * (ActionIndexVerbs + 1));
+
+    for (ct = 0; ct <= GameHeader.NumActions; ct++) {
+        vb = ActionVocab(ct) / 150;
+        if (vb < ActionIndexVerbs)
+            ActionIndexStart[vb]++;
+    }
+    for (vb = 1; vb <= ActionIndexVerbs; vb++)
+        ActionIndexStart[vb] += ActionIndexStart[vb - 1];
+
+    /* Each start now points past the end of its list. Filling the lists
+       from the back moves it to the first line */
+    for (ct = GameHeader.NumActions; ct >= 0; ct--) {
+        vb = ActionVocab(ct) / 150;
+        if (vb < ActionIndexVerbs)
+            ActionIndex[--ActionIndexStart[vb]] = ct;
+    }
+}
+
 static void FreeDatabase(void)
 {
     free(Items);
+    free(ItemLocations);
+    free(InitialLocations);
     free(Actions);
+    Actions = NULL;
+    free(WideActions);
+    WideActions = NULL;
     free(Verbs);
     free(Nouns);
     free(Rooms);
     free(Messages);
+    free(database_strings);
+    database_strings = NULL;
+    free(ActionIndex);
+    ActionIndex = NULL;
+    free(ActionIndexStart);
+    ActionIndexStart = NULL;
+    CarriedLocation = CLASSIC_CARRIED;
 }
 
-int LoadDatabase(FILE *f, int loud)
+int LoadDatabase(const uint8_t *data, size_t length, int loud)
 {
     int ni, na, nw, nr, mc, pr, tr, wl, lt, mn, trm;
     int ct;
-    short lo;
-    Action *ap;
+    int n[12];
     Room *rp;
     Item *ip;
+    struct DatabaseScanner s = { data, data + length, NULL };
     /* Load the header */
 
-    if (fscanf(f, "%*d %d %d %d %d %d %d %d %d %d %d %d",
-            &ni, &na, &nw, &nr, &mc, &pr, &tr, &wl, &lt, &mn, &trm)
-        < 10) {
+    /* The first number is ignored, and the treasure room may be missing */
+    for (ct = 0; ct < 12 && ScanNumber(&s, &n[ct]); ct++)
+        ;
+    if (ct < 11) {
         return 0;
     }
+    ni = n[1];
+    na = n[2];
+    nw = n[3];
+    nr = n[4];
+    mc = n[5];
+    pr = n[6];
+    tr = n[7];
+    wl = n[8];
+    lt = n[9];
+    mn = n[10];
+    trm = (ct == 12) ? n[11] : 0;
+
+    if (nr > MAX_ROOMS || ni < 0 || na < 0 || nw < 0 || nr < 0 || mn < 0) {
+        return 0;
+    }
+    CarriedLocation = (nr >= CLASSIC_CARRIED) ? EXTENDED_CARRIED : CLASSIC_CARRIED;
+
+    /* No string can be longer than the quoted text it is read from,
+       so they all fit in the length of the file */
+    database_strings = MemAlloc(length + 1);
+    s.strings = database_strings;
     GameHeader.NumItems = ni;
     Items = (Item *)MemAlloc(sizeof(Item) * (ni + 1));
+    ItemLocations = MemAlloc(sizeof(uint16_t) * (ni + 1));
+    InitialLocations = MemAlloc(sizeof(uint16_t) * (ni + 1));
     GameHeader.NumActions = na;
-    Actions = (Action *)MemAlloc(sizeof(Action) * (na + 1));
+    if (CARRIED == CLASSIC_CARRIED)
+        Actions = (Action *)MemAlloc(sizeof(Action) * (na + 1));
+    else
+        WideActions = (WideAction *)MemAlloc(sizeof(WideAction) * (na + 1));
     GameHeader.NumWords = nw;
     GameHeader.WordLength = wl;
     Verbs = MemAlloc(sizeof(char *) * (nw + 1));
@@ -411,37 +559,44 @@ int LoadDatabase(FILE *f, int loud)
     /* Load the actions */
 
     ct = 0;
-    ap = Actions;
     if (loud)
         fprintf(stderr, "Reading %d actions.\n", na);
     while (ct < na + 1) {
-        if (fscanf(f, "%hu %hu %hu %hu %hu %hu %hu %hu",
-                &ap->Vocab,
-                &ap->Condition[0],
-                &ap->Condition[1],
-                &ap->Condition[2],
-                &ap->Condition[3],
-                &ap->Condition[4],
-                &ap->Subcommand[0],
-                &ap->Subcommand[1])
-            != 8) {
+        int i;
+        for (i = 0; i < 8 && ScanNumber(&s, &n[i]); i++)
+            ;
+        if (i != 8) {
             fprintf(stderr, "Bad action line (%d)\n", ct);
             FreeDatabase();
             return 0;
         }
+        if (WideActions) {
+            WideAction *wp = &WideActions[ct];
+            wp->Vocab = n[0];
+            for (i = 0; i < 5; i++)
+                wp->Condition[i] = n[i + 1];
+            wp->Subcommand[0] = n[6];
+            wp->Subcommand[1] = n[7];
+        } else {
+            Action *ap = &Actions[ct];
+            ap->Vocab = n[0];
+            for (i = 0; i < 5; i++)
+                ap->Condition[i] = n[i + 1];
+            ap->Subcommand[0] = n[6];
+            ap->Subcommand[1] = n[7];
+        }
 
         if (loud) {
-            fprintf(stderr, "Action %d Vocab: %d (%d/%d)\n", ct, ap->Vocab, ap->Vocab % 150, ap->Vocab / 150);
-            fprintf(stderr, "Action %d Condition[0]: %d (%d/%d)\n", ct, ap->Condition[0], ap->Condition[0] % 20, ap->Condition[0] / 20);
-            fprintf(stderr, "Action %d Condition[1]: %d (%d/%d)\n", ct, ap->Condition[1], ap->Condition[1] % 20, ap->Condition[1] / 20);
-            fprintf(stderr, "Action %d Condition[2]: %d (%d/%d)\n", ct, ap->Condition[2], ap->Condition[2] % 20, ap->Condition[2] / 20);
-            fprintf(stderr, "Action %d Condition[0]: %d (%d/%d)\n", ct, ap->Condition[3], ap->Condition[3] % 20, ap->Condition[3] / 20);
-            fprintf(stderr, "Action %d Condition[0]: %d (%d/%d)\n", ct, ap->Condition[4], ap->Condition[4] % 20, ap->Condition[4] / 20);
-            fprintf(stderr, "Action %d Subcommand[0]: %d\n", ct, ap->Subcommand[0]);
-            fprintf(stderr, "Action %d Subcommand[1]: %d\n\n", ct, ap->Subcommand[1]);
+            int vocab = ActionVocab(ct);
+            fprintf(stderr, "Action %d Vocab: %d (%d/%d)\n", ct, vocab, vocab % 150, vocab / 150);
+            for (i = 0; i < 5; i++) {
+                int cond = ActionCondition(ct, i);
+                fprintf(stderr, "Action %d Condition[%d]: %d (%d/%d)\n", ct, i, cond, cond % 20, cond / 20);
+            }
+            fprintf(stderr, "Action %d Subcommand[0]: %d\n", ct, ActionSubcommand(ct, 0));
+            fprintf(stderr, "Action %d Subcommand[1]: %d\n\n", ct, ActionSubcommand(ct, 1));
         }
 
-        ap++;
         ct++;
     }
 
@@ -449,8 +604,8 @@ int LoadDatabase(FILE *f, int loud)
     if (loud)
         fprintf(stderr, "Reading %d word pairs.\n", nw);
     while (ct < nw + 1) {
-        Verbs[ct] = ReadString(f);
-        Nouns[ct] = ReadString(f);
+        Verbs[ct] = ReadString(&s);
+        Nouns[ct] = ReadString(&s);
         ct++;
     }
     ct = 0;
@@ -458,16 +613,16 @@ int LoadDatabase(FILE *f, int loud)
     if (loud)
         fprintf(stderr, "Reading %d rooms.\n", nr);
     while (ct < nr + 1) {
-        if (fscanf(f, "%hd %hd %hd %hd %hd %hd",
-                &rp->Exits[0], &rp->Exits[1], &rp->Exits[2],
-                &rp->Exits[3], &rp->Exits[4], &rp->Exits[5])
-            != 6) {
+        int i;
+        for (i = 0; i < 6 && ScanNumber(&s, &n[i]); i++)
+            rp->Exits[i] = n[i];
+        if (i != 6) {
             fprintf(stderr, "Bad room line (%d)\n", ct);
             FreeDatabase();
             return 0;
         }
 
-        rp->Text = ReadString(f);
+        rp->Text = ReadString(&s);
         if (loud)
             fprintf(stderr, "Room %d: \"%s\"\n", ct, rp->Text);
         if (loud) {
@@ -484,7 +639,7 @@ int LoadDatabase(FILE *f, int loud)
     if (loud)
         fprintf(stderr, "Reading %d messages.\n", mn);
     while (ct < mn + 1) {
-        Messages[ct] = ReadString(f);
+        Messages[ct] = ReadString(&s);
         if (loud)
             fprintf(stderr, "Message %d: \"%s\"\n", ct, Messages[ct]);
         ct++;
@@ -494,7 +649,7 @@ int LoadDatabase(FILE *f, int loud)
         fprintf(stderr, "Reading %d items.\n", ni);
     ip = Items;
     while (ct < ni + 1) {
-        ip->Text = ReadString(f);
+        ip->Text = ReadString(&s);
         if (loud)
             fprintf(stderr, "Item %d: \"%s\"\n", ct, ip->Text);
         ip->AutoGet = strchr(ip->Text, '/');
@@ -506,26 +661,28 @@ int LoadDatabase(FILE *f, int loud)
             if (t != NULL)
                 *t = 0;
         }
-        if (fscanf(f, "%hd", &lo) != 1) {
+        if (!ScanNumber(&s, &n[0])) {
             fprintf(stderr, "Bad item line (%d)\n", ct);
             FreeDatabase();
             return 0;
         }
-        ip->Location = (unsigned char)lo;
+        ItemLocations[ct] = n[0] & CARRIED;
         if (loud)
-            fprintf(stderr, "Location of item %d: %d, \"%s\"\n", ct, ip->Location,
-                ip->Location == CARRIED ? "CARRIED" : Rooms[ip->Location].Text);
-        ip->InitialLoc = ip->Location;
+            fprintf(stderr, "Location of item %d: %d, \"%s\"\n", ct, ItemLocations[ct],
+                ItemLocations[ct] == CARRIED ? "CARRIED" : Rooms[ItemLocations[ct]].Text);
         ip++;
         ct++;
     }
+    memcpy(InitialLocations, ItemLocations, sizeof(uint16_t) * (ni + 1));
     ct = 0;
     /* Discard Comment Strings */
+    char *comment = s.strings;
     while (ct < na + 1) {
-        free(ReadString(f));
+        ReadString(&s);
+        s.strings = comment;
         ct++;
     }
-    if (fscanf(f, "%d", &ct) != 1) {
+    if (!ScanNumber(&s, &ct)) {
         fprintf(stderr, "Cannot read version\n");
         FreeDatabase();
         return 0;
@@ -533,7 +690,7 @@ int LoadDatabase(FILE *f, int loud)
     if (loud)
         fprintf(stderr, "Version %d.%02d of Adventure \n",
             ct / 100, ct % 100);
-    if (fscanf(f, "%d", &ct) != 1) {
+    if (!ScanNumber(&s, &ct)) {
         fprintf(stderr, "Cannot read adventure number\n");
         FreeDatabase();
         return 0;
@@ -541,25 +698,44 @@ int LoadDatabase(FILE *f, int loud)
     if (loud)
         fprintf(stderr, "%d.\nLoad Complete.\n\n", ct);
 
-    fclose(f);
+    IndexActions();
     return SCOTTFREE;
 }
 
 void Output(const char *a)
 {
-    Display(Bottom, "%s", a);
+    WriteToWindow(Bottom, a, strlen(a));
 }
 
 void OutputNumber(int a)
 {
-    Display(Bottom, "%d", a);
+    char buf[16];
+    int length = snprintf(buf, sizeof buf, "%d", a);
+    WriteToWindow(Bottom, buf, length);
 }
 
 #if defined(__clang__)
 #pragma mark Room description
 #endif
 
-static strid_t room_description_stream = NULL;
+/* Kept from one look to the next, so that it only allocates until it has
+   grown to fit the longest room description */
+static TextBuilder room_description = { NULL, 0, 0 };
+
+/* What the upper window currently shows. If none of this has changed
+   since it was drawn, Look() leaves the window alone */
+static struct {
+    int valid;
+    winid_t window;
+    glui32 width, height;
+    int room;
+    int dark;
+    int inventory;
+    unsigned long items_moved;
+} drawn_room;
+
+/* Set when Look() only builds the description for the transcript */
+static int skip_drawing_room = 0;
 
 static void WriteToRoomDescriptionStream(const char *fmt, ...)
 #ifdef __GNUC__
@@ -569,16 +745,16 @@ __attribute__((__format__(__printf__, 1, 2)))
 
 static void WriteToRoomDescriptionStream(const char *fmt, ...)
 {
-    if (room_description_stream == NULL)
-        return;
     va_list ap;
-    char msg[2048];
 
     va_start(ap, fmt);
-    vsnprintf(msg, sizeof msg, fmt, ap);
+    AppendTextV(&room_description, fmt, ap);
     va_end(ap);
+}
 
-    glk_put_string_stream(room_description_stream, msg);
+static void WriteStringToRoomDescription(const char *s)
+{
+    AppendString(&room_description, s);
 }
 
 static void PrintWindowDelimiter(void)
@@ -607,15 +783,15 @@ static void ListExitsSpectrumStyle(void)
             if (f == 0) {
                 WriteToRoomDescriptionStream("\n\n%s", sys[EXITS]);
             } else {
-                WriteToRoomDescriptionStream("%s", sys[EXITS_DELIMITER]);
+                WriteStringToRoomDescription(sys[EXITS_DELIMITER]);
             }
             /* sys[] begins with the exit names */
-            WriteToRoomDescriptionStream("%s", sys[ct]);
+            WriteStringToRoomDescription(sys[ct]);
             f = 1;
         }
         ct++;
     }
-    WriteToRoomDescriptionStream("\n");
+    WriteStringToRoomDescription("\n");
     return;
 }
 
@@ -629,22 +805,35 @@ static void ListExits(void)
     while (ct < 6) {
         if ((&Rooms[MyLoc])->Exits[ct] != 0) {
             if (f) {
-                WriteToRoomDescriptionStream("%s", sys[EXITS_DELIMITER]);
+                WriteStringToRoomDescription(sys[EXITS_DELIMITER]);
             }
             /* sys[] begins with the exit names */
-            WriteToRoomDescriptionStream("%s", sys[ct]);
+            WriteStringToRoomDescription(sys[ct]);
             f = 1;
         }
         ct++;
     }
     if (f == 0)
-        WriteToRoomDescriptionStream("%s", sys[NONE]);
+        WriteStringToRoomDescription(sys[NONE]);
     return;
 }
 
-static void FlushRoomDescription(char *buf)
+/* Write the room description to the transcript only, for a look that
+   isn't drawn */
+static void TranscribeRoomDescription(void)
+{
+    LineBreakText(&room_description, TopWidth);
+    PutTranslatedString(Transcript, room_description.text, room_description.length);
+    if (room_description.length && room_description.text[room_description.length - 1] != '\n')
+        glk_put_char_stream(Transcript, '\n');
+}
+
+static void FlushRoomDescription(void)
 {
-    glk_stream_close(room_description_stream, 0);
+    if (skip_drawing_room) {
+        TranscribeRoomDescription();
+        return;
+    }
 
     strid_t StoredTranscript = Transcript;
     if (!print_look_to_transcript)
@@ -655,16 +844,23 @@ static void FlushRoomDescription(char *buf)
     if (split_screen) {
         glk_window_clear(Top);
         glk_window_get_size(Top, &TopWidth, &TopHeight);
-        int rows, length;
-        char *text_with_breaks = LineBreakText(buf, TopWidth, &rows, &length);
+        int rows = LineBreakText(&room_description, TopWidth);
+        const char *text_with_breaks = room_description.text;
+        int length = (int)room_description.length;
 
         glui32 bottomheight;
         glk_window_get_size(Bottom, NULL, &bottomheight);
         winid_t o2 = glk_window_get_parent(Top);
-        if (!(bottomheight < 3 && TopHeight < rows)) {
-            glk_window_get_size(Top, &TopWidth, &TopHeight);
-            glk_window_set_arrangement(o2, winmethod_Above | winmethod_Fixed, rows,
-                Top);
+        int resize = !(bottomheight < 3 && TopHeight < rows);
+        if (resize) {
+            /* Only grow the window here. Any shrinking is done below, once
+               we know how many lines were printed, so that the lower window
+               isn't pushed down and pulled back up on every look */
+            if (TopHeight < rows) {
+                glk_window_set_arrangement(o2, winmethod_Above | winmethod_Fixed,
+                    rows, Top);
+                glk_window_get_size(Top, &TopWidth, &TopHeight);
+            }
         } else {
             print_delimiter = 0;
         }
@@ -672,7 +868,7 @@ static void FlushRoomDescription(char *buf)
         int line = 0;
         int index = 0;
         int i;
-        char string[TopWidth + 1];
+        char string[TopWidth + 2];
         for (line = 0; line < rows && index < length; line++) {
             for (i = 0; i < TopWidth; i++) {
                 string[i] = text_with_breaks[index++];
@@ -686,18 +882,24 @@ static void FlushRoomDescription(char *buf)
             if (strlen(string) == 0)
                 break;
             glk_window_move_cursor(Top, 0, line);
-            Display(Top, "%s", string);
+            WriteToWindow(Top, string, i);
         }
 
-        if (line < rows - 1) {
-            glk_window_get_size(Top, &TopWidth, &TopHeight);
+        glui32 newheight = resize ? rows : TopHeight;
+        if (line < rows - 1)
+            newheight = MIN(rows - 1, newheight - 1);
+        if (newheight != TopHeight) {
             glk_window_set_arrangement(o2, winmethod_Above | winmethod_Fixed,
-                MIN(rows - 1, TopHeight - 1), Top);
+                newheight, Top);
+            glk_window_get_size(Top, &TopWidth, &TopHeight);
         }
 
-        free(text_with_breaks);
+        drawn_room.window = Top;
+        drawn_room.width = TopWidth;
+        drawn_room.height = TopHeight;
+        drawn_room.valid = 1;
     } else {
-        Display(Bottom, "%s", buf);
+        WriteToWindow(Bottom, room_description.text, room_description.length);
     }
 
     if (print_delimiter) {
@@ -710,10 +912,6 @@ static void FlushRoomDescription(char *buf)
     }
 
     Transcript = StoredTranscript;
-    if (buf != NULL) {
-        free(buf);
-        buf = NULL;
-    }
 }
 
 static int ItemEndsWithPeriod(int item)
@@ -736,19 +934,19 @@ static void ListInventoryInUpperWindow(void)
     int lastitem = -1;
     WriteToRoomDescriptionStream("\n%s", sys[INVENTORY]);
     while (i <= GameHeader.NumItems) {
-        if (Items[i].Location == CARRIED) {
+        if (ItemLocations[i] == CARRIED) {
             if (Items[i].Text[0] == 0) {
                 fprintf(stderr, "Invisible item in inventory: %d\n", i);
                 i++;
                 continue;
             }
             if (lastitem > -1 && (Options & (TRS80_STYLE | SPECTRUM_STYLE)) == 0) {
-                WriteToRoomDescriptionStream("%s", sys[ITEM_DELIMITER]);
+                WriteStringToRoomDescription(sys[ITEM_DELIMITER]);
             }
             lastitem = i;
-            WriteToRoomDescriptionStream("%s", Items[i].Text);
+            WriteStringToRoomDescription(Items[i].Text);
             if (Options & (TRS80_STYLE | SPECTRUM_STYLE)) {
-                WriteToRoomDescriptionStream("%s", sys[ITEM_DELIMITER]);
+                WriteStringToRoomDescription(sys[ITEM_DELIMITER]);
             }
         }
         i++;
@@ -757,32 +955,76 @@ static void ListInventoryInUpperWindow(void)
         WriteToRoomDescriptionStream("%s\n", sys[NOTHING]);
     } else {
         if (Options & TI994A_STYLE && !ItemEndsWithPeriod(lastitem))
-            WriteToRoomDescriptionStream(".");
-        WriteToRoomDescriptionStream("\n");
+            WriteStringToRoomDescription(".");
+        WriteStringToRoomDescription("\n");
     }
 }
 
+static int IsDark(void)
+{
+    return (BitFlags & (1 << DARKBIT)) && ItemLocations[LIGHT_SOURCE] != CARRIED && ItemLocations[LIGHT_SOURCE] != MyLoc;
+}
+
+/* Returns 1 if the upper window already shows what Look() would draw */
+static int RoomIsDrawn(int dark)
+{
+    glui32 width, height;
+
+    if (!drawn_room.valid || drawn_room.window != Top)
+        return 0;
+    /* A look that goes to the transcript has to be printed again */
+    if (Transcript && print_look_to_transcript)
+        return 0;
+
+    glk_window_get_size(Top, &width, &height);
+    return (width == drawn_room.width && height == drawn_room.height
+        && MyLoc == drawn_room.room && dark == drawn_room.dark
+        && AutoInventory == drawn_room.inventory
+        && items_moved == drawn_room.items_moved);
+}
+
 void Look(void)
 {
-    if (split_screen && Top == NULL)
+    if ((split_screen && Top == NULL) || Speculating)
         return;
 
-    char *buf = MemAlloc(1000);
-    buf = memset(buf, 0, 1000);
-    room_description_stream = glk_stream_open_memory(buf, 1000, filemode_Write, 0);
+    int dark = IsDark();
+
+    skip_drawing_room = 0;
+    if (split_screen) {
+        if (MoreCommandsPending()) {
+            /* Don't draw a room that will be drawn over straight away,
+               but keep the transcript complete */
+            pause_next_room_description = 0;
+            if (!(Transcript && print_look_to_transcript))
+                return;
+            skip_drawing_room = 1;
+        } else if (RoomIsDrawn(dark)) {
+            pause_next_room_description = 0;
+            return;
+        } else {
+            drawn_room.valid = 0;
+            drawn_room.room = MyLoc;
+            drawn_room.dark = dark;
+            drawn_room.inventory = AutoInventory;
+            drawn_room.items_moved = items_moved;
+        }
+    }
+
+    ClearText(&room_description);
 
     Room *r;
     int ct, f;
 
     if (!split_screen) {
-        WriteToRoomDescriptionStream("\n");
+        WriteStringToRoomDescription("\n");
     } else if (Transcript && print_look_to_transcript) {
         glk_put_char_stream_uni(Transcript, 10);
     }
 
-    if ((BitFlags & (1 << DARKBIT)) && Items[LIGHT_SOURCE].Location != CARRIED && Items[LIGHT_SOURCE].Location != MyLoc) {
-        WriteToRoomDescriptionStream("%s", sys[TOO_DARK_TO_SEE]);
-        FlushRoomDescription(buf);
+    if (dark) {
+        WriteStringToRoomDescription(sys[TOO_DARK_TO_SEE]);
+        FlushRoomDescription();
         return;
     }
 
@@ -793,55 +1035,55 @@ void Look(void)
     /* An initial asterisk means the room description should not */
     /* start with "You are" or equivalent */
     if (*r->Text == '*') {
-        WriteToRoomDescriptionStream("%s", r->Text + 1);
+        WriteStringToRoomDescription(r->Text + 1);
     } else {
         WriteToRoomDescriptionStream("%s%s", sys[YOU_ARE], r->Text);
     }
 
     if (!(Options & SPECTRUM_STYLE)) {
         ListExits();
-        WriteToRoomDescriptionStream(".\n");
+        WriteStringToRoomDescription(".\n");
     }
 
     ct = 0;
     f = 0;
     while (ct <= GameHeader.NumItems) {
-        if (Items[ct].Location == MyLoc) {
+        if (ItemLocations[ct] == MyLoc) {
             if (Items[ct].Text[0] == 0) {
                 fprintf(stderr, "Invisible item in room: %d\n", ct);
                 ct++;
                 continue;
             }
             if (f == 0) {
-                WriteToRoomDescriptionStream("%s", sys[YOU_SEE]);
+                WriteStringToRoomDescription(sys[YOU_SEE]);
                 f++;
                 if (Options & SPECTRUM_STYLE)
-                    WriteToRoomDescriptionStream("\n");
+                    WriteStringToRoomDescription("\n");
             } else if (!(Options & (TRS80_STYLE | SPECTRUM_STYLE))) {
-                WriteToRoomDescriptionStream("%s", sys[ITEM_DELIMITER]);
+                WriteStringToRoomDescription(sys[ITEM_DELIMITER]);
             }
-            WriteToRoomDescriptionStream("%s", Items[ct].Text);
+            WriteStringToRoomDescription(Items[ct].Text);
             if (Options & (TRS80_STYLE | SPECTRUM_STYLE)) {
-                WriteToRoomDescriptionStream("%s", sys[ITEM_DELIMITER]);
+                WriteStringToRoomDescription(sys[ITEM_DELIMITER]);
             }
         }
         ct++;
     }
 
     if ((Options & TI994A_STYLE) && f) {
-        WriteToRoomDescriptionStream("%s", ".");
+        WriteStringToRoomDescription(".");
     }
 
     if (Options & SPECTRUM_STYLE) {
         ListExitsSpectrumStyle();
     } else if (f) {
-        WriteToRoomDescriptionStream("\n");
+        WriteStringToRoomDescription("\n");
     }
 
     if (AutoInventory)
         ListInventoryInUpperWindow();
 
-    FlushRoomDescription(buf);
+    FlushRoomDescription();
 }
 
 void SaveGame(void)
@@ -851,6 +1093,12 @@ void SaveGame(void)
     int ct;
     char buf[128];
 
+    /* Saved when it was first typed */
+    if (Replaying)
+        return;
+    if (Speculating)
+        StopSpeculation(SPECULATION_FILE);
+
     ref = glk_fileref_create_by_prompt(fileusage_TextMode | fileusage_SavedGame, filemode_Write, 0);
     if (ref == NULL)
         return;
@@ -864,16 +1112,17 @@ void SaveGame(void)
         snprintf(buf, sizeof buf, "%d %d\n", Counters[ct], RoomSaved[ct]);
         glk_put_string_stream(file, buf);
     }
-    snprintf(buf, sizeof buf, "%ld %d %hd %d %d %hd %d\n", BitFlags, (BitFlags & (1 << DARKBIT)) ? 1 : 0,
+    snprintf(buf, sizeof buf, "%ld %d %d %d %d %d %d\n", BitFlags, (BitFlags & (1 << DARKBIT)) ? 1 : 0,
         MyLoc, CurrentCounter, SavedRoom, GameHeader.LightTime, AutoInventory);
     glk_put_string_stream(file, buf);
     for (ct = 0; ct <= GameHeader.NumItems; ct++) {
-        snprintf(buf, sizeof buf, "%hd\n", (short)Items[ct].Location);
+        snprintf(buf, sizeof buf, "%d\n", ItemLocations[ct]);
         glk_put_string_stream(file, buf);
     }
 
     glk_stream_close(file, NULL);
     Output(sys[SAVED]);
+    CountMetric(METRIC_SAVES, 1);
 }
 
 static void LoadGame(void)
@@ -882,11 +1131,16 @@ static void LoadGame(void)
     frefid_t ref;
     char buf[128];
     int ct = 0;
-    short lo;
-    short DarkFlag;
+    int lo;
+    int DarkFlag;
 
     int PreviousAutoInventory = AutoInventory;
 
+    /* There is a checkpoint after every restore, so this is only reached
+       if the game stopped before it could be written */
+    if (Replaying)
+        return;
+
     ref = glk_fileref_create_by_prompt(fileusage_TextMode | fileusage_SavedGame, filemode_Read, 0);
     if (ref == NULL)
         return;
@@ -909,7 +1163,7 @@ static void LoadGame(void)
         }
     }
     glk_get_line_stream(file, buf, sizeof buf);
-    result = sscanf(buf, "%ld %hd %hd %d %d %hd %d\n",
+    result = sscanf(buf, "%ld %d %d %d %d %d %d\n",
         &BitFlags, &DarkFlag, &MyLoc, &CurrentCounter, &SavedRoom,
         &GameHeader.LightTime, &AutoInventory);
     if (result == 6)
@@ -924,9 +1178,9 @@ static void LoadGame(void)
         BitFlags |= (1 << 15);
     for (ct = 0; ct <= GameHeader.NumItems; ct++) {
         glk_get_line_stream(file, buf, sizeof buf);
-        result = sscanf(buf, "%hd\n", &lo);
-        Items[ct].Location = (unsigned char)lo;
-        if (result != 1 || (Items[ct].Location > GameHeader.NumRooms && Items[ct].Location != CARRIED)) {
+        result = sscanf(buf, "%d\n", &lo);
+        MoveItem(ct, lo);
+        if (result != 1 || (ItemLocations[ct] > GameHeader.NumRooms && ItemLocations[ct] != CARRIED)) {
             RecoverFromBadRestore(state);
             return;
         }
@@ -943,12 +1197,18 @@ static void LoadGame(void)
     SaveUndo();
     just_started = 0;
     stop_time = 1;
+    CheckpointSoon();
+    CountMetric(METRIC_RESTORES, 1);
 }
 
 static void LoadInputRecording(void)
 {
     frefid_t ref;
 
+    /* Its commands are in the journal */
+    if (Replaying)
+        return;
+
     ref = glk_fileref_create_by_prompt(fileusage_TextMode | fileusage_InputRecord, filemode_Read, 0);
     if (ref == NULL)
         return;
@@ -996,6 +1256,10 @@ static void TranscriptOn(void)
         return;
     }
 
+    /* A recovered game starts without one */
+    if (Replaying)
+        return;
+
     ref = glk_fileref_create_by_prompt(fileusage_TextMode | fileusage_Transcript, filemode_Write, 0);
     if (ref == NULL)
         return;
@@ -1032,6 +1296,9 @@ static void TranscriptOff(void)
 
 int PerformExtraCommand(int extra_stop_time)
 {
+    if (Speculating)
+        StopSpeculation(SPECULATION_UNTRIED);
+
     struct Command command = *CurrentCommand;
     int verb = command.verb;
     if (verb > GameHeader.NumWords)
@@ -1118,8 +1385,25 @@ int PerformExtraCommand(int extra_stop_time)
     return 0;
 }
 
+/* Waits for the key press requested in Bottom. When a game is being
+   recovered, the key comes from the journal instead. */
+static void SelectKeyPress(event_t *ev)
+{
+    if (ReplayChar(&ev->val1)) {
+        glk_cancel_char_event(Bottom);
+        ev->type = evtype_CharInput;
+        ev->win = Bottom;
+        return;
+    }
+    glk_select(ev);
+    if (ev->type == evtype_CharInput)
+        JournalChar(ev->val1);
+}
+
 static int YesOrNo(void)
 {
+    if (Speculating)
+        StopSpeculation(SPECULATION_KEY);
     glk_request_char_event(Bottom);
 
     event_t ev;
@@ -1128,7 +1412,7 @@ static int YesOrNo(void)
     const char n = tolower((unsigned char)sys[NO][0]);
 
     do {
-        glk_select(&ev);
+        SelectKeyPress(&ev);
         if (ev.type == evtype_CharInput) {
             const char reply = tolower(ev.val1);
             if (reply == y) {
@@ -1148,12 +1432,14 @@ static int YesOrNo(void)
 
 static void HitEnter(void)
 {
+    if (Speculating)
+        StopSpeculation(SPECULATION_KEY);
     glk_request_char_event(Bottom);
 
     event_t ev;
     int result = 0;
     do {
-        glk_select(&ev);
+        SelectKeyPress(&ev);
         if (ev.type == evtype_CharInput) {
             if (ev.val1 == keycode_Return) {
                 result = 1;
@@ -1174,7 +1460,7 @@ void ListInventory(void)
     int lastitem = -1;
     Output(sys[INVENTORY]);
     while (i <= GameHeader.NumItems) {
-        if (Items[i].Location == CARRIED) {
+        if (ItemLocations[i] == CARRIED) {
             if (Items[i].Text[0] == 0) {
                 fprintf(stderr, "Invisible item in inventory: %d\n", i);
                 i++;
@@ -1223,19 +1509,26 @@ void DoneIt(void)
     if (YesOrNo()) {
         should_restart = 1;
     } else {
+        DeleteJournal();
         CleanupAndExit();
     }
 }
 
-int PrintScore(void)
+int CountStoredTreasures(void)
 {
     int i = 0;
     int n = 0;
     while (i <= GameHeader.NumItems) {
-        if (Items[i].Location == GameHeader.TreasureRoom && *Items[i].Text == '*')
+        if (ItemLocations[i] == GameHeader.TreasureRoom && *Items[i].Text == '*')
             n++;
         i++;
     }
+    return n;
+}
+
+int PrintScore(void)
+{
+    int n = CountStoredTreasures();
     Display(Bottom, "%s %d %s%s %d.\n", sys[IVE_STORED], n, sys[TREASURES],
             sys[ON_A_SCALE_THAT_RATES], (n * 100) / GameHeader.Treasures);
     if (n == GameHeader.Treasures) {
@@ -1249,14 +1542,56 @@ int PrintScore(void)
 void PrintNoun(void)
 {
     if (CurrentCommand)
-        glk_put_string_stream_uni(glk_window_get_stream(Bottom),
+        glk_put_string_stream_uni(Speculating ? SpeculativeOutput : glk_window_get_stream(Bottom),
             UnicodeWords[CurrentCommand->nounwordindex]);
 }
 
+/* All changes to item locations go through here, so that Look() can tell
+   when the upper window needs drawing again, and so that a command that
+   is only tried can be taken back */
+void MoveItem(int item, int location)
+{
+    /* CARRIED is all ones, so this keeps only the low byte in classic
+       games (where -1 and 255 both mean carried) and the low 16 bits in
+       extended ones */
+    location &= CARRIED;
+    if (ItemLocations[item] != location) {
+        if (Speculating)
+            LogItemMove(item);
+        ItemLocations[item] = location;
+        items_moved++;
+    }
+}
+
+/* Written as a plain loop over the location array with no early exit,
+   so that the compiler can vectorize it */
+int CountItemsAt(int location)
+{
+    const uint16_t *lp = ItemLocations;
+    int ct, n = 0;
+    for (ct = 0; ct <= GameHeader.NumItems; ct++)
+        n += (lp[ct] == location);
+    return n;
+}
+
+/* Set all item locations at once, as when restoring a saved state */
+void SetItemLocations(const uint16_t *locations)
+{
+    size_t size = sizeof(uint16_t) * (GameHeader.NumItems + 1);
+    if (memcmp(ItemLocations, locations, size) != 0) {
+        if (Speculating)
+            for (int i = 0; i <= GameHeader.NumItems; i++)
+                if (ItemLocations[i] != locations[i])
+                    LogItemMove(i);
+        memcpy(ItemLocations, locations, size);
+        items_moved++;
+    }
+}
+
 void MoveItemAToLocOfItemB(int itemA, int itemB)
 {
-    Items[itemA].Location = Items[itemB].Location;
-    if (Items[itemB].Location == MyLoc)
+    MoveItem(itemA, ItemLocations[itemB]);
+    if (ItemLocations[itemB] == MyLoc)
         should_look_in_transcript = 1;
 }
 
@@ -1286,10 +1621,10 @@ void SwapLocAndRoomflag(int index)
 
 void SwapItemLocations(int itemA, int itemB)
 {
-    int temp = Items[itemA].Location;
-    Items[itemA].Location = Items[itemB].Location;
-    Items[itemB].Location = temp;
-    if (Items[itemA].Location == MyLoc || Items[itemB].Location == MyLoc)
+    int temp = ItemLocations[itemA];
+    MoveItem(itemA, ItemLocations[itemB]);
+    MoveItem(itemB, temp);
+    if (ItemLocations[itemA] == MyLoc || ItemLocations[itemB] == MyLoc)
         should_look_in_transcript = 1;
 }
 
@@ -1300,9 +1635,9 @@ void PutItemAInRoomB(int itemA, int roomB)
             itemA, Items[arg1].Text, roomB, Rooms[roomB].Text, MyLoc,
             Rooms[MyLoc].Text);
 #endif
-    if (Items[itemA].Location == MyLoc)
+    if (ItemLocations[itemA] == MyLoc)
         LookWithPause();
-    Items[itemA].Location = roomB;
+    MoveItem(itemA, roomB);
 }
 
 void SwapCounters(int index)
@@ -1362,9 +1697,10 @@ static ActionResultType PerformLine(int ct)
     int p;
     int act[4];
     int cc = 0;
+    CoverLine(ct);
     while (cc < 5) {
         int cv, dv;
-        cv = Actions[ct].Condition[cc];
+        cv = ActionCondition(ct, cc);
         dv = cv / 20;
         cv %= 20;
 #ifdef DEBUG_ACTIONS
@@ -1378,127 +1714,127 @@ static ActionResultType PerformLine(int ct)
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Does the player carry %s?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location != CARRIED)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] != CARRIED)
+                return CoverFailure(ct, cv);
             break;
         case 2:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s in location?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location != MyLoc)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] != MyLoc)
+                return CoverFailure(ct, cv);
             break;
         case 3:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s held or in location?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location != CARRIED && Items[dv].Location != MyLoc)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] != CARRIED && ItemLocations[dv] != MyLoc)
+                return CoverFailure(ct, cv);
             break;
         case 4:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is location %s?\n", Rooms[dv].Text);
 #endif
             if (MyLoc != dv)
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         case 5:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s NOT in location?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location == MyLoc)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] == MyLoc)
+                return CoverFailure(ct, cv);
             break;
         case 6:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Does the player NOT carry %s?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location == CARRIED)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] == CARRIED)
+                return CoverFailure(ct, cv);
             break;
         case 7:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is location NOT %s?\n", Rooms[dv].Text);
 #endif
             if (MyLoc == dv)
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         case 8:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is bitflag %d set?\n", dv);
 #endif
             if ((BitFlags & (1 << dv)) == 0)
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         case 9:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is bitflag %d NOT set?\n", dv);
 #endif
             if (BitFlags & (1 << dv))
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         case 10:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Does the player carry anything?\n");
 #endif
             if (CountCarried() == 0)
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         case 11:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Does the player carry nothing?\n");
 #endif
             if (CountCarried())
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         case 12:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s neither carried nor in room?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location == CARRIED || Items[dv].Location == MyLoc)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] == CARRIED || ItemLocations[dv] == MyLoc)
+                return CoverFailure(ct, cv);
             break;
         case 13:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s (%d) in play?\n", Items[dv].Text, dv);
 #endif
-            if (Items[dv].Location == 0)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] == 0)
+                return CoverFailure(ct, cv);
             break;
         case 14:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s NOT in play?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location)
-                return ACT_FAILURE;
+            if (ItemLocations[dv])
+                return CoverFailure(ct, cv);
             break;
         case 15:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is CurrentCounter <= %d?\n", dv);
 #endif
             if (CurrentCounter > dv)
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         case 16:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is CurrentCounter > %d?\n", dv);
 #endif
             if (CurrentCounter <= dv)
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         case 17:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Is %s still in initial room?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location != Items[dv].InitialLoc)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] != InitialLocations[dv])
+                return CoverFailure(ct, cv);
             break;
         case 18:
 #ifdef DEBUG_ACTIONS
             fprintf(stderr, "Has %s been moved?\n", Items[dv].Text);
 #endif
-            if (Items[dv].Location == Items[dv].InitialLoc)
-                return ACT_FAILURE;
+            if (ItemLocations[dv] == InitialLocations[dv])
+                return CoverFailure(ct, cv);
             break;
         case 19: /* Only seen in Brian Howarth games so far */
 #ifdef DEBUG_ACTIONS
@@ -1507,12 +1843,13 @@ static ActionResultType PerformLine(int ct)
                 fprintf(stderr, "Nope, current counter is %d\n", CurrentCounter);
 #endif
             if (CurrentCounter != dv)
-                return ACT_FAILURE;
+                return CoverFailure(ct, cv);
             break;
         }
 #ifdef DEBUG_ACTIONS
         fprintf(stderr, "YES\n");
 #endif
+        CoverCondition(ct, cv);
         cc++;
     }
 #if defined(__clang__)
@@ -1520,8 +1857,8 @@ static ActionResultType PerformLine(int ct)
 #endif
 
     /* Actions */
-    act[0] = Actions[ct].Subcommand[0];
-    act[2] = Actions[ct].Subcommand[1];
+    act[0] = ActionSubcommand(ct, 0);
+    act[2] = ActionSubcommand(ct, 1);
     act[1] = act[0] % 150;
     act[3] = act[2] % 150;
     act[0] /= 150;
@@ -1532,6 +1869,7 @@ static ActionResultType PerformLine(int ct)
 #ifdef DEBUG_ACTIONS
         fprintf(stderr, "Performing action %d: ", act[cc]);
 #endif
+        CoverCommand(ct, act[cc] == 0 ? NOT_A_COMMAND : act[cc]);
         if (act[cc] >= 1 && act[cc] < 52) {
             PrintMessage(act[cc]);
         } else if (act[cc] > 101) {
@@ -1545,13 +1883,13 @@ static ActionResultType PerformLine(int ct)
                     Output(sys[YOURE_CARRYING_TOO_MUCH]);
                     return ACT_SUCCESS;
                 }
-                Items[param[pptr++]].Location = CARRIED;
+                MoveItem(param[pptr++], CARRIED);
                 break;
             case 53:
 #ifdef DEBUG_ACTIONS
                 fprintf(stderr, "item %d (\"%s\") is now in location.\n", param[pptr], Items[param[pptr]].Text);
 #endif
-                Items[param[pptr++]].Location = MyLoc;
+                MoveItem(param[pptr++], MyLoc);
                 should_look_in_transcript = 1;
                 break;
             case 54:
@@ -1566,7 +1904,7 @@ static ActionResultType PerformLine(int ct)
 #ifdef DEBUG_ACTIONS
                 fprintf(stderr, "Item %d (%s) is removed from the game (put in room 0).\n", param[pptr], Items[param[pptr]].Text);
 #endif
-                Items[param[pptr++]].Location = 0;
+                MoveItem(param[pptr++], 0);
                 break;
             case 56:
                 BitFlags |= 1 << DARKBIT;
@@ -1584,7 +1922,7 @@ static ActionResultType PerformLine(int ct)
 #ifdef DEBUG_ACTIONS
                 fprintf(stderr, "Item %d (%s) is removed from play.\n", param[pptr], Items[param[pptr]].Text);
 #endif
-                Items[param[pptr++]].Location = 0;
+                MoveItem(param[pptr++], 0);
                 break;
             case 60:
 #ifdef DEBUG_ACTIONS
@@ -1624,7 +1962,7 @@ static ActionResultType PerformLine(int ct)
                 break;
             case 69:
                 GameHeader.LightTime = LightRefill;
-                Items[LIGHT_SOURCE].Location = CARRIED;
+                MoveItem(LIGHT_SOURCE, CARRIED);
                 BitFlags &= ~(1 << LIGHTOUTBIT);
                 break;
             case 70:
@@ -1645,7 +1983,7 @@ static ActionResultType PerformLine(int ct)
                 continuation = 1;
                 break;
             case 74:
-                Items[param[pptr++]].Location = CARRIED;
+                MoveItem(param[pptr++], CARRIED);
                 break;
             case 75:
                 p = param[pptr++];
@@ -1776,7 +2114,7 @@ static ExplicitResultType PerformActions(int vb, int no)
     }
     if (vb == 1 && no >= 1 && no <= 6) {
         int nl;
-        if (Items[LIGHT_SOURCE].Location == MyLoc || Items[LIGHT_SOURCE].Location == CARRIED)
+        if (ItemLocations[LIGHT_SOURCE] == MyLoc || ItemLocations[LIGHT_SOURCE] == CARRIED)
             dark = 0;
         if (dark)
             Output(sys[DANGEROUS_TO_MOVE_IN_DARK]);
@@ -1809,49 +2147,53 @@ static ExplicitResultType PerformActions(int vb, int no)
     }
     flag = ER_RAN_ALL_LINES_NO_MATCH;
     if (CurrentGame != TI994A) {
-        while (ct <= GameHeader.NumActions) {
+        int *line = ActionIndex, *last = ActionIndex;
+        if (vb >= 0 && vb < ActionIndexVerbs) {
+            line = &ActionIndex[ActionIndexStart[vb]];
+            last = &ActionIndex[ActionIndexStart[vb + 1]];
+        }
+        for (; line < last; line++) {
             int verbvalue, nounvalue;
-            verbvalue = Actions[ct].Vocab;
+            ct = *line;
             /* Think this is now right. If a line we run has an action73
-               run all following lines with vocab of 0,0 */
-            if (vb != 0 && (doagain && verbvalue != 0))
-                break;
-            /* Oops.. added this minor cockup fix 1.11 */
-            if (vb != 0 && !doagain && flag == 0)
-                break;
+               run all following lines with vocab of 0,0. Any line between
+               this one and the last that isn't one of those ends that */
+            if (line > ActionIndex + ActionIndexStart[vb] && (line[-1] != ct - 1 || ActionVocab(ct) != 0))
+                doagain = 0;
+            verbvalue = ActionVocab(ct);
             nounvalue = verbvalue % 150;
             verbvalue /= 150;
-            if ((verbvalue == vb) || (doagain && Actions[ct].Vocab == 0)) {
-                if ((verbvalue == 0 && RandomPercent(nounvalue)) || doagain || (verbvalue != 0 && (nounvalue == no || nounvalue == 0))) {
-                    if (verbvalue == vb && vb != 0 && nounvalue == no)
-                        found_match = 1;
-                    ActionResultType flag2;
-                    if (flag == ER_RAN_ALL_LINES_NO_MATCH)
-                        flag = ER_RAN_ALL_LINES;
-                    if ((flag2 = PerformLine(ct)) != ACT_FAILURE) {
-                        /* ahah finally figured it out ! */
-                        flag = ER_SUCCESS;
-                        if (flag2 == ACT_CONTINUE)
-                            doagain = 1;
-                        else if (flag2 == ACT_GAMEOVER)
-                            return ER_SUCCESS;
-                        if (vb != 0 && doagain == 0)
-                            return ER_SUCCESS;
-                    }
+            if ((verbvalue == 0 && RandomPercent(nounvalue)) || doagain || (verbvalue != 0 && (nounvalue == no || nounvalue == 0))) {
+                if (vb != 0 && nounvalue == no)
+                    found_match = 1;
+                ActionResultType flag2;
+                if (flag == ER_RAN_ALL_LINES_NO_MATCH)
+                    flag = ER_RAN_ALL_LINES;
+                if ((flag2 = PerformLine(ct)) != ACT_FAILURE) {
+                    /* ahah finally figured it out ! */
+                    flag = ER_SUCCESS;
+                    if (flag2 == ACT_CONTINUE)
+                        doagain = 1;
+                    else if (flag2 == ACT_GAMEOVER)
+                        return ER_SUCCESS;
+                    if (vb != 0 && doagain == 0)
+                        return ER_SUCCESS;
                 }
             }
+            /* Oops.. added this minor cockup fix 1.11 */
+            if (vb != 0 && flag == ER_SUCCESS)
+                break;
+        }
 
-            ct++;
-
-            /* Previously this did not check ct against
-             * GameHeader.NumActions and would read past the end of
-             * Actions.  I don't know what should happen on the last
-             * action, but doing nothing is better than reading one
-             * past the end.
-             * --Chris
-             */
-            if (ct <= GameHeader.NumActions && Actions[ct].Vocab != 0)
-                doagain = 0;
+        /* The lines of vocab 0,0 that follow a command line are not in its
+           list. They are run one after the other until the next line with
+           a vocab. Like all lines of verb 0, each gets a random number */
+        if (vb != 0 && doagain) {
+            for (ct++; ct <= GameHeader.NumActions && ActionVocab(ct) == 0; ct++) {
+                RandomPercent(0);
+                if (PerformLine(ct) == ACT_GAMEOVER)
+                    return ER_SUCCESS;
+            }
         }
     } else {
         if (vb == 0) {
@@ -1867,7 +2209,7 @@ static ExplicitResultType PerformActions(int vb, int no)
 
     if (flag != ER_SUCCESS) {
         int item = 0;
-        if (Items[LIGHT_SOURCE].Location == MyLoc || Items[LIGHT_SOURCE].Location == CARRIED)
+        if (ItemLocations[LIGHT_SOURCE] == MyLoc || ItemLocations[LIGHT_SOURCE] == CARRIED)
             dark = 0;
 #if defined(__clang__)
 #pragma mark TAKE
@@ -1885,10 +2227,10 @@ static ExplicitResultType PerformActions(int vb, int no)
                 int location = CARRIED;
                 if (vb == TAKE)
                     location = MyLoc;
-                while (Items[item].Location != location && !(CurrentCommand->allflag & LASTALL)) {
+                while (ItemLocations[item] != location && !(CurrentCommand->allflag & LASTALL)) {
                     CurrentCommand = CurrentCommand->next;
                 }
-                if (Items[item].Location != location)
+                if (ItemLocations[item] != location)
                     return ER_SUCCESS;
             }
 
@@ -1918,7 +2260,7 @@ static ExplicitResultType PerformActions(int vb, int no)
                     }
                     return ER_SUCCESS;
                 }
-                Items[item].Location = CARRIED;
+                MoveItem(item, CARRIED);
                 PrintTakenOrDropped(TAKEN);
                 return ER_SUCCESS;
             }
@@ -1941,7 +2283,7 @@ static ExplicitResultType PerformActions(int vb, int no)
                     }
                     return ER_SUCCESS;
                 }
-                Items[item].Location = MyLoc;
+                MoveItem(item, MyLoc);
                 PrintTakenOrDropped(DROPPED);
                 return ER_SUCCESS;
             }
@@ -1950,6 +2292,87 @@ static ExplicitResultType PerformActions(int vb, int no)
     return flag;
 }
 
+/* The explicit actions of a command and the turn that passes with it */
+static void CarryOutCommand(int vb, int no)
+{
+    ExplicitResultType result;
+    uint64_t start;
+
+    CountMetric(METRIC_TURNS, 1);
+    start = PhaseClock();
+    result = PerformActions(vb, no);
+    EndPhase(PHASE_EXPLICIT_ACTIONS, start);
+    switch (result) {
+    case ER_RAN_ALL_LINES_NO_MATCH:
+            if (!RecheckForExtraCommand()) {
+            Output(sys[I_DONT_UNDERSTAND]);
+                CountMetric(METRIC_NOT_UNDERSTOOD, 1);
+                FreeCommands();
+            }
+        break;
+    case ER_RAN_ALL_LINES:
+        Output(sys[YOU_CANT_DO_THAT_YET]);
+        CountMetric(METRIC_CANT_DO_YET, 1);
+        FreeCommands();
+        break;
+    default:
+        just_started = 0;
+    }
+
+    /* Brian Howarth games seem to use -1 for forever */
+    if (ItemLocations[LIGHT_SOURCE] != DESTROYED && GameHeader.LightTime != -1 && !stop_time) {
+        GameHeader.LightTime--;
+        if (GameHeader.LightTime < 1) {
+            BitFlags |= (1 << LIGHTOUTBIT);
+            if (ItemLocations[LIGHT_SOURCE] == CARRIED || ItemLocations[LIGHT_SOURCE] == MyLoc) {
+                Output(sys[LIGHT_HAS_RUN_OUT]);
+            }
+            if ((Options & PREHISTORIC_LAMP) || (Game->subtype & MYSTERIOUS) || CurrentGame == TI994A)
+                MoveItem(LIGHT_SOURCE, DESTROYED);
+        } else if (GameHeader.LightTime < 25) {
+            if (ItemLocations[LIGHT_SOURCE] == CARRIED || ItemLocations[LIGHT_SOURCE] == MyLoc) {
+                if ((Options & SCOTTLIGHT) || (Game->subtype & MYSTERIOUS)) {
+                    Display(Bottom, "%s %d %s\n",sys[LIGHT_RUNS_OUT_IN], GameHeader.LightTime, sys[TURNS]);
+                } else {
+                    if (GameHeader.LightTime % 5 == 0)
+                        Output(sys[LIGHT_GROWING_DIM]);
+                }
+            }
+        }
+    }
+    if (stop_time)
+        stop_time--;
+}
+
+/* Carries out the commands of a line as if the player had typed it, with
+   the implicit actions after each, and then takes it all back. Only the
+   items that moved and a few scalars have to be put back, so this is
+   cheap enough to try thousands of commands a second. The game has to be
+   waiting for a command. */
+const Speculation *WhatIf(const glui32 *line, int length)
+{
+    int vb, no;
+    int saved_stop_time = stop_time, saved_just_started = just_started;
+    int saved_look = should_look_in_transcript, saved_noun = LastNoun;
+
+    BeginSpeculation(line, length);
+    if (setjmp(SpeculationStop) == 0) {
+        while (1) {
+            if (GetInput(&vb, &no) == 1)
+                continue;
+            CarryOutCommand(vb, no);
+            if (!stop_time)
+                PerformActions(0, 0);
+        }
+    }
+    FreeCommands();
+    stop_time = saved_stop_time;
+    just_started = saved_just_started;
+    should_look_in_transcript = saved_look;
+    LastNoun = saved_noun;
+    return EndSpeculation();
+}
+
 glkunix_argumentlist_t glkunix_arguments[] = {
     { "-y", glkunix_arg_NoValue, "-y        Generate 'You are', 'You are carrying' type messages for games that use these instead (eg Robin Of Sherwood)" },
     { "-i", glkunix_arg_NoValue, "-i        Generate 'I am' type messages (default)" },
@@ -1959,6 +2382,16 @@ glkunix_argumentlist_t glkunix_arguments[] = {
     { "-p", glkunix_arg_NoValue, "-p        Use for prehistoric databases which don't use bit 16" },
     { "-w", glkunix_arg_NoValue, "-w        Disable upper window" },
     { "-n", glkunix_arg_NoValue, "-n        No delays" },
+    { "-l", glkunix_arg_ValueFollows, "-l path   Load the game once, then fork a new game for each connection to the Unix domain socket at path (for the MemGlk build). Given a directory of games instead, the first line of each connection names the game" },
+    { "-c", glkunix_arg_ValueFollows, "-c MB     With -l and a directory of games, shut down unused games once the loaded ones take more memory than this" },
+    { "-z", glkunix_arg_ValueFollows, "-z secs   With -l, put sessions that have waited this long for a command to sleep until the next one" },
+    { "-j", glkunix_arg_ValueFollows, "-j path   Journal every command to path, and if the game stops without ending, carry on from there the next time it is started with the same path" },
+    { "-m", glkunix_arg_ValueFollows, "-m path   Count turns, failed commands, undos, saves, restores, allocations and text written, and write them to path in the Prometheus text format (with -l, serve them on a Unix domain socket at path)" },
+    { "-a", glkunix_arg_NoValue, "-a        Talk to a program instead of a player: read commands as lines of JSON and answer each with one (for the MemGlk build)" },
+    { "-e", glkunix_arg_NoValue, "-e        Time each phase of every turn, and print latency histograms to stderr at exit or on SIGUSR1" },
+    { "-r", glkunix_arg_ValueFollows, "-r seed   Start the random numbers from this seed rather than the time" },
+    { "-u", glkunix_arg_ValueFollows, "-u path   Record which action lines, conditions and commands run, and add them to the coverage report at path (given a directory, to a report for each game there)" },
+    { "-b", glkunix_arg_NoValue, "-b        Batch mode: run chained, queued and recorded commands back to back, only drawing the upper window before waiting for input" },
     { "", glkunix_arg_ValueFollows, "filename    file to load" },
 
     { NULL, glkunix_arg_End, NULL }
@@ -2001,6 +2434,64 @@ int glkunix_startup_code(glkunix_startup_t *data)
             case 'n':
                 Options |= NO_DELAYS;
                 break;
+            case 'b':
+                Options |= PIPELINE;
+                break;
+            case 'e':
+                Options |= TIME_PHASES;
+                break;
+            case 'a':
+                JsonApi = 1;
+                break;
+            case 'l':
+                if (argv[2] == NULL)
+                    return 0;
+                listen_path = argv[2];
+                argv++;
+                argc--;
+                break;
+            case 'c':
+                if (argv[2] == NULL)
+                    return 0;
+                cache_megabytes = atoi(argv[2]);
+                argv++;
+                argc--;
+                break;
+            case 'j':
+                if (argv[2] == NULL)
+                    return 0;
+                journal_path = argv[2];
+                argv++;
+                argc--;
+                break;
+            case 'm':
+                if (argv[2] == NULL)
+                    return 0;
+                metrics_path = argv[2];
+                argv++;
+                argc--;
+                break;
+            case 'z':
+                if (argv[2] == NULL)
+                    return 0;
+                idle_seconds = atoi(argv[2]);
+                argv++;
+                argc--;
+                break;
+            case 'r':
+                if (argv[2] == NULL)
+                    return 0;
+                random_seed = argv[2];
+                argv++;
+                argc--;
+                break;
+            case 'u':
+                if (argv[2] == NULL)
+                    return 0;
+                coverage_path = argv[2];
+                argv++;
+                argc--;
+                break;
             }
             argv++;
             argc--;
@@ -2109,11 +2600,53 @@ void glk_main(void)
         sys[i] = dictpointer[i];
     }
 
+    if (Options & TIME_PHASES)
+        StartTimingPhases();
+
+    if (JsonApi)
+        StartJsonApi();
+
+    if (metrics_path != NULL) {
+        OpenMetrics(metrics_path, listen_path != NULL);
+        if (listen_path != NULL)
+            ServeMetrics(metrics_path);
+    }
+
+    /* Given a directory, the host only returns in a game process, which
+       loads the game its first player asked for */
+    if (listen_path != NULL && IsGameDirectory(game_file))
+        game_file = ServeCatalog(listen_path, game_file, cache_megabytes);
+
     GameIDType game_type = DetectGame(game_file);
 
     if (!game_type)
         Fatal("Unsupported game!");
 
+    const char *game_name = strrchr(game_file, '/');
+    game_name = game_name != NULL ? game_name + 1 : game_file;
+    MetricsForGame(game_name);
+    if (coverage_path != NULL)
+        StartCoverage(coverage_path, game_name);
+
+    IndexWords();
+
+    /* Everything up to here is shared by all the sessions */
+    if (listen_path != NULL)
+        ServeSessions(listen_path, idle_seconds);
+
+    /* A session woken from sleep carries on where it left off, so it skips
+       the introduction and the first turn */
+    int resuming = ResumingSession();
+
+    /* Likewise a game recovered from a journal checkpoint. The sessions of
+       a host have nowhere to keep a journal of their own. */
+    if (journal_path != NULL) {
+        if (listen_path != NULL)
+            fprintf(stderr, "Journals can't be used with -l\n");
+        else if (OpenJournal(journal_path))
+            resuming = 1;
+    }
+
     if (game_type != SCOTTFREE && game_type != TI994A) {
         Options |= SPECTRUM_STYLE;
         split_screen = 1;
@@ -2123,7 +2656,7 @@ void glk_main(void)
         split_screen = 1;
     }
 
-    if (title_screen != NULL) {
+    if (title_screen != NULL && !resuming) {
         if (split_screen)
             PrintTitleScreenGrid();
         else
@@ -2138,7 +2671,7 @@ void glk_main(void)
         TopHeight = 10;
     }
 
-    if (CurrentGame == TI994A) {
+    if (CurrentGame == TI994A && !resuming) {
         Display(Bottom, "In this adventure, you may abbreviate any word \
 by typing its first %d letters, and directions by typing \
 one letter.\n\nDo you want to restore previously saved game?\n",
@@ -2150,7 +2683,7 @@ one letter.\n\nDo you want to restore previously saved game?\n",
 
     OpenTopWindow();
 
-    if (game_type == SCOTTFREE)
+    if (game_type == SCOTTFREE && !resuming)
         Output("\
 Scott Free, A Scott Adams game driver in C.\n\
 Release 1.14, (c) 1993,1994,1995 Swansea University Computer Society.\n\
@@ -2161,24 +2694,50 @@ Distributed under the GNU software license\n\n");
         srand(1234);
     else
 #endif
-        srand((unsigned int)time(NULL));
+    if (random_seed != NULL)
+        srand(JournalSeed((unsigned int)strtoul(random_seed, NULL, 10)));
+    else
+        srand(JournalSeed((unsigned int)time(NULL) ^ SessionSeed()));
 
     initial_state = SaveCurrentState();
 
+    if (ResumingSession())
+        WakeSession();
+    else if (resuming)
+        RecoverCheckpoint();
+
     while (1) {
+        uint64_t start;
+
         glk_tick();
 
         if (should_restart)
             RestartGame();
 
-        if (!stop_time)
-            PerformActions(0, 0);
-        if (!(CurrentCommand && CurrentCommand->allflag && !(CurrentCommand->allflag & LASTALL))) {
-            print_look_to_transcript = should_look_in_transcript;
-            Look();
-            print_look_to_transcript = should_look_in_transcript = 0;
-            if (!stop_time && !should_restart)
-                SaveUndo();
+        if (resuming) {
+            /* The player has seen the room description already; only the
+               upper window is new */
+            if (Top != Bottom)
+                Look();
+            resuming = 0;
+        } else {
+            if (!stop_time) {
+                start = PhaseClock();
+                PerformActions(0, 0);
+                EndPhase(PHASE_IMPLICIT_ACTIONS, start);
+            }
+            if (!(CurrentCommand && CurrentCommand->allflag && !(CurrentCommand->allflag & LASTALL))) {
+                print_look_to_transcript = should_look_in_transcript;
+                start = PhaseClock();
+                Look();
+                EndPhase(PHASE_LOOK, start);
+                print_look_to_transcript = should_look_in_transcript = 0;
+                if (!stop_time && !should_restart) {
+                    start = PhaseClock();
+                    SaveUndo();
+                    EndPhase(PHASE_SAVE_UNDO, start);
+                }
+            }
         }
 
         if (should_restart)
@@ -2187,43 +2746,8 @@ Distributed under the GNU software license\n\n");
         if (GetInput(&vb, &no) == 1)
             continue;
 
-        switch (PerformActions(vb, no)) {
-        case ER_RAN_ALL_LINES_NO_MATCH:
-                if (!RecheckForExtraCommand()) {
-                Output(sys[I_DONT_UNDERSTAND]);
-                    FreeCommands();
-                }
-            break;
-        case ER_RAN_ALL_LINES:
-            Output(sys[YOU_CANT_DO_THAT_YET]);
-            FreeCommands();
-            break;
-        default:
-            just_started = 0;
-        }
+        CarryOutCommand(vb, no);
 
-        /* Brian Howarth games seem to use -1 for forever */
-        if (Items[LIGHT_SOURCE].Location != DESTROYED && GameHeader.LightTime != -1 && !stop_time) {
-            GameHeader.LightTime--;
-            if (GameHeader.LightTime < 1) {
-                BitFlags |= (1 << LIGHTOUTBIT);
-                if (Items[LIGHT_SOURCE].Location == CARRIED || Items[LIGHT_SOURCE].Location == MyLoc) {
-                    Output(sys[LIGHT_HAS_RUN_OUT]);
-                }
-                if ((Options & PREHISTORIC_LAMP) || (Game->subtype & MYSTERIOUS) || CurrentGame == TI994A)
-                    Items[LIGHT_SOURCE].Location = DESTROYED;
-            } else if (GameHeader.LightTime < 25) {
-                if (Items[LIGHT_SOURCE].Location == CARRIED || Items[LIGHT_SOURCE].Location == MyLoc) {
-                    if ((Options & SCOTTLIGHT) || (Game->subtype & MYSTERIOUS)) {
-                        Display(Bottom, "%s %d %s\n",sys[LIGHT_RUNS_OUT_IN], GameHeader.LightTime, sys[TURNS]);
-                    } else {
-                        if (GameHeader.LightTime % 5 == 0)
-                            Output(sys[LIGHT_GROWING_DIM]);
-                    }
-                }
-            }
-        }
-        if (stop_time)
-            stop_time--;
+        MetricsTick();
     }
 }
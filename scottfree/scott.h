@@ -21,7 +21,7 @@
 #define scott_h
 
 #define LIGHT_SOURCE 9         /* Always 9 how odd */
-#define CARRIED      255       /* Carried */
+#define CARRIED      CarriedLocation /* Carried: 255, or 65535 in extended databases */
 #define DESTROYED    0         /* Destroyed */
 #define DARKBIT      15
 #define LIGHTOUTBIT  16        /* Light gone out */
@@ -31,19 +31,26 @@
 
 #include "definitions.h"
 
+/* Databases with more rooms than fit in a byte are loaded in extended
+   mode, where item locations are 16 bit and carried is 65535 (-1 in the
+   database file) */
+#define CLASSIC_CARRIED  255
+#define EXTENDED_CARRIED 0xFFFF
+#define MAX_ROOMS        (EXTENDED_CARRIED - 1)
+
 typedef struct {
- 	short Unknown;
- 	short NumItems;
- 	short NumActions;
- 	short NumWords;		/* Smaller of verb/noun is padded to same size */
- 	short NumRooms;
- 	short MaxCarry;
- 	short PlayerRoom;
- 	short Treasures;
- 	short WordLength;
- 	short LightTime;
- 	short NumMessages;
- 	short TreasureRoom;
+ 	int Unknown;
+ 	int NumItems;
+ 	int NumActions;
+ 	int NumWords;		/* Smaller of verb/noun is padded to same size */
+ 	int NumRooms;
+ 	int MaxCarry;
+ 	int PlayerRoom;
+ 	int Treasures;
+ 	int WordLength;
+ 	int LightTime;
+ 	int NumMessages;
+ 	int TreasureRoom;
 } Header;
 
 typedef struct {
@@ -52,18 +59,32 @@ typedef struct {
 	unsigned short Subcommand[2];
 } Action;
 
+/* The actions of an extended database, whose conditions can name any room
+   or item. Only one of Actions and WideActions is loaded, so classic games
+   keep their 16 byte lines; use the macros below to read either. */
+typedef struct {
+	uint32_t Vocab;
+	uint32_t Condition[5];
+	uint16_t Subcommand[2];
+} WideAction;
+
+#define ACTION_FIELD(line, field) \
+	(WideActions ? WideActions[line].field : Actions[line].field)
+#define ActionVocab(line) ACTION_FIELD(line, Vocab)
+#define ActionCondition(line, cc) ACTION_FIELD(line, Condition[cc])
+#define ActionSubcommand(line, n) ACTION_FIELD(line, Subcommand[n])
+
 typedef struct {
     char *Text;
-	short Exits[6];
+	uint16_t Exits[6];
     uint8_t Image;
 } Room;
 
 typedef struct {
     char *Text;
-	/* PORTABILITY WARNING: THESE TWO MUST BE 8 BIT VALUES. */
-    uint8_t Location;
-    uint8_t InitialLoc;
+	/* Locations are kept apart in ItemLocations[] and InitialLocations[] */
 	char *AutoGet;
+	uint64_t AutoGetKey; /* See WordKey() */
     uint8_t Flag;
     uint8_t Image;
 } Item;
@@ -83,6 +104,8 @@ typedef struct {
 #define SPECTRUM_STYLE 32    /* Display in style used on ZX Spectrum */
 #define TI994A_STYLE 64     /* Display in style used on TI-99/4A */
 #define NO_DELAYS 128     /* Skip all pauses */
+#define PIPELINE 256      /* Run queued commands back to back, drawing the upper window only before waiting for input */
+#define TIME_PHASES 512   /* Keep latency histograms of each phase of a turn */
 
 #define MAX_GAMEFILE_SIZE 200000
 
@@ -106,7 +129,7 @@ void ListInventory(void);
 void Delay(float seconds);
 size_t GetFileLength(FILE *in);
 void *MemAlloc(int size);
-int LoadDatabase(FILE *f, int loud);
+int LoadDatabase(const uint8_t *data, size_t length, int loud);
 void Updates(event_t ev);
 int PerformExtraCommand(int extra_stop_time);
 const char *MapSynonym(int noun);
@@ -118,11 +141,15 @@ int RandomPercent(int n);
 void DoneIt(void);
 void SaveGame(void);
 void PrintNoun(void);
+int CountStoredTreasures(void);
 int PrintScore(void);
+void MoveItem(int item, int location);
 void MoveItemAToLocOfItemB(int itemA, int itemB);
 void GoToStoredLoc(void);
 void SwapLocAndRoomflag(int index);
 void SwapItemLocations(int itemA, int itemB);
+int CountItemsAt(int location);
+void SetItemLocations(const uint16_t *locations);
 void PutItemAInRoomB(int itemA, int roomB);
 void SwapCounters(int index);
 void PrintMessage(int index);
@@ -132,7 +159,13 @@ extern struct GameInfo *Game;
 extern Header GameHeader;
 extern Room *Rooms;
 extern Item *Items;
+/* 16 bit in every game. Keeping them 8 bit in classic games would save a
+   byte per item in each copy, about 6 KB over the hundred undo states of
+   a game of 65 items, and cost a second path through every condition,
+   undo state, save file and hash. */
+extern uint16_t *ItemLocations, *InitialLocations;
 extern Action *Actions;
+extern WideAction *WideActions;
 extern const char **Verbs, **Nouns, **Messages;
 extern const char *title_screen;
 extern winid_t Bottom, Top;
@@ -149,6 +182,7 @@ extern int SavedRoom;
 extern int AutoInventory;
 extern int WeAreBigEndian;
 extern int CurrentCounter;
+extern int CarriedLocation;
 extern int RoomSaved[];
 extern int Options;
 extern int stop_time;
@@ -0,0 +1,1075 @@
+//
+//  sessionhost.c
+//  scott
+//
+//  Serves one game to many players. The database is loaded once, then
+//  the process listens on a Unix domain socket and forks a child for each
+//  connection. The children share the loaded database with the parent
+//  (copy on write), so a new player does not wait for the game file to
+//  be read and parsed again.
+//
+//  This is meant for the MemGlk build, which reads commands from stdin
+//  and writes each turn's output to stdout: in the child, both are the
+//  connection.
+//
+//  Sessions that wait at the command prompt for longer than the idle time
+//  go to sleep: the child writes the game state, undo history and RAM
+//  save to a small file next to the socket and exits, freeing everything
+//  it had. The parent keeps the connection, and when the player sends
+//  the next command it forks a new child which reads the file back and
+//  carries on from the same prompt. Putting idle sessions to sleep needs
+//  the MemGlk build, where the host decides how input is read.
+//
+//  Given a directory of games instead of a game file, the host loads
+//  games as players ask for them. A new connection starts with a line
+//  naming the game, and is handed over to a game process: a process that
+//  has loaded that game and serves it as above, forked from the host
+//  before the game was read. Game processes are kept while they are in
+//  use, and the least recently used idle ones are shut down once the
+//  loaded games take more memory than the cache may use.
+//
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+/* For asking the heap what a game took to load */
+#if defined(__APPLE__)
+#include <malloc/malloc.h>
+#elif defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+#include "glk.h"
+#ifdef MEMGLK
+/* For memglk_set_input_handler() and memglk_push_line_uni() */
+#include <glkstart.h>
+#endif
+
+#include "jsonapi.h"
+#include "latency.h"
+#include "metrics.h"
+#include "parser.h"
+#include "restorestate.h"
+#include "scott.h"
+#include "sessionhost.h"
+#include "utf8.h"
+
+/* The exit status of a child that went to sleep */
+#define SESSION_ASLEEP 3
+
+extern strid_t Transcript;
+
+struct Session {
+    pid_t pid; /* 0 while asleep */
+    int conn;
+    char *statefile;
+};
+
+static struct Session *sessions = NULL;
+static int numsessions = 0;
+static int sessionssize = 0;
+
+static const char *socket_path = NULL;
+static int idle_seconds = 0;
+
+/* In a game process: the connection to the host */
+static int host_channel = -1;
+
+/* Only the host answers on the metrics socket */
+static const char *metrics_path = NULL;
+static int metrics_listener = -1;
+
+/* In a child: the file to wake up from, if any */
+static char *wake_file = NULL;
+
+/* Mixed into the random seed, so that players who connect in the same
+   second don't all get the same game */
+static unsigned int session_seed = 0;
+
+unsigned int SessionSeed(void)
+{
+    return session_seed;
+}
+
+static char *StateFileName(pid_t pid)
+{
+    size_t size = strlen(socket_path) + 24;
+    char *name = MemAlloc((int)size);
+    snprintf(name, size, "%s.%ld", socket_path, (long)pid);
+    return name;
+}
+
+#ifdef MEMGLK
+
+/* Input is read from the connection here rather than by MemGlk, so that
+   the child can tell when the player has gone quiet. Lines are split
+   out of buf; anything after the first newline is kept for later. */
+static char inbuf[1024];
+static int inlength = 0;
+
+static void Hibernate(void);
+
+static int CanHibernate(void)
+{
+    return idle_seconds > 0 && WaitingForCommand && inlength == 0
+        && !InputPending() && Transcript == NULL;
+}
+
+static void PushUtf8Line(const char *buf, int len)
+{
+    glui32 ubuf[sizeof(inbuf)];
+    const char *end = buf + len;
+    int ulen = 0;
+
+    while (buf < end)
+        ubuf[ulen++] = DecodeUtf8(&buf, end);
+    memglk_push_line_uni(ubuf, ulen);
+}
+
+static int ReadSessionInput(glui32 evtype, void *rock)
+{
+    char *newline;
+    int len;
+
+    fflush(stdout);
+
+    while ((newline = memchr(inbuf, '\n', inlength)) == NULL
+        && inlength < (int)sizeof(inbuf)) {
+        if (CanHibernate()) {
+            struct pollfd pfd = { STDIN_FILENO, POLLIN, 0 };
+            int result = poll(&pfd, 1, idle_seconds * 1000);
+            if (result == 0)
+                Hibernate();
+            if (result == -1 && errno == EINTR)
+                continue;
+        }
+        ssize_t got = read(STDIN_FILENO, inbuf + inlength, sizeof(inbuf) - inlength);
+        if (got == -1 && errno == EINTR)
+            continue;
+        if (got <= 0) {
+            if (inlength == 0)
+                return FALSE;
+            break;
+        }
+        inlength += got;
+    }
+
+    len = newline ? (int)(newline - inbuf) : inlength;
+    PushUtf8Line(inbuf, (len && inbuf[len - 1] == '\r') ? len - 1 : len);
+    if (newline)
+        len++;
+    inlength -= len;
+    memmove(inbuf, inbuf + len, inlength);
+    return TRUE;
+}
+
+/* Called at the command prompt once the player has been idle for long
+   enough. Does not return. */
+static void Hibernate(void)
+{
+    double start = Milliseconds();
+    char *name = StateFileName(getpid());
+    FILE *f = fopen(name, "wb");
+    long size;
+
+    if (f == NULL) {
+        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+        free(name);
+        idle_seconds = 0;
+        return;
+    }
+
+    WriteSession(f, 0);
+    size = ftell(f);
+
+    if (ferror(f) | fclose(f)) {
+        fprintf(stderr, "%s: %s\n", name, strerror(errno));
+        unlink(name);
+        free(name);
+        idle_seconds = 0;
+        return;
+    }
+
+    fprintf(stderr, "Session %ld asleep: %ld bytes in %.3f ms\n",
+        (long)getpid(), size, Milliseconds() - start);
+    free(name);
+    exit(SESSION_ASLEEP);
+}
+
+void WakeSession(void)
+{
+    double start = Milliseconds();
+    FILE *f = fopen(wake_file, "rb");
+
+    if (f == NULL)
+        Fatal("Cannot open sleeping session");
+
+    if (!ReadSession(f, NULL)) {
+        fclose(f);
+        unlink(wake_file);
+        Fatal("Sleeping session is damaged");
+    }
+    fclose(f);
+    unlink(wake_file);
+
+    PromptShown = 1;
+
+    fprintf(stderr, "Session %ld awake: %.3f ms\n", (long)getpid(),
+        Milliseconds() - start);
+    free(wake_file);
+    wake_file = NULL;
+}
+
+#else
+
+void WakeSession(void)
+{
+    Fatal("Sleeping sessions need the MemGlk build");
+}
+
+#endif /* MEMGLK */
+
+int ResumingSession(void)
+{
+    return wake_file != NULL;
+}
+
+static int OpenListener(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        Fatal("Socket path too long");
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd == -1)
+        Fatal("Cannot create socket");
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* A socket left behind by an earlier run would make bind() fail */
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        Fatal("Cannot bind socket");
+    }
+    if (listen(fd, SOMAXCONN) == -1)
+        Fatal("Cannot listen on socket");
+
+    return fd;
+}
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+/* What the host and a game process tell each other */
+enum CacheMessageType {
+    NEW_SESSION, /* host to game, with the connection */
+    GAME_LOADED, /* game to host, with the memory used in kilobytes */
+    SESSION_ENDED /* game to host */
+};
+
+struct CacheMessage {
+    int32_t type;
+    int32_t value;
+};
+
+static int SendCacheMessage(int channel, int type, int value, int fd)
+{
+    struct CacheMessage m = { type, value };
+    struct iovec iov = { &m, sizeof(m) };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    ssize_t result;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    if (fd != -1) {
+        struct cmsghdr *cmsg;
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+
+    do
+        result = sendmsg(channel, &msg, MSG_NOSIGNAL);
+    while (result == -1 && errno == EINTR);
+    return result == sizeof(m);
+}
+
+/* Returns 0 once the other end has gone. *fd is -1 unless the message
+   came with a connection. */
+static int ReceiveCacheMessage(int channel, struct CacheMessage *m, int *fd)
+{
+    struct iovec iov = { m, sizeof(*m) };
+    union {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    ssize_t result;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    do
+        result = recvmsg(channel, &msg, 0);
+    while (result == -1 && errno == EINTR);
+
+    *fd = -1;
+    cmsg = CMSG_FIRSTHDR(&msg);
+    if (result > 0 && cmsg != NULL && cmsg->cmsg_level == SOL_SOCKET
+        && cmsg->cmsg_type == SCM_RIGHTS)
+        memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    if (result != sizeof(*m)) {
+        if (*fd != -1)
+            close(*fd);
+        return 0;
+    }
+    return 1;
+}
+
+static void AddSession(int conn)
+{
+    if (numsessions == sessionssize) {
+        sessionssize = sessionssize ? sessionssize * 2 : 16;
+        sessions = realloc(sessions, sessionssize * sizeof(struct Session));
+        if (sessions == NULL)
+            Fatal("Out of memory");
+    }
+    sessions[numsessions].pid = 0;
+    sessions[numsessions].conn = conn;
+    sessions[numsessions].statefile = NULL;
+    numsessions++;
+}
+
+static void RemoveSession(int index)
+{
+    struct Session *s = &sessions[index];
+    if (host_channel != -1)
+        SendCacheMessage(host_channel, SESSION_ENDED, 0, -1);
+    close(s->conn);
+    if (s->statefile != NULL) {
+        unlink(s->statefile);
+        free(s->statefile);
+    }
+    sessions[index] = sessions[--numsessions];
+}
+
+/* Returns 1 in the child */
+static int StartSession(int index, int listener)
+{
+    struct Session *s = &sessions[index];
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        int conn = s->conn;
+        wake_file = s->statefile;
+        /* The child has no use for the other connections */
+        for (int i = 0; i < numsessions; i++)
+            if (i != index)
+                close(sessions[i].conn);
+        free(sessions);
+        sessions = NULL;
+        numsessions = 0;
+        close(listener);
+        host_channel = -1;
+        if (metrics_listener != -1)
+            close(metrics_listener);
+        metrics_listener = -1;
+        MetricsForSession();
+        signal(SIGCHLD, SIG_DFL);
+        /* A player who hangs up mid-turn makes writes fail instead of
+           killing the session, which then ends normally at its next read
+           and keeps its coverage */
+        signal(SIGPIPE, SIG_IGN);
+        if (dup2(conn, STDIN_FILENO) == -1 || dup2(conn, STDOUT_FILENO) == -1)
+            exit(1);
+        close(conn);
+        session_seed = (unsigned int)getpid() << 16;
+#ifdef MEMGLK
+        /* The JSON API reads its requests itself */
+        if (!JsonApi)
+            memglk_set_input_handler(ReadSessionInput, NULL);
+#endif
+        return 1;
+    }
+
+    if (pid == -1) {
+        fprintf(stderr, "Cannot fork: %s\n", strerror(errno));
+        RemoveSession(index);
+        return 0;
+    }
+
+    /* The child has the state file now, and deletes it once read */
+    free(s->statefile);
+    s->statefile = NULL;
+    s->pid = pid;
+    return 0;
+}
+
+static void ReapChildren(void)
+{
+    int status, i;
+    pid_t pid;
+
+    while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+        EndMetrics(pid);
+        for (i = 0; i < numsessions && sessions[i].pid != pid; i++)
+            ;
+        if (i == numsessions)
+            continue;
+        if (WIFEXITED(status) && WEXITSTATUS(status) == SESSION_ASLEEP) {
+            sessions[i].pid = 0;
+            sessions[i].statefile = StateFileName(pid);
+        } else {
+            RemoveSession(i);
+        }
+    }
+}
+
+static void ChildExited(int sig)
+{
+    /* Only here to interrupt poll() */
+}
+
+void ServeMetrics(const char *path)
+{
+    metrics_path = path;
+}
+
+/* Answered as an HTTP request, whatever was asked, so that anything that
+   can scrape a Unix domain socket can read it. A client that doesn't send
+   its request is given a second. */
+static void WriteCacheMetrics(FILE *f);
+
+static void AnswerMetrics(void)
+{
+    struct timeval timeout = { 1, 0 };
+    char *text = NULL;
+    size_t length = 0, sent = 0;
+    char c, previous = 0;
+    FILE *f;
+    int conn = accept(metrics_listener, NULL, NULL);
+
+    if (conn == -1)
+        return;
+    setsockopt(conn, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(conn, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    /* The request ends with an empty line */
+    while (recv(conn, &c, 1, 0) == 1) {
+        if (c == '\r')
+            continue;
+        if (c == '\n' && previous == '\n')
+            break;
+        previous = c;
+    }
+
+    f = open_memstream(&text, &length);
+    if (f != NULL) {
+        fputs("HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n\r\n", f);
+        WriteMetrics(f);
+        WriteCacheMetrics(f);
+        fclose(f);
+        while (sent < length) {
+            ssize_t n = send(conn, text + sent, length - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                break;
+            sent += n;
+        }
+        free(text);
+    }
+    close(conn);
+}
+
+/* The bytes the heap has handed out and not yet taken back, so that what
+   loading a game took is the difference from before. Where the heap
+   can't be asked, the most memory the process has used stands in. */
+static size_t HeapInUse(void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+    struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#elif defined(__APPLE__)
+    malloc_statistics_t stats;
+    malloc_zone_statistics(NULL, &stats);
+    return stats.size_in_use;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == -1)
+        return 0;
+    return (size_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+/* Set in a game process just before it loads its game */
+static size_t heap_before_game = 0;
+
+/* What the game took to load, in kilobytes for the host to weigh against
+   the cache size */
+static int GameKilobytes(void)
+{
+    size_t now = HeapInUse();
+    if (now <= heap_before_game)
+        return 0;
+    return (int)((now - heap_before_game + 1023) / 1024);
+}
+
+/* Only returns in a child process, with stdin and stdout connected to a
+   player. The parent accepts connections and wakes sleeping sessions
+   until it is killed, or in a game process, until the host shuts it down
+   and the last of its sessions has ended. */
+void ServeSessions(const char *path, int idle)
+{
+    int listener;
+    struct pollfd *pfds = NULL;
+    int *which = NULL;
+    int pfdssize = 0;
+
+    socket_path = path;
+    idle_seconds = idle;
+#ifndef MEMGLK
+    if (idle_seconds) {
+        fprintf(stderr, "Sessions can only go to sleep in the MemGlk build\n");
+        idle_seconds = 0;
+    }
+#endif
+    if (idle_seconds && JsonApi) {
+        fprintf(stderr, "Sessions of the JSON API can't go to sleep\n");
+        idle_seconds = 0;
+    }
+
+    signal(SIGCHLD, ChildExited);
+
+    if (host_channel != -1) {
+        /* A game process, given its players by the host */
+        listener = host_channel;
+        SendCacheMessage(host_channel, GAME_LOADED, GameKilobytes(), -1);
+    } else {
+        listener = OpenListener(path);
+        fprintf(stderr, "Listening on %s\n", path);
+        if (metrics_path != NULL)
+            metrics_listener = OpenListener(metrics_path);
+    }
+
+    while (1) {
+        int count = 1, polled, i, result;
+
+        ReapChildren();
+
+        /* A game process that the host has shut down goes once its last
+           session has */
+        if (listener == -1 && numsessions == 0)
+            exit(0);
+
+        if (pfdssize < numsessions + 2) {
+            pfdssize = (numsessions + 2) * 2;
+            pfds = realloc(pfds, pfdssize * sizeof(struct pollfd));
+            which = realloc(which, pfdssize * sizeof(int));
+            if (pfds == NULL || which == NULL)
+                Fatal("Out of memory");
+        }
+        pfds[0].fd = listener;
+        pfds[0].events = POLLIN;
+        for (i = 0; i < numsessions; i++) {
+            if (sessions[i].pid == 0) {
+                pfds[count].fd = sessions[i].conn;
+                pfds[count].events = POLLIN;
+                which[count] = i;
+                count++;
+            }
+        }
+
+        polled = count;
+        if (metrics_listener != -1) {
+            pfds[polled].fd = metrics_listener;
+            pfds[polled].events = POLLIN;
+            polled++;
+        }
+
+        /* The timeout catches a child that exits just before poll() */
+        result = poll(pfds, polled, 1000);
+        if (result == -1) {
+            if (errno == EINTR)
+                continue;
+            Fatal("Cannot poll connections");
+        }
+
+        if (polled > count && (pfds[count].revents & POLLIN))
+            AnswerMetrics();
+
+        /* Wake the sessions that have input, or drop them if the player
+           has gone. Going backwards, so that removing a session doesn't
+           move one still to be looked at. */
+        for (i = count - 1; i >= 1; i--) {
+            char c;
+            if (!pfds[i].revents)
+                continue;
+            if (recv(pfds[i].fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) <= 0)
+                RemoveSession(which[i]);
+            else if (StartSession(which[i], listener)) {
+                free(pfds);
+                free(which);
+                return;
+            }
+        }
+
+        if (pfds[0].revents) {
+            int conn;
+            if (host_channel != -1) {
+                struct CacheMessage m;
+                if (!ReceiveCacheMessage(host_channel, &m, &conn)) {
+                    close(host_channel);
+                    listener = host_channel = -1;
+                    continue;
+                }
+                if (conn == -1)
+                    continue;
+            } else {
+                conn = accept(listener, NULL, NULL);
+                if (conn == -1) {
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+                    Fatal("Cannot accept connection");
+                }
+            }
+            AddSession(conn);
+            if (StartSession(numsessions - 1, listener)) {
+                free(pfds);
+                free(which);
+                return;
+            }
+        }
+    }
+}
+
+/* The host, for a directory of games */
+
+struct CachedGame {
+    char *name;
+    int channel;
+    int kilobytes; /* 0 until the game process has loaded the game */
+    int sessions; /* handed over and not yet ended, asleep or not */
+    unsigned long lastused;
+};
+
+static struct CachedGame *games = NULL;
+static int numgames = 0;
+static int gamessize = 0;
+
+/* Connections that have not yet said which game they want */
+struct Newcomer {
+    int conn;
+    int length;
+    char name[64];
+};
+
+static struct Newcomer *newcomers = NULL;
+static int numnewcomers = 0;
+static int newcomerssize = 0;
+
+static unsigned long cache_clock = 0;
+static unsigned long cache_hits = 0;
+static unsigned long cache_misses = 0;
+static unsigned long cache_evictions = 0;
+static long cache_limit = 0; /* in kilobytes, 0 for no limit */
+static int serving_catalog = 0;
+
+int IsGameDirectory(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static long CacheKilobytes(void)
+{
+    long total = 0;
+    for (int i = 0; i < numgames; i++)
+        total += games[i].kilobytes;
+    return total;
+}
+
+static void LogCache(void)
+{
+    fprintf(stderr, "Game cache: %d games in %ld KB, %lu hits, %lu misses, %lu evictions\n",
+        numgames, CacheKilobytes(), cache_hits, cache_misses, cache_evictions);
+}
+
+/* After the metrics of the games, when the host has a cache of them */
+static void WriteCacheMetrics(FILE *f)
+{
+    static const char *counters[] = { "hits", "misses", "evictions" };
+    static const char *help[] = {
+        "Connections handed to a game that was already loaded.",
+        "Connections that had to wait for their game to be loaded.",
+        "Games shut down to make room in the cache.",
+    };
+    unsigned long counts[] = { cache_hits, cache_misses, cache_evictions };
+
+    if (!serving_catalog)
+        return;
+    for (int i = 0; i < 3; i++)
+        fprintf(f, "# HELP scottfree_cache_%s_total %s\n# TYPE scottfree_cache_%s_total counter\n"
+                   "scottfree_cache_%s_total %lu\n",
+            counters[i], help[i], counters[i], counters[i], counts[i]);
+    fprintf(f, "# HELP scottfree_cache_games Games loaded or being loaded now.\n# TYPE scottfree_cache_games gauge\n"
+               "scottfree_cache_games %d\n",
+        numgames);
+    fprintf(f, "# HELP scottfree_cache_bytes Memory the loaded games took to load.\n"
+               "# TYPE scottfree_cache_bytes gauge\nscottfree_cache_bytes %ld\n",
+        CacheKilobytes() * 1024);
+}
+
+static int FindGame(const char *name)
+{
+    for (int i = 0; i < numgames; i++)
+        if (strcmp(games[i].name, name) == 0)
+            return i;
+    return -1;
+}
+
+/* The game process sees its channel close, and exits once its sessions
+   have ended */
+static void RemoveGame(int index)
+{
+    close(games[index].channel);
+    free(games[index].name);
+    games[index] = games[--numgames];
+}
+
+/* Shut down the least recently used games that nobody is playing, until
+   the rest fit */
+static void EvictGames(void)
+{
+    while (cache_limit && CacheKilobytes() > cache_limit) {
+        int oldest = -1;
+        for (int i = 0; i < numgames; i++)
+            if (games[i].sessions == 0 && games[i].kilobytes
+                && (oldest == -1 || games[i].lastused < games[oldest].lastused))
+                oldest = i;
+        if (oldest == -1)
+            return;
+        fprintf(stderr, "Evicting %s\n", games[oldest].name);
+        RemoveGame(oldest);
+        cache_evictions++;
+        LogCache();
+    }
+}
+
+static void AddNewcomer(int conn)
+{
+    if (numnewcomers == newcomerssize) {
+        newcomerssize = newcomerssize ? newcomerssize * 2 : 16;
+        newcomers = realloc(newcomers, newcomerssize * sizeof(struct Newcomer));
+        if (newcomers == NULL)
+            Fatal("Out of memory");
+    }
+    newcomers[numnewcomers].conn = conn;
+    newcomers[numnewcomers].length = 0;
+    numnewcomers++;
+}
+
+static void RemoveNewcomer(int index, int close_conn)
+{
+    if (close_conn)
+        close(newcomers[index].conn);
+    newcomers[index] = newcomers[--numnewcomers];
+}
+
+/* Reads the first line of a connection a byte at a time, so that nothing
+   after it is taken from the game. Returns 1 once the line is complete,
+   0 if there is more to come and -1 if the connection should be
+   dropped. */
+static int ReadGameName(struct Newcomer *n)
+{
+    char c;
+    ssize_t got;
+
+    while ((got = recv(n->conn, &c, 1, MSG_DONTWAIT)) == 1) {
+        if (c == '\n') {
+            if (n->length && n->name[n->length - 1] == '\r')
+                n->length--;
+            n->name[n->length] = 0;
+            return 1;
+        }
+        if (n->length == sizeof(n->name) - 1)
+            return -1;
+        n->name[n->length++] = c;
+    }
+    if (got == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        return 0;
+    return -1;
+}
+
+static void RefuseConnection(int conn, const char *message)
+{
+    send(conn, message, strlen(message), MSG_NOSIGNAL);
+    close(conn);
+}
+
+/* Forks a game process for a game that isn't loaded. Returns 1 in the
+   game process. */
+static int StartGame(const char *name, int listener)
+{
+    int pair[2];
+    pid_t pid;
+
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) == -1) {
+        fprintf(stderr, "Cannot create socket pair: %s\n", strerror(errno));
+        return 0;
+    }
+
+    pid = fork();
+    if (pid == 0) {
+        /* The game process needs nothing of the host's but its own
+           channel */
+        close(listener);
+        close(pair[0]);
+        if (metrics_listener != -1)
+            close(metrics_listener);
+        metrics_listener = -1;
+        for (int i = 0; i < numgames; i++)
+            close(games[i].channel);
+        for (int i = 0; i < numnewcomers; i++)
+            close(newcomers[i].conn);
+        for (int i = 0; i < numgames; i++)
+            free(games[i].name);
+        free(games);
+        free(newcomers);
+        games = NULL;
+        newcomers = NULL;
+        numgames = numnewcomers = 0;
+        host_channel = pair[1];
+        heap_before_game = HeapInUse();
+        return 1;
+    }
+
+    close(pair[1]);
+    if (pid == -1) {
+        fprintf(stderr, "Cannot fork: %s\n", strerror(errno));
+        close(pair[0]);
+        return 0;
+    }
+
+    if (numgames == gamessize) {
+        gamessize = gamessize ? gamessize * 2 : 16;
+        games = realloc(games, gamessize * sizeof(struct CachedGame));
+        if (games == NULL)
+            Fatal("Out of memory");
+    }
+    games[numgames].name = MemAlloc((int)strlen(name) + 1);
+    strcpy(games[numgames].name, name);
+    games[numgames].channel = pair[0];
+    games[numgames].kilobytes = 0;
+    games[numgames].sessions = 0;
+    games[numgames].lastused = 0;
+    numgames++;
+    return 0;
+}
+
+/* Hands a connection to the process for its game, starting one if
+   need be. Returns the path of the game file in a new game process, and
+   NULL in the host. */
+static char *DispatchConnection(int conn, const char *directory,
+    const char *name, int listener)
+{
+    int index = FindGame(name);
+
+    if (index != -1) {
+        cache_hits++;
+    } else {
+        struct stat st;
+        size_t size = strlen(directory) + strlen(name) + 2;
+        char *path;
+
+        if (*name == 0 || *name == '.' || strchr(name, '/') != NULL) {
+            RefuseConnection(conn, "No such game\n");
+            return NULL;
+        }
+        path = MemAlloc((int)size);
+        snprintf(path, size, "%s/%s", directory, name);
+        if (stat(path, &st) == -1 || !S_ISREG(st.st_mode)) {
+            free(path);
+            RefuseConnection(conn, "No such game\n");
+            return NULL;
+        }
+
+        cache_misses++;
+        if (StartGame(name, listener)) {
+            /* The host hands the connection over like any other, once
+               the game is loaded. This copy would keep it open after
+               the session has ended. */
+            close(conn);
+            return path;
+        }
+        free(path);
+        index = FindGame(name);
+        if (index == -1) {
+            RefuseConnection(conn, "Cannot start game\n");
+            return NULL;
+        }
+    }
+
+    if (!SendCacheMessage(games[index].channel, NEW_SESSION, 0, conn)) {
+        close(conn);
+        return NULL;
+    }
+    close(conn);
+    games[index].sessions++;
+    games[index].lastused = ++cache_clock;
+    return NULL;
+}
+
+/* Only returns in a game process, with the path of the game to load
+   before calling ServeSessions(). */
+char *ServeCatalog(const char *path, const char *directory, int megabytes)
+{
+    int listener = OpenListener(path);
+    struct pollfd *pfds = NULL;
+    int *which = NULL;
+    int pfdssize = 0;
+
+    cache_limit = (long)megabytes * 1024;
+    serving_catalog = 1;
+    signal(SIGCHLD, ChildExited);
+
+    fprintf(stderr, "Serving the games in %s on %s\n", directory, path);
+    if (metrics_path != NULL)
+        metrics_listener = OpenListener(metrics_path);
+
+    while (1) {
+        int count = 1, polled, newcomerstart, i, result;
+        char *game;
+        pid_t pid;
+
+        /* A game process that has gone is noticed by its channel
+           closing */
+        while ((pid = waitpid(-1, NULL, WNOHANG)) > 0)
+            EndMetrics(pid);
+
+        if (pfdssize < numgames + numnewcomers + 2) {
+            pfdssize = (numgames + numnewcomers + 2) * 2;
+            pfds = realloc(pfds, pfdssize * sizeof(struct pollfd));
+            which = realloc(which, pfdssize * sizeof(int));
+            if (pfds == NULL || which == NULL)
+                Fatal("Out of memory");
+        }
+        pfds[0].fd = listener;
+        pfds[0].events = POLLIN;
+        for (i = 0; i < numgames; i++, count++) {
+            pfds[count].fd = games[i].channel;
+            pfds[count].events = POLLIN;
+            which[count] = i;
+        }
+        newcomerstart = count;
+        for (i = 0; i < numnewcomers; i++, count++) {
+            pfds[count].fd = newcomers[i].conn;
+            pfds[count].events = POLLIN;
+            which[count] = i;
+        }
+
+        polled = count;
+        if (metrics_listener != -1) {
+            pfds[polled].fd = metrics_listener;
+            pfds[polled].events = POLLIN;
+            polled++;
+        }
+
+        result = poll(pfds, polled, 1000);
+        if (result == -1) {
+            if (errno == EINTR)
+                continue;
+            Fatal("Cannot poll connections");
+        }
+
+        if (polled > count && (pfds[count].revents & POLLIN))
+            AnswerMetrics();
+
+        /* Backwards, as in ServeSessions() */
+        for (i = count - 1; i >= newcomerstart; i--) {
+            struct Newcomer *n = &newcomers[which[i]];
+            if (!pfds[i].revents)
+                continue;
+            result = ReadGameName(n);
+            if (result == -1) {
+                RemoveNewcomer(which[i], 1);
+            } else if (result == 1) {
+                int conn = n->conn;
+                char name[sizeof(n->name)];
+                strcpy(name, n->name);
+                RemoveNewcomer(which[i], 0);
+                game = DispatchConnection(conn, directory, name, listener);
+                if (game != NULL) {
+                    free(pfds);
+                    free(which);
+                    return game;
+                }
+            }
+        }
+
+        for (i = newcomerstart - 1; i >= 1; i--) {
+            struct CachedGame *g = &games[which[i]];
+            struct CacheMessage m;
+            int fd;
+            if (!pfds[i].revents)
+                continue;
+            if (!ReceiveCacheMessage(g->channel, &m, &fd)) {
+                if (g->kilobytes)
+                    fprintf(stderr, "The game process for %s has exited\n", g->name);
+                else
+                    fprintf(stderr, "Cannot load %s\n", g->name);
+                RemoveGame(which[i]);
+                continue;
+            }
+            if (fd != -1)
+                close(fd);
+            if (m.type == GAME_LOADED) {
+                g->kilobytes = m.value > 0 ? m.value : 1;
+                fprintf(stderr, "Loaded %s: %d KB\n", g->name, g->kilobytes);
+                LogCache();
+            } else if (m.type == SESSION_ENDED && g->sessions > 0) {
+                g->sessions--;
+            }
+        }
+        EvictGames();
+
+        if (pfds[0].revents & POLLIN) {
+            int conn = accept(listener, NULL, NULL);
+            if (conn == -1) {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                Fatal("Cannot accept connection");
+            }
+            AddNewcomer(conn);
+        }
+    }
+}
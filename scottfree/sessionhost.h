@@ -0,0 +1,17 @@
+//
+//  sessionhost.h
+//  scott
+//
+
+#ifndef sessionhost_h
+#define sessionhost_h
+
+void ServeSessions(const char *path, int idle);
+int IsGameDirectory(const char *path);
+char *ServeCatalog(const char *path, const char *directory, int megabytes);
+void ServeMetrics(const char *path);
+int ResumingSession(void);
+void WakeSession(void);
+unsigned int SessionSeed(void);
+
+#endif /* sessionhost_h */
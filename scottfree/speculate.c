@@ -0,0 +1,266 @@
+//
+//  speculate.c
+//  scott
+//
+//  Tries commands out and then takes them back, for bots and hint
+//  systems that want to know what a command would do without having to
+//  save, play and restore the whole game for every one they try. While
+//  commands are tried, each item move goes to an undo log with where the
+//  item was before, and the few counters and flags are copied once at the
+//  start, so taking them back costs a step for each item moved rather
+//  than a copy of every location in the game.
+//
+//  The text of the main window goes to a memory stream meanwhile, and
+//  the journal, the transcript, the metrics and the coverage are left
+//  alone. Anything that would wait for the player, such as the key that
+//  ends the game or the name of a file to save to, stops the commands
+//  where they are, as does asking for the next line.
+//
+//  Trying a command is not free of allocations: the parser splits the
+//  line into words and commands on the heap as it always does, and the
+//  memory stream is opened and closed each time. Only the undo log, the
+//  text and the description of the changes keep their buffers from one
+//  try to the next.
+//
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "coverage.h"
+#include "latency.h"
+#include "layouttext.h"
+#include "metrics.h"
+#include "restorestate.h"
+#include "scott.h"
+#include "speculate.h"
+
+/* Longer text is cut short */
+#define SPECULATIVE_TEXT_SIZE 16384
+
+extern strid_t Transcript;
+extern int CurrentCounter;
+extern int RoomSaved[];
+
+int Speculating = 0;
+strid_t SpeculativeOutput = NULL;
+unsigned int SpeculativeSeed = 0;
+jmp_buf SpeculationStop;
+
+struct ItemMove {
+    int item;
+    int location; /* before the move */
+};
+
+static struct ItemMove *undo_log = NULL;
+static int log_length = 0;
+static int log_size = 0;
+
+/* Only the scalars are used; the items are in the log */
+static struct SavedState before;
+
+static glui32 line[512];
+static glui32 line_length = 0;
+static int line_read = 0;
+
+static glui32 text[SPECULATIVE_TEXT_SIZE];
+static SpeculationEnd ending;
+
+/* Put aside while speculating */
+static strid_t transcript;
+static LineCoverage *coverage;
+static uint64_t *metric_counts;
+static int timing_phases;
+static uint64_t scratch_counts[NUMBER_OF_METRICS];
+
+static void CopyScalars(struct SavedState *s)
+{
+    memcpy(s->Counters, Counters, sizeof(s->Counters));
+    memcpy(s->RoomSaved, RoomSaved, sizeof(s->RoomSaved));
+    s->BitFlags = BitFlags;
+    s->CurrentLoc = MyLoc;
+    s->CurrentCounter = CurrentCounter;
+    s->SavedRoom = SavedRoom;
+    s->LightTime = GameHeader.LightTime;
+    s->AutoInventory = AutoInventory;
+}
+
+static void RestoreScalars(const struct SavedState *s)
+{
+    memcpy(Counters, s->Counters, sizeof(s->Counters));
+    memcpy(RoomSaved, s->RoomSaved, sizeof(s->RoomSaved));
+    BitFlags = s->BitFlags;
+    MyLoc = s->CurrentLoc;
+    CurrentCounter = s->CurrentCounter;
+    SavedRoom = s->SavedRoom;
+    GameHeader.LightTime = s->LightTime;
+    AutoInventory = s->AutoInventory;
+}
+
+void BeginSpeculation(const glui32 *input, int length)
+{
+    if (length > 511)
+        length = 511;
+    memcpy(line, input, length * sizeof(glui32));
+    line[length] = 0;
+    line_length = length;
+    line_read = 0;
+
+    log_length = 0;
+    CopyScalars(&before);
+    SpeculativeSeed = (unsigned int)StateHash();
+    SpeculativeOutput = glk_stream_open_memory_uni(text, SPECULATIVE_TEXT_SIZE, filemode_Write, 0);
+
+    transcript = Transcript;
+    Transcript = NULL;
+    coverage = Coverage;
+    Coverage = NULL;
+    metric_counts = MetricCounts;
+    MetricCounts = scratch_counts;
+    timing_phases = TimingPhases;
+    TimingPhases = 0;
+
+    Speculating = 1;
+}
+
+/* The line is read once; the next time the game asks for one, the
+   commands are over */
+void ReadSpeculativeLine(glui32 *buf, glui32 *length)
+{
+    if (line_read)
+        StopSpeculation(SPECULATION_LINE);
+    memcpy(buf, line, (line_length + 1) * sizeof(glui32));
+    *length = line_length;
+    line_read = 1;
+}
+
+void StopSpeculation(SpeculationEnd end)
+{
+    ending = end;
+    longjmp(SpeculationStop, 1);
+}
+
+void LogItemMove(int item)
+{
+    if (log_length == log_size) {
+        log_size = log_size ? log_size * 2 : 64;
+        undo_log = realloc(undo_log, log_size * sizeof(struct ItemMove));
+        if (undo_log == NULL)
+            Fatal("Out of memory");
+    }
+    undo_log[log_length].item = item;
+    undo_log[log_length].location = ItemLocations[item];
+    log_length++;
+}
+
+static void AppendChange(TextBuilder *tb, const char *name, int from, int to)
+{
+    if (from != to)
+        AppendText(tb, "%s\"%s\":[%d,%d]", tb->length > 1 ? "," : "", name, from, to);
+}
+
+/* Changes to the elements of an array, as [index, from, to] */
+static void AppendChanges(TextBuilder *tb, const char *name, const int *from, const int *to, int count)
+{
+    int first = 1;
+
+    for (int i = 0; i < count; i++) {
+        if (from[i] == to[i])
+            continue;
+        if (first)
+            AppendText(tb, "%s\"%s\":[", tb->length > 1 ? "," : "", name);
+        AppendText(tb, "%s[%d,%d,%d]", first ? "" : ",", i, from[i], to[i]);
+        first = 0;
+    }
+    if (!first)
+        AppendString(tb, "]");
+}
+
+static void DescribeChanges(TextBuilder *tb)
+{
+    /* The first move of an item in the log holds where it started */
+    static uint8_t *seen = NULL;
+    static int seen_size = 0;
+    int first = 1;
+
+    if (seen_size < GameHeader.NumItems + 1) {
+        free(seen);
+        seen_size = GameHeader.NumItems + 1;
+        seen = MemAlloc(seen_size);
+        memset(seen, 0, seen_size);
+    }
+
+    ClearText(tb);
+    AppendString(tb, "{");
+    AppendChange(tb, "location", before.CurrentLoc, MyLoc);
+
+    for (int i = 0; i < log_length; i++) {
+        int item = undo_log[i].item;
+        if (seen[item])
+            continue;
+        seen[item] = 1;
+        if (undo_log[i].location == ItemLocations[item])
+            continue;
+        if (first)
+            AppendText(tb, "%s\"items\":[", tb->length > 1 ? "," : "");
+        AppendText(tb, "%s[%d,%d,%d]", first ? "" : ",", item, undo_log[i].location, ItemLocations[item]);
+        first = 0;
+    }
+    if (!first)
+        AppendString(tb, "]");
+    for (int i = 0; i < log_length; i++)
+        seen[undo_log[i].item] = 0;
+
+    first = 1;
+    for (int i = 0; i < (int)sizeof(long) * 8; i++) {
+        int from = (before.BitFlags >> i) & 1, to = (BitFlags >> i) & 1;
+        if (from == to)
+            continue;
+        if (first)
+            AppendText(tb, "%s\"flags\":[", tb->length > 1 ? "," : "");
+        AppendText(tb, "%s[%d,%d,%d]", first ? "" : ",", i, from, to);
+        first = 0;
+    }
+    if (!first)
+        AppendString(tb, "]");
+
+    AppendChanges(tb, "counters", before.Counters, Counters, 16);
+    AppendChanges(tb, "roomsaved", before.RoomSaved, RoomSaved, 16);
+    AppendChange(tb, "counter", before.CurrentCounter, CurrentCounter);
+    AppendChange(tb, "savedroom", before.SavedRoom, SavedRoom);
+    AppendChange(tb, "light", before.LightTime, GameHeader.LightTime);
+    AppendChange(tb, "autoinventory", before.AutoInventory, AutoInventory);
+    AppendString(tb, "}");
+}
+
+/* Also takes the commands back. What is returned is kept until the next
+   speculation. */
+const Speculation *EndSpeculation(void)
+{
+    static Speculation result;
+    static TextBuilder changes = { NULL, 0, 0 };
+    stream_result_t written;
+
+    glk_stream_close(SpeculativeOutput, &written);
+    SpeculativeOutput = NULL;
+
+    result.end = ending;
+    result.text = text;
+    result.length = written.writecount < SPECULATIVE_TEXT_SIZE ? (int)written.writecount : SPECULATIVE_TEXT_SIZE;
+    result.hash = StateHash();
+    DescribeChanges(&changes);
+    result.changes = changes.text;
+
+    Speculating = 0;
+    Transcript = transcript;
+    Coverage = coverage;
+    MetricCounts = metric_counts;
+    TimingPhases = timing_phases;
+
+    /* Last move first, so that each item ends up where it started. Going
+       through MoveItem() lets Look() know the items have moved. */
+    for (int i = log_length - 1; i >= 0; i--)
+        MoveItem(undo_log[i].item, undo_log[i].location);
+    RestoreScalars(&before);
+
+    return &result;
+}
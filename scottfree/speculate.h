@@ -0,0 +1,55 @@
+//
+//  speculate.h
+//  scott
+//
+
+#ifndef speculate_h
+#define speculate_h
+
+#include <setjmp.h>
+#include <stdint.h>
+
+#include "glk.h"
+
+typedef enum {
+    SPECULATION_LINE, /* came back for the next line */
+    SPECULATION_KEY, /* wanted a key, as when the game is over */
+    SPECULATION_FILE, /* wanted a file to save to or restore from */
+    SPECULATION_UNTRIED, /* a command about the game itself, such as undo */
+} SpeculationEnd;
+
+typedef struct {
+    SpeculationEnd end;
+    /* What the commands wrote to the main window */
+    const glui32 *text;
+    int length;
+    /* Of the state the commands got to, before it was taken back */
+    uint64_t hash;
+    /* What they changed, as a JSON object */
+    const char *changes;
+} Speculation;
+
+/* Set while commands are only being tried */
+extern int Speculating;
+/* Where the main window's text goes meanwhile */
+extern strid_t SpeculativeOutput;
+/* For the random numbers of the commands tried, so that the game's own
+   sequence is left as it was */
+extern unsigned int SpeculativeSeed;
+/* Jumped to when the commands tried are over */
+extern jmp_buf SpeculationStop;
+
+void BeginSpeculation(const glui32 *line, int length);
+void ReadSpeculativeLine(glui32 *buf, glui32 *length);
+void StopSpeculation(SpeculationEnd end)
+#ifdef __GNUC__
+    __attribute__((__noreturn__))
+#endif
+    ;
+void LogItemMove(int item);
+const Speculation *EndSpeculation(void);
+
+/* In scott.c, with the rest of the turn */
+const Speculation *WhatIf(const glui32 *line, int length);
+
+#endif /* speculate_h */
@@ -0,0 +1,56 @@
+//
+//  utf8.c
+//  scott
+//
+//  The UTF-8 that commands are read and written as by the journal, the
+//  session host and the JSON API.
+//
+
+#include "utf8.h"
+
+glui32 DecodeUtf8(const char **p, const char *end)
+{
+    const char *s = *p;
+    unsigned char ch = *s++;
+    glui32 val = ch;
+    int more = 0;
+
+    if ((ch & 0xE0) == 0xC0) {
+        val = ch & 0x1F;
+        more = 1;
+    } else if ((ch & 0xF0) == 0xE0) {
+        val = ch & 0x0F;
+        more = 2;
+    } else if ((ch & 0xF8) == 0xF0) {
+        val = ch & 0x07;
+        more = 3;
+    }
+    for (; more && s < end && (*s & 0xC0) == 0x80; more--)
+        val = (val << 6) | (*s++ & 0x3F);
+    *p = s;
+    return val;
+}
+
+int EncodeUtf8(glui32 ch, char *buf)
+{
+    if (ch < 0x80) {
+        buf[0] = (char)ch;
+        return 1;
+    }
+    if (ch < 0x800) {
+        buf[0] = (char)(0xC0 | (ch >> 6));
+        buf[1] = (char)(0x80 | (ch & 0x3F));
+        return 2;
+    }
+    if (ch < 0x10000) {
+        buf[0] = (char)(0xE0 | (ch >> 12));
+        buf[1] = (char)(0x80 | ((ch >> 6) & 0x3F));
+        buf[2] = (char)(0x80 | (ch & 0x3F));
+        return 3;
+    }
+    buf[0] = (char)(0xF0 | ((ch >> 18) & 0x07));
+    buf[1] = (char)(0x80 | ((ch >> 12) & 0x3F));
+    buf[2] = (char)(0x80 | ((ch >> 6) & 0x3F));
+    buf[3] = (char)(0x80 | (ch & 0x3F));
+    return 4;
+}
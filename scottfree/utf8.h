@@ -0,0 +1,20 @@
+//
+//  utf8.h
+//  scott
+//
+
+#ifndef utf8_h
+#define utf8_h
+
+#include "glk.h"
+
+/* The most bytes a character takes */
+#define UTF8_MAX 4
+
+/* Reads the character at *p, which must be before end, and moves *p past
+   it. A byte that doesn't start a UTF-8 sequence is taken as Latin-1 */
+glui32 DecodeUtf8(const char **p, const char *end);
+/* Writes ch to buf, without a terminating zero, and returns its length */
+int EncodeUtf8(glui32 ch, char *buf);
+
+#endif /* utf8_h */
@@ -0,0 +1,40 @@
+# Shared by the test scripts, which are run by "make check" from the top
+# of the tree. SCOTTFREE can name another MemGlk build of the interpreter
+# to test, such as one built with -fsanitize=address (run with
+# ASAN_OPTIONS=detect_leaks=0, as sessions that go to sleep exit without
+# freeing what they had).
+
+top=$(cd "$(dirname "$0")/.." && pwd)
+interpreter=${SCOTTFREE:-$top/scottfree/scottfree-memglk}
+tools=$top/tools
+work=$(mktemp -d)
+host=
+
+cleanup() {
+    if [ -n "$host" ]; then
+        kill "$host" 2>/dev/null
+        wait "$host" 2>/dev/null
+    fi
+    rm -rf "$work"
+}
+trap cleanup EXIT
+
+fail() {
+    echo "FAIL: $*" >&2
+    exit 1
+}
+
+# A small made-up game and a walkthrough of it, as $work/game.dat and
+# $work/walkthrough.txt
+make_game() {
+    "$tools/gengame" -rooms 20 -items 20 -treasures 3 -actions 150 \
+        "$work/game.dat" "$work/walkthrough.txt" >/dev/null \
+        || fail "cannot make a game"
+}
+
+# The random messages of a made-up game, and the blank lines they leave,
+# taken out of a transcript
+strip_random() {
+    sed -e 's/You hear an* [a-z]* sound\. ([0-9]*)//g' -e 's/ *$//' "$1" \
+        | grep -v '^$'
+}
@@ -0,0 +1,54 @@
+#!/bin/sh
+#
+# Tests of the coverage report (-u).
+
+. "$(dirname "$0")/common.sh"
+
+make_game
+
+# The action lines the reports have run, and the commands they have
+# carried out
+run_lines() {
+    grep -h '^line [0-9]* run ' "$@" | cut -d ' ' -f 2
+}
+commands() {
+    sed -n 's/^commands//p' "$@" | tr ' ' '\n' | grep -v '^$'
+}
+
+head -n 20 "$work/walkthrough.txt" >"$work/first.txt"
+tail -n +21 "$work/walkthrough.txt" >"$work/second.txt"
+for part in first second; do
+    "$interpreter" -n -r 1 -u "$work/$part.coverage" "$work/game.dat" \
+        <"$work/$part.txt" >/dev/null 2>&1
+done
+
+# Two games at once, each played from part of the walkthrough, are
+# merged into one report, whichever finishes first
+"$interpreter" -n -r 1 -u "$work/both.coverage" "$work/game.dat" \
+    <"$work/first.txt" >/dev/null 2>&1 &
+first=$!
+"$interpreter" -n -r 1 -u "$work/both.coverage" "$work/game.dat" \
+    <"$work/second.txt" >/dev/null 2>&1
+wait "$first"
+
+grep -q '^runs 2$' "$work/both.coverage" || fail "the report doesn't count two runs"
+run_lines "$work/both.coverage" >"$work/both.lines"
+run_lines "$work/first.coverage" "$work/second.coverage" | sort -n -u >"$work/union.lines"
+cmp -s "$work/both.lines" "$work/union.lines" || fail "the lines run were not merged"
+commands "$work/both.coverage" | sort -n >"$work/both.commands"
+commands "$work/first.coverage" "$work/second.coverage" | sort -n -u >"$work/union.commands"
+cmp -s "$work/both.commands" "$work/union.commands" || fail "the commands run were not merged"
+grep -qx 0 "$work/both.commands" && fail "the no-op is counted as a command"
+echo "PASS: merging two games into one report"
+
+# A different game leaves the report alone
+"$tools/gengame" -rooms 20 -items 20 -treasures 3 -actions 120 -seed 2 \
+    "$work/other.dat" "$work/other.txt" >/dev/null || fail "cannot make a game"
+cp "$work/both.coverage" "$work/before.coverage"
+"$interpreter" -n -r 1 -u "$work/both.coverage" "$work/other.dat" \
+    <"$work/other.txt" >/dev/null 2>"$work/other.log"
+grep -q "coverage of another game" "$work/other.log" \
+    || fail "the coverage of another game was not noticed"
+cmp -s "$work/before.coverage" "$work/both.coverage" \
+    || fail "the coverage of another game was changed"
+echo "PASS: keeping the coverage of another game"
@@ -0,0 +1,62 @@
+#!/bin/sh
+#
+# Tests of the journal (-j).
+
+. "$(dirname "$0")/common.sh"
+
+"$tools/gengame" -rooms 20 -items 30 -treasures 6 -actions 150 \
+    "$work/game.dat" "$work/walkthrough.txt" >/dev/null \
+    || fail "cannot make a game"
+
+# A checkpoint is written after every 50 commands. Here the 50th is an
+# undo, and the game stops two commands later without ending, as if it
+# had crashed. Carrying on from the journal must play the rest of the
+# commands, another undo among them, exactly as a game that never
+# stopped.
+{
+    head -n 49 "$work/walkthrough.txt"
+    echo UNDO
+    sed -n 50,51p "$work/walkthrough.txt"
+} >"$work/before.txt"
+{
+    sed -n 52,60p "$work/walkthrough.txt"
+    echo UNDO
+    tail -n +61 "$work/walkthrough.txt"
+} >"$work/after.txt"
+cat "$work/before.txt" "$work/after.txt" >"$work/all.txt"
+
+"$interpreter" -n -r 1 -j "$work/journal" "$work/game.dat" \
+    <"$work/before.txt" >"$work/before.out" 2>&1
+[ -f "$work/journal.checkpoint" ] || fail "no checkpoint was written"
+"$interpreter" -n -r 1 -j "$work/journal" "$work/game.dat" \
+    <"$work/after.txt" >"$work/after.out" 2>"$work/after.log" \
+    || fail "cannot carry on from the checkpoint: $(cat "$work/after.log")"
+"$interpreter" -n -r 1 -j "$work/whole" "$work/game.dat" \
+    <"$work/all.txt" >"$work/all.out" 2>/dev/null
+
+# The game carried on starts on a new line, where the other was still
+# on the line of the answer before
+sed 1d "$work/after.out" >"$work/after.cmp"
+grep -q "Move undone" "$work/after.cmp" || fail "the game did not carry on"
+lines=$(wc -l <"$work/after.cmp")
+tail -n "$lines" "$work/all.out" | cmp -s - "$work/after.cmp" || {
+    tail -n "$lines" "$work/all.out" | diff - "$work/after.cmp" | head -n 20 >&2
+    fail "carrying on from a checkpoint after an undo changed the game"
+}
+echo "PASS: a checkpoint after an undo"
+
+# A game played to the end has nothing to recover, so its journal goes
+{ cat "$work/walkthrough.txt"; echo n; } \
+    | "$interpreter" -n -r 1 -j "$work/ended" "$work/game.dat" >/dev/null 2>&1
+[ -f "$work/ended" ] && fail "the journal of a game that ended was kept"
+
+# Anything else that stops the game keeps the journal, above all when it
+# can't be read
+echo "not a record" >"$work/damaged"
+"$interpreter" -n -r 1 -j "$work/damaged" "$work/game.dat" \
+    </dev/null >"$work/damaged.out" 2>&1
+grep -q "damaged" "$work/damaged.out" \
+    || fail "a damaged journal was not noticed"
+grep -q "not a record" "$work/damaged" \
+    || fail "a damaged journal was deleted"
+echo "PASS: keeping the journal unless the game ends"
@@ -0,0 +1,53 @@
+#!/bin/sh
+#
+# Tests of the JSON API (-a).
+
+. "$(dirname "$0")/common.sh"
+
+make_game
+
+# Answers each line of requests with the id of each answer, or "none"
+ids() {
+    printf '%s\n' "$@" \
+        | "$interpreter" -a -n -r 1 "$work/game.dat" 2>/dev/null \
+        | sed -e 's/^{"id":\([^,]*\),.*/\1/' -e 's/^{".*/none/' \
+        | tr '\n' ' '
+}
+
+# The answer to the introduction and the last one, sent when the input
+# runs out, answer no request, so they have no id. An id that isn't a
+# string, a number or null gets an error without one.
+got=$(ids '{"id":7,"command":"look"}' '{"id":"a\"b"}' '{"id":-1.5e3}' \
+    '{"id":null}' '{"id":foo}' '{"id":12x}' '{"id":[1]}')
+expected='none 7 "a\"b" -1.5e3 null none none none none '
+[ "$got" = "$expected" ] || fail "ids were $got, not $expected"
+echo "PASS: request ids"
+
+# Commands that are only tried must leave no trace: the same walkthrough
+# with some tried before every command gets the same answers, once the
+# answers to the tries are taken out.
+whatif='"whatif":["n","get all","drop all","u","d"]'
+sed 's/.*/{"command":"&"}/' "$work/walkthrough.txt" >"$work/plain.json"
+sed "s/.*/{\"command\":\"&\",$whatif}/" "$work/walkthrough.txt" >"$work/tried.json"
+"$interpreter" -a -n -r 1 "$work/game.dat" <"$work/plain.json" >"$work/plain.out" 2>/dev/null
+"$interpreter" -a -n -r 1 "$work/game.dat" <"$work/tried.json" 2>/dev/null \
+    | sed 's/"whatif":\[.*\],"room"/"room"/' >"$work/tried.out"
+grep -q '"stored":3,"treasures":3' "$work/plain.out" || fail "the walkthrough did not solve the game"
+cmp -s "$work/plain.out" "$work/tried.out" || {
+    diff "$work/plain.out" "$work/tried.out" | head -n 10 >&2
+    fail "trying commands changed the game"
+}
+echo "PASS: taking tried commands back"
+
+# Each way a try can stop: at the next line, where the game wants a key
+# because it is over, where it wants a file to save to, and at a command
+# about the game itself, which isn't tried
+{
+    sed '$d' "$work/plain.json"
+    last=$(tail -n 1 "$work/walkthrough.txt")
+    echo "{\"whatif\":[\"n\",\"$last\",\"save game\",\"undo\"]}"
+} | "$interpreter" -a -n -r 1 "$work/game.dat" 2>/dev/null >"$work/ended.out"
+got=$(grep '"whatif"' "$work/ended.out" | grep -o '"ended":"[a-z]*"' | tr '\n' ' ')
+expected='"ended":"line" "ended":"key" "ended":"file" "ended":"untried" '
+[ "$got" = "$expected" ] || fail "tries ended $got, not $expected"
+echo "PASS: where tried commands stop"
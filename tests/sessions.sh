@@ -0,0 +1,64 @@
+#!/bin/sh
+#
+# Tests of the session host (scottfree-memglk -l).
+
+. "$(dirname "$0")/common.sh"
+
+# Serves the game with the given options, plays a script of commands to
+# it with sendlines and writes what came back to a file. What the host
+# printed goes to the same name with .log added.
+play() {
+    script=$1
+    out=$2
+    shift 2
+    "$interpreter" -n -r 1 "$@" -l "$work/sock" "$work/game.dat" 2>"$out.log" &
+    host=$!
+    "$tools/sendlines" "$work/sock" <"$script" >"$out" \
+        || fail "no answer from the game served with $*"
+    kill "$host"
+    wait "$host" 2>/dev/null
+    host=
+}
+
+make_game
+
+# A session that goes to sleep just after an undo must wake where it
+# was, with the rest of its undo history. A woken session starts its
+# random numbers again from the seed, so the random messages aren't
+# compared.
+{
+    head -n 5 "$work/walkthrough.txt"
+    echo UNDO
+    echo "@pause 3"
+    echo UNDO
+    tail -n +6 "$work/walkthrough.txt"
+} >"$work/sleep.txt"
+grep -v '^@' "$work/sleep.txt" >"$work/awake.txt"
+
+play "$work/awake.txt" "$work/awake.out"
+play "$work/sleep.txt" "$work/sleep.out" -z 1
+
+grep -q "asleep" "$work/sleep.out.log" || fail "the session did not go to sleep"
+grep -q "awake" "$work/sleep.out.log" || fail "the session did not wake up"
+strip_random "$work/awake.out" >"$work/awake.stripped"
+strip_random "$work/sleep.out" >"$work/sleep.stripped"
+cmp -s "$work/awake.stripped" "$work/sleep.stripped" || {
+    diff "$work/awake.stripped" "$work/sleep.stripped" | head -n 20 >&2
+    fail "sleeping after an undo changed the game"
+}
+echo "PASS: sleeping after an undo"
+
+# The first player of a game served from a directory is the one whose
+# connection has the game loaded. Their session must still hang up when
+# it ends, as every later one does.
+mkdir "$work/games"
+cp "$work/game.dat" "$work/games/game"
+"$interpreter" -n -r 1 -l "$work/sock" -c 64 "$work/games" 2>"$work/catalog.log" &
+host=$!
+for player in first second; do
+    { echo game; head -n 3 "$work/walkthrough.txt"; } \
+        | "$tools/sendlines" -timeout 5 "$work/sock" >"$work/$player.out" \
+        || fail "the $player player of a game in a directory was not hung up on"
+done
+grep -q "Loaded game" "$work/catalog.log" || fail "the game was not loaded"
+echo "PASS: hanging up on the first player of a game"
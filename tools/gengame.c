@@ -0,0 +1,678 @@
+/*
+ *  gengame.c
+ *
+ *  Writes a made-up ScottFree text database of any size, with a
+ *  walkthrough that solves it, for measuring how the interpreter scales
+ *  with the size of a game.
+ *
+ *  The world is a line of rooms joined north and south, with extra
+ *  random passages east, west, up and down. Each treasure is hidden
+ *  until a made-up verb is used on a made-up noun in its room while
+ *  carrying its key. The rest of the action table is filler of the kinds
+ *  found in real games: random messages, examining things, flag and
+ *  counter puzzles, continued lines and items moved about. None of it
+ *  touches the keys or treasures, so the walkthrough always works.
+ *
+ *  The counts given on the command line are header values, which like
+ *  everything else in the format are the highest number used rather
+ *  than the number of entries. Room 0 is nowhere and the last room is
+ *  where the player goes on dying. Games of 255 rooms or more are
+ *  extended databases, with carried items written as -1.
+ */
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Fixed by the interpreter */
+#define VERB_GO 1
+#define VERB_GET 10
+#define VERB_DROP 18
+#define LIGHT_SOURCE 9
+#define CLASSIC_ROOMS 255
+#define MAX_ROOMS 65534
+
+/* Vocab, conditions and subcommands are stored 150 and 20 to the value */
+#define VOCAB(verb, noun) ((verb) * 150 + (noun))
+#define COND(code, arg) ((code) + 20 * (arg))
+#define SUBCOMMAND(a, b) ((a) * 150 + (b))
+
+enum {
+    C_PARAM = 0,
+    C_CARRIED = 1,
+    C_HERE = 2,
+    C_PRESENT = 3,
+    C_IN_ROOM = 4,
+    C_FLAG_SET = 8,
+    C_FLAG_CLEAR = 9,
+    C_NOT_IN_GAME = 14,
+    C_COUNTER_LE = 15
+};
+
+enum {
+    A_DROP = 53,
+    A_SET_FLAG = 58,
+    A_PUT_IN_ROOM = 62,
+    A_LOOK = 64,
+    A_SCORE = 65,
+    A_INVENTORY = 66,
+    A_SAVE_GAME = 71,
+    A_CONTINUE = 73,
+    A_PRINT_COUNTER = 78,
+    A_ADD_TO_COUNTER = 82
+};
+
+/* The verbs and nouns every game has, followed by made-up ones. They are
+   cut to the word length in the database */
+static const char *fixed_verbs[] = { "AUTO", "GO", "INVENTORY", "SCORE",
+    "LOOK", "EXAMINE", "SAVE", "QUIT", "HELP", "READ", "GET", "*TAKE", "OPEN",
+    "CLOSE", "PUSH", "PULL", "LISTEN", "SMELL", "DROP", "*PUT" };
+static const char *fixed_nouns[] = { "ANY", "NORTH", "SOUTH", "EAST", "WEST",
+    "UP", "DOWN", "LAMP" };
+#define NUM_FIXED_VERBS (sizeof fixed_verbs / sizeof fixed_verbs[0])
+#define NUM_FIXED_NOUNS (sizeof fixed_nouns / sizeof fixed_nouns[0])
+
+#define VERB_INV 2
+#define VERB_SCO 3
+#define VERB_LOO 4
+#define VERB_EXA 5
+#define VERB_SAV 6
+#define NOUN_LAMP 7
+
+static const char *adjectives[] = { "damp", "narrow", "dusty", "bright",
+    "cold", "echoing", "musty", "low", "wide", "crooked", "silent", "smoky" };
+static const char *places[] = { "cave", "passage", "hall", "chamber",
+    "tunnel", "grotto", "cellar", "gallery", "crypt", "vault", "shaft",
+    "landing" };
+static const char *things[] = { "rope", "bottle", "stone", "coin", "bone",
+    "cloak", "candle", "shovel", "mirror", "flute", "helmet", "box" };
+
+#define LENGTH(a) ((int)(sizeof a / sizeof a[0]))
+
+static const char *directions[] = { "N", "S", "E", "W", "U", "D" };
+static const int opposite[] = { 1, 0, 3, 2, 5, 4 };
+
+typedef struct {
+    int vocab;
+    int condition[5];
+    int subcommand[2];
+} Line;
+
+static int num_rooms = 1000;
+static int num_items = 2000;
+static int num_actions = 10000;
+static int num_words = 400;
+static int num_messages = 99;
+static int num_treasures = 100;
+static int word_length = 4;
+static int max_carry = 6;
+static uint64_t seed = 1;
+
+static int (*exits)[6];
+static int *item_location;
+static int *item_noun;
+static Line *lines;
+static int num_lines;
+
+static int *treasure_item, *key_item, *treasure_room, *puzzle_verb, *puzzle_noun;
+
+static FILE *walkthrough;
+
+static void fatal(const char *fmt, ...)
+{
+    va_list ap;
+    fprintf(stderr, "gengame: ");
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "\n");
+    exit(1);
+}
+
+static void *alloc(size_t size)
+{
+    void *p = calloc(1, size);
+    if (p == NULL)
+        fatal("out of memory");
+    return p;
+}
+
+/* The same game on every platform for a given seed, so not rand() */
+static uint64_t rng_state;
+
+static uint32_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return (uint32_t)rng_state;
+}
+
+/* A number from lo to hi inclusive */
+static int random_between(int lo, int hi)
+{
+    return lo + (int)(next_random() % (uint32_t)(hi - lo + 1));
+}
+
+/* Made-up words are a letter for the kind of word followed by a base 26
+   number, so that they are all different within the word length */
+static void make_word(char *buf, char kind, int n)
+{
+    int i;
+    buf[0] = kind;
+    for (i = word_length - 1; i > 0; i--) {
+        buf[i] = 'A' + n % 26;
+        n /= 26;
+    }
+    buf[word_length] = 0;
+}
+
+/* A word as the database has it, in quotes */
+static void write_word(FILE *f, const char *word)
+{
+    int synonym = (word[0] == '*');
+    fprintf(f, "\"%s%.*s\"", synonym ? "*" : "", word_length, word + synonym);
+}
+
+static void write_verb(FILE *f, int n)
+{
+    char buf[16];
+    if (n < (int)NUM_FIXED_VERBS) {
+        write_word(f, fixed_verbs[n]);
+        return;
+    }
+    make_word(buf, 'Q', n);
+    write_word(f, buf);
+}
+
+static void write_noun(FILE *f, int n)
+{
+    char buf[16];
+    if (n < (int)NUM_FIXED_NOUNS) {
+        write_word(f, fixed_nouns[n]);
+        return;
+    }
+    make_word(buf, 'X', n);
+    write_word(f, buf);
+}
+
+/* A word as the player types it */
+static void print_word(FILE *f, const char *word)
+{
+    fprintf(f, "%s", word[0] == '*' ? word + 1 : word);
+}
+
+static void print_verb(FILE *f, int n)
+{
+    char buf[16];
+    if (n < (int)NUM_FIXED_VERBS) {
+        print_word(f, fixed_verbs[n]);
+        return;
+    }
+    make_word(buf, 'Q', n);
+    print_word(f, buf);
+}
+
+static void print_noun(FILE *f, int n)
+{
+    char buf[16];
+    if (n < (int)NUM_FIXED_NOUNS) {
+        print_word(f, fixed_nouns[n]);
+        return;
+    }
+    make_word(buf, 'X', n);
+    print_word(f, buf);
+}
+
+/* Messages 1-51 and 52-99 have different opcodes */
+static int message_op(int message)
+{
+    return (message < 52) ? message : message + 50;
+}
+
+static int random_message(void)
+{
+    /* Message 1 is kept for the treasures */
+    return random_between(2, num_messages < 99 ? num_messages : 99);
+}
+
+static Line *add_line(int vocab)
+{
+    Line *l;
+    if (num_lines > num_actions)
+        fatal("the action table is full (use a larger -actions)");
+    l = &lines[num_lines++];
+    memset(l, 0, sizeof *l);
+    l->vocab = vocab;
+    return l;
+}
+
+static void add_condition(Line *l, int code, int arg)
+{
+    int i;
+    for (i = 0; i < 5; i++) {
+        if (l->condition[i] == 0) {
+            l->condition[i] = COND(code, arg);
+            return;
+        }
+    }
+}
+
+/* Rooms from 1 up to num_rooms - 1 can be visited */
+static int random_room(void)
+{
+    return random_between(1, num_rooms - 1);
+}
+
+/* Verbs after the fixed ones are shared out between the treasure
+   puzzles and the filler, so that no filler line can get in the way of
+   the walkthrough */
+static int first_puzzle_verb, last_puzzle_verb, first_filler_verb, last_filler_verb;
+
+static void make_world(void)
+{
+    int r, d, i, t;
+    int next_noun;
+
+    exits = alloc(sizeof(*exits) * (num_rooms + 1));
+    for (r = 1; r < num_rooms - 1; r++) {
+        exits[r][0] = r + 1;
+        exits[r + 1][1] = r;
+    }
+    /* Each room gets about one more passage */
+    for (i = 0; i < num_rooms; i++) {
+        int a = random_room(), b = random_room();
+        d = random_between(2, 5);
+        if (a != b && exits[a][d] == 0 && exits[b][opposite[d]] == 0) {
+            exits[a][d] = b;
+            exits[b][opposite[d]] = a;
+        }
+    }
+
+    item_location = alloc(sizeof(int) * (num_items + 1));
+    item_noun = alloc(sizeof(int) * (num_items + 1));
+
+    treasure_item = alloc(sizeof(int) * num_treasures);
+    key_item = alloc(sizeof(int) * num_treasures);
+    treasure_room = alloc(sizeof(int) * num_treasures);
+    puzzle_verb = alloc(sizeof(int) * num_treasures);
+    puzzle_noun = alloc(sizeof(int) * num_treasures);
+
+    /* Item 9 is the lamp. Treasures and keys come after it, and each has
+       a noun of its own */
+    item_location[LIGHT_SOURCE] = 1;
+    item_noun[LIGHT_SOURCE] = NOUN_LAMP;
+    next_noun = NUM_FIXED_NOUNS;
+    i = LIGHT_SOURCE + 1;
+    for (t = 0; t < num_treasures; t++) {
+        treasure_item[t] = i++;
+        key_item[t] = i++;
+        item_location[treasure_item[t]] = 0;
+        item_location[key_item[t]] = random_room();
+        item_noun[treasure_item[t]] = next_noun++;
+        item_noun[key_item[t]] = next_noun++;
+        treasure_room[t] = random_room();
+    }
+    /* The rest are scattered about. Some can be taken */
+    for (; i <= num_items; i++) {
+        item_location[i] = random_room();
+        if (next_noun <= num_words && next_random() % 2)
+            item_noun[i] = next_noun++;
+    }
+    for (i = 0; i < LIGHT_SOURCE; i++)
+        item_location[i] = random_room();
+
+    /* The puzzles use verbs and nouns the filler doesn't. Nouns of
+       action lines have to be below 150 */
+    first_puzzle_verb = NUM_FIXED_VERBS;
+    last_puzzle_verb = first_puzzle_verb + (num_words - first_puzzle_verb) / 2;
+    first_filler_verb = last_puzzle_verb + 1;
+    last_filler_verb = num_words;
+    if (num_rooms < CLASSIC_ROOMS && last_filler_verb > 65535 / 150)
+        last_filler_verb = 65535 / 150;
+    for (t = 0; t < num_treasures; t++) {
+        puzzle_verb[t] = random_between(first_puzzle_verb, last_puzzle_verb);
+        puzzle_noun[t] = random_between(NUM_FIXED_NOUNS, 149 < num_words ? 149 : num_words);
+    }
+}
+
+static void make_actions(void)
+{
+    Line *l;
+    int t;
+    int first_filler_item = LIGHT_SOURCE + 1 + 2 * num_treasures;
+
+    lines = alloc(sizeof(Line) * (num_actions + 1));
+
+    l = add_line(VOCAB(VERB_INV, 0));
+    l->subcommand[0] = SUBCOMMAND(A_INVENTORY, 0);
+    l = add_line(VOCAB(VERB_SCO, 0));
+    l->subcommand[0] = SUBCOMMAND(A_SCORE, 0);
+    l = add_line(VOCAB(VERB_LOO, 0));
+    l->subcommand[0] = SUBCOMMAND(A_LOOK, 0);
+    l = add_line(VOCAB(VERB_SAV, 0));
+    l->subcommand[0] = SUBCOMMAND(A_SAVE_GAME, 0);
+
+    /* Treasure puzzles: the treasure is put in the room */
+    for (t = 0; t < num_treasures; t++) {
+        l = add_line(VOCAB(puzzle_verb[t], puzzle_noun[t]));
+        add_condition(l, C_IN_ROOM, treasure_room[t]);
+        add_condition(l, C_CARRIED, key_item[t]);
+        add_condition(l, C_NOT_IN_GAME, treasure_item[t]);
+        add_condition(l, C_PARAM, treasure_item[t]);
+        l->subcommand[0] = SUBCOMMAND(A_DROP, message_op(1));
+    }
+
+    while (num_lines <= num_actions) {
+        int kind = random_between(0, 99);
+        int verb = random_between(first_filler_verb, last_filler_verb);
+        int noun = random_between(0, 149 < num_words ? 149 : num_words);
+        int flag = random_between(1, 14);
+        int item = 0;
+
+        /* Only items that aren't keys or treasures */
+        if (first_filler_item <= num_items)
+            item = random_between(first_filler_item, num_items);
+
+        if (kind < 30) {
+            /* Something happens now and then in a room */
+            l = add_line(VOCAB(0, random_between(1, 20)));
+            add_condition(l, C_IN_ROOM, random_room());
+            l->subcommand[0] = SUBCOMMAND(message_op(random_message()), 0);
+        } else if (kind < 50) {
+            l = add_line(VOCAB(VERB_EXA, noun));
+            add_condition(l, C_PRESENT, item);
+            l->subcommand[0] = SUBCOMMAND(message_op(random_message()), 0);
+        } else if (kind < 70 && num_lines < num_actions) {
+            /* Something that works once */
+            l = add_line(VOCAB(verb, noun));
+            add_condition(l, C_IN_ROOM, random_room());
+            add_condition(l, C_FLAG_CLEAR, flag);
+            add_condition(l, C_PARAM, flag);
+            l->subcommand[0] = SUBCOMMAND(A_SET_FLAG, message_op(random_message()));
+            l = add_line(VOCAB(verb, noun));
+            add_condition(l, C_FLAG_SET, flag);
+            l->subcommand[0] = SUBCOMMAND(message_op(random_message()), 0);
+        } else if (kind < 80) {
+            l = add_line(VOCAB(verb, noun));
+            add_condition(l, C_COUNTER_LE, random_between(5, 50));
+            add_condition(l, C_PARAM, random_between(1, 3));
+            l->subcommand[0] = SUBCOMMAND(A_ADD_TO_COUNTER, A_PRINT_COUNTER);
+        } else if (kind < 90 && num_lines + 2 <= num_actions) {
+            /* A line continued by two more */
+            l = add_line(VOCAB(verb, noun));
+            add_condition(l, C_HERE, item);
+            l->subcommand[0] = SUBCOMMAND(message_op(random_message()), A_CONTINUE);
+            l = add_line(0);
+            add_condition(l, C_FLAG_SET, flag);
+            l->subcommand[0] = SUBCOMMAND(message_op(random_message()), 0);
+            l = add_line(0);
+            add_condition(l, C_FLAG_CLEAR, flag);
+            l->subcommand[0] = SUBCOMMAND(message_op(random_message()), 0);
+        } else {
+            /* Something is moved somewhere else */
+            l = add_line(VOCAB(verb, noun));
+            add_condition(l, C_CARRIED, item);
+            add_condition(l, C_PARAM, item);
+            add_condition(l, C_PARAM, random_room());
+            l->subcommand[0] = SUBCOMMAND(A_PUT_IN_ROOM, message_op(random_message()));
+        }
+    }
+}
+
+static void write_game(FILE *f)
+{
+    int i, r;
+
+    fprintf(f, "0 %d %d %d %d %d %d %d %d %d %d %d\n", num_items, num_actions,
+        num_words, num_rooms, max_carry, 1, num_treasures, word_length, -1,
+        num_messages, 1);
+
+    for (i = 0; i <= num_actions; i++) {
+        Line *l = &lines[i];
+        fprintf(f, "%d %d %d %d %d %d %d %d\n", l->vocab, l->condition[0],
+            l->condition[1], l->condition[2], l->condition[3], l->condition[4],
+            l->subcommand[0], l->subcommand[1]);
+    }
+
+    for (i = 0; i <= num_words; i++) {
+        write_verb(f, i);
+        fprintf(f, " ");
+        write_noun(f, i);
+        fprintf(f, "\n");
+    }
+
+    for (r = 0; r <= num_rooms; r++) {
+        fprintf(f, "%d %d %d %d %d %d ", exits[r][0], exits[r][1], exits[r][2],
+            exits[r][3], exits[r][4], exits[r][5]);
+        if (r == 0)
+            fprintf(f, "\"\"\n");
+        else if (r == num_rooms)
+            fprintf(f, "\"*I'm dead\"\n");
+        else
+            fprintf(f, "\"%s %s %d\"\n", adjectives[r % LENGTH(adjectives)],
+                places[(r / LENGTH(adjectives)) % LENGTH(places)], r);
+    }
+
+    fprintf(f, "\"\"\n\"Something appears!\"\n");
+    for (i = 2; i <= num_messages; i++)
+        fprintf(f, "\"You hear a %s sound. (%d)\"\n",
+            adjectives[i % LENGTH(adjectives)], i);
+
+    for (i = 0; i <= num_items; i++) {
+        const char *star = "";
+        const char *name = things[i % LENGTH(things)];
+        int t;
+        for (t = 0; t < num_treasures; t++) {
+            if (treasure_item[t] == i)
+                star = "*";
+            if (key_item[t] == i)
+                name = "key";
+        }
+        if (i == LIGHT_SOURCE)
+            name = "lamp";
+        fprintf(f, "\"%s%s %d%s", star, name, i, star);
+        if (item_noun[i]) {
+            fprintf(f, "/");
+            print_noun(f, item_noun[i]);
+            fprintf(f, "/");
+        }
+        fprintf(f, "\" %d\n", item_location[i]);
+    }
+
+    for (i = 0; i <= num_actions; i++)
+        fprintf(f, "\"\"\n");
+    fprintf(f, "100\n1\n");
+}
+
+/* Walk by the shortest way, found by a breadth first search */
+static int *came_from, *queue;
+static int player_room;
+
+static void walk_to(int to)
+{
+    int head = 0, tail = 0, r, d;
+    int *path, length = 0;
+
+    if (player_room == to)
+        return;
+
+    for (r = 0; r <= num_rooms; r++)
+        came_from[r] = -1;
+    came_from[player_room] = player_room;
+    queue[tail++] = player_room;
+    while (head < tail && came_from[to] < 0) {
+        r = queue[head++];
+        for (d = 0; d < 6; d++) {
+            int n = exits[r][d];
+            if (n && came_from[n] < 0) {
+                came_from[n] = r;
+                queue[tail++] = n;
+            }
+        }
+    }
+    if (came_from[to] < 0)
+        fatal("room %d can't be reached from room %d", to, player_room);
+
+    path = queue;
+    for (r = to; r != player_room; r = came_from[r])
+        path[length++] = r;
+    while (length--) {
+        r = path[length];
+        for (d = 0; exits[player_room][d] != r; d++)
+            ;
+        fprintf(walkthrough, "%s\n", directions[d]);
+        player_room = r;
+    }
+}
+
+static void command(int verb, int noun)
+{
+    print_verb(walkthrough, verb);
+    fprintf(walkthrough, " ");
+    print_noun(walkthrough, noun);
+    fprintf(walkthrough, "\n");
+}
+
+static void write_walkthrough(void)
+{
+    int t;
+
+    came_from = alloc(sizeof(int) * (num_rooms + 1));
+    queue = alloc(sizeof(int) * (num_rooms + 1));
+    player_room = 1;
+
+    fprintf(walkthrough, "LOOK\nINV\n");
+    for (t = 0; t < num_treasures; t++) {
+        walk_to(item_location[key_item[t]]);
+        command(VERB_GET, item_noun[key_item[t]]);
+        walk_to(treasure_room[t]);
+        command(puzzle_verb[t], puzzle_noun[t]);
+        command(VERB_GET, item_noun[treasure_item[t]]);
+        command(VERB_DROP, item_noun[key_item[t]]);
+        /* Something the filler may answer on the way back */
+        command(VERB_EXA, random_between(0, 149 < num_words ? 149 : num_words));
+        command(random_between(first_filler_verb, last_filler_verb),
+            random_between(0, 149 < num_words ? 149 : num_words));
+        walk_to(1);
+        command(VERB_DROP, item_noun[treasure_item[t]]);
+    }
+    fprintf(walkthrough, "SCORE\n");
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: gengame [options] game.dat [walkthrough.txt]\n"
+                    "  -rooms n        rooms (%d)\n"
+                    "  -items n        items (%d)\n"
+                    "  -actions n      action lines (%d)\n"
+                    "  -words n        verbs and nouns (%d)\n"
+                    "  -messages n     messages (%d)\n"
+                    "  -treasures n    treasures to find (%d)\n"
+                    "  -wordlength n   letters in a word that count (%d)\n"
+                    "  -carry n        items that can be carried (%d)\n"
+                    "  -seed n         random seed (%llu)\n"
+                    "All counts are header values: the highest number used.\n",
+        num_rooms, num_items, num_actions, num_words, num_messages,
+        num_treasures, word_length, max_carry, (unsigned long long)seed);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    const char *game_name = NULL, *walkthrough_name = NULL;
+    FILE *f;
+    int i, word_limit;
+
+    for (i = 1; i < argc; i++) {
+        int *value = NULL;
+        if (argv[i][0] != '-') {
+            if (game_name == NULL)
+                game_name = argv[i];
+            else if (walkthrough_name == NULL)
+                walkthrough_name = argv[i];
+            else
+                usage();
+            continue;
+        }
+        if (i + 1 >= argc)
+            usage();
+        if (!strcmp(argv[i], "-rooms"))
+            value = &num_rooms;
+        else if (!strcmp(argv[i], "-items"))
+            value = &num_items;
+        else if (!strcmp(argv[i], "-actions"))
+            value = &num_actions;
+        else if (!strcmp(argv[i], "-words"))
+            value = &num_words;
+        else if (!strcmp(argv[i], "-messages"))
+            value = &num_messages;
+        else if (!strcmp(argv[i], "-treasures"))
+            value = &num_treasures;
+        else if (!strcmp(argv[i], "-wordlength"))
+            value = &word_length;
+        else if (!strcmp(argv[i], "-carry"))
+            value = &max_carry;
+        else if (!strcmp(argv[i], "-seed"))
+            seed = strtoull(argv[++i], NULL, 10);
+        else
+            usage();
+        if (value)
+            *value = atoi(argv[++i]);
+    }
+    if (game_name == NULL)
+        usage();
+
+    if (num_rooms < 3 || num_rooms > MAX_ROOMS)
+        fatal("-rooms must be from 3 to %d", MAX_ROOMS);
+    if (word_length < 3 || word_length > 8)
+        fatal("-wordlength must be from 3 to 8");
+    if (num_words < (int)NUM_FIXED_VERBS + 2)
+        fatal("-words must be at least %d", (int)NUM_FIXED_VERBS + 2);
+    if (num_treasures < 1)
+        fatal("-treasures must be at least 1");
+    if (num_items < LIGHT_SOURCE + 2 * num_treasures)
+        fatal("-items must be at least %d for %d treasures", LIGHT_SOURCE + 2 * num_treasures, num_treasures);
+    if (NUM_FIXED_NOUNS + 2 * num_treasures > (size_t)num_words + 1)
+        fatal("-words must be at least %d for %d treasures", (int)NUM_FIXED_NOUNS + 2 * num_treasures - 1, num_treasures);
+    if (num_actions < 3 + num_treasures)
+        fatal("-actions must be at least %d for %d treasures", 3 + num_treasures, num_treasures);
+    if (num_messages < 2)
+        fatal("-messages must be at least 2");
+    if (max_carry < 2)
+        fatal("-carry must be at least 2");
+    for (i = 1, word_limit = 26; i < word_length - 1 && word_limit < MAX_ROOMS; i++)
+        word_limit *= 26;
+    if (num_words >= word_limit)
+        fatal("-words must be below %d for a word length of %d", word_limit, word_length);
+    /* Classic databases keep action values to 16 bits */
+    if (num_rooms < CLASSIC_ROOMS && num_items > 65535 / 20)
+        fatal("-items can be at most %d with fewer than %d rooms", 65535 / 20, CLASSIC_ROOMS);
+    if (num_rooms < CLASSIC_ROOMS && NUM_FIXED_VERBS + (num_words - NUM_FIXED_VERBS) / 2 > 65535 / 150)
+        fatal("-words can be at most %d with fewer than %d rooms", 2 * (65535 / 150) - (int)NUM_FIXED_VERBS, CLASSIC_ROOMS);
+
+    rng_state = seed ? seed : 1;
+
+    make_world();
+    make_actions();
+
+    f = fopen(game_name, "w");
+    if (f == NULL)
+        fatal("can't write %s", game_name);
+    write_game(f);
+    if (fclose(f))
+        fatal("can't write %s", game_name);
+
+    if (walkthrough_name) {
+        walkthrough = fopen(walkthrough_name, "w");
+        if (walkthrough == NULL)
+            fatal("can't write %s", walkthrough_name);
+        write_walkthrough();
+        if (fclose(walkthrough))
+            fatal("can't write %s", walkthrough_name);
+    }
+
+    return 0;
+}
@@ -0,0 +1,571 @@
+/*
+ *  runcorpus.c
+ *
+ *  Plays every walkthrough of a corpus through the interpreter and
+ *  compares what the game answers with a transcript kept from an earlier
+ *  run, to catch any change in how games behave.
+ *
+ *  The corpus is a list file with one job per line: a game, a
+ *  walkthrough of one command per line and the transcript, with paths
+ *  relative to the list file, and optionally the random seed to use.
+ *  Blank lines and lines starting with # are skipped:
+ *
+ *      # game        walkthrough     transcript      seed
+ *      adv01.dat     adv01.txt       adv01.out
+ *      adv01.dat     adv01-die.txt   adv01-die.out   7
+ *
+ *  Each job is a scottfree-memglk process of its own, run with the JSON
+ *  API (-a), no delays and a fixed seed, so a transcript has one line of
+ *  JSON per turn and the same commands always give the same lines. As
+ *  many jobs run at once as there are processors. They are handed out
+ *  from one queue, longest walkthrough first, and whichever process
+ *  finishes takes the next job, so nothing waits on a slow one at the
+ *  end. The output of each is compared with its transcript as it
+ *  arrives, and a job is stopped at the first turn that differs.
+ *
+ *  With -update the transcripts are written instead, and with -coverage
+ *  each game adds what it ran to a coverage report (see -u).
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+/* How much of a line that differs to show */
+#define SNIPPET 72
+
+struct Job {
+    char *game;
+    char *walkthrough;
+    char *transcript;
+    unsigned long seed;
+    long size;
+    char *failure;
+};
+
+struct Line {
+    char *text;
+    int length, size;
+};
+
+/* A job that is running */
+struct Session {
+    struct Job *job;
+    pid_t pid;
+    int out;
+    double started;
+    FILE *transcript; /* being read, or written with -update */
+    char *tmpname;
+    int turn; /* lines of output so far */
+    int column;
+    int diverged; /* at turn and column */
+    int complete; /* the line that differs has been read */
+    struct Line actual, expected;
+    int eof;
+};
+
+static const char *interpreter = NULL;
+static int updating = 0;
+static int verbose = 0;
+static int timeout = 60;
+static const char *coverage = NULL;
+static unsigned long default_seed = 1;
+
+static struct Job *jobs = NULL;
+static int numjobs = 0;
+
+static void fatal(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "runcorpus: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(2);
+}
+
+static void *allocate(size_t size)
+{
+    void *p = malloc(size);
+    if (p == NULL)
+        fatal("out of memory");
+    return p;
+}
+
+static char *format(const char *fmt, ...)
+{
+    va_list ap;
+    char *s;
+    int len;
+
+    va_start(ap, fmt);
+    len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    s = allocate(len + 1);
+    va_start(ap, fmt);
+    vsnprintf(s, len + 1, fmt, ap);
+    va_end(ap);
+    return s;
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static char *relative_to(const char *dir, const char *path)
+{
+    if (path[0] == '/' || dir[0] == 0)
+        return format("%s", path);
+    return format("%s/%s", dir, path);
+}
+
+static void read_list(const char *listname)
+{
+    char line[4096], dir[4096];
+    const char *slash = strrchr(listname, '/');
+    int size = 0, lineno = 0;
+    FILE *f = fopen(listname, "r");
+
+    if (f == NULL)
+        fatal("%s: %s", listname, strerror(errno));
+    snprintf(dir, sizeof(dir), "%.*s", slash ? (int)(slash - listname) : 0, listname);
+
+    while (fgets(line, sizeof(line), f)) {
+        char game[4096], walkthrough[4096], transcript[4096];
+        struct Job *job;
+        struct stat st;
+        unsigned long seed = default_seed;
+        int fields;
+
+        lineno++;
+        fields = sscanf(line, "%4095s %4095s %4095s %lu", game, walkthrough, transcript, &seed);
+        if (fields <= 0 || game[0] == '#')
+            continue;
+        if (fields < 3)
+            fatal("%s:%d: expected a game, a walkthrough and a transcript", listname, lineno);
+
+        if (numjobs == size) {
+            size = size ? size * 2 : 64;
+            jobs = realloc(jobs, size * sizeof(struct Job));
+            if (jobs == NULL)
+                fatal("out of memory");
+        }
+        job = &jobs[numjobs++];
+        job->game = relative_to(dir, game);
+        job->walkthrough = relative_to(dir, walkthrough);
+        job->transcript = relative_to(dir, transcript);
+        job->seed = seed;
+        job->failure = NULL;
+        if (stat(job->walkthrough, &st) == -1)
+            fatal("%s: %s", job->walkthrough, strerror(errno));
+        job->size = (long)st.st_size;
+    }
+    fclose(f);
+}
+
+static int longest_first(const void *a, const void *b)
+{
+    long sa = ((const struct Job *)a)->size, sb = ((const struct Job *)b)->size;
+    return sa < sb ? 1 : sa > sb ? -1 : 0;
+}
+
+/* The walkthrough as requests for the JSON API, one command each, so
+   that every turn gets an answer of its own */
+static FILE *requests_for(const char *walkthrough)
+{
+    FILE *in = fopen(walkthrough, "r"), *out;
+    int c, start = 1;
+
+    if (in == NULL)
+        return NULL;
+    out = tmpfile();
+    if (out == NULL)
+        fatal("cannot make a temporary file: %s", strerror(errno));
+    while ((c = getc(in)) != EOF) {
+        if (start) {
+            fputs("{\"command\":\"", out);
+            start = 0;
+        }
+        if (c == '\n') {
+            fputs("\"}\n", out);
+            start = 1;
+        } else if (c == '\r') {
+            continue;
+        } else if (c == '"' || c == '\\') {
+            fprintf(out, "\\%c", c);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            putc(c, out);
+        }
+    }
+    if (!start)
+        fputs("\"}\n", out);
+    fclose(in);
+    rewind(out);
+    return out;
+}
+
+static void fail(struct Session *s, const char *fmt, ...)
+{
+    va_list ap;
+    int len;
+
+    if (s->job->failure != NULL)
+        return;
+    va_start(ap, fmt);
+    len = vsnprintf(NULL, 0, fmt, ap);
+    va_end(ap);
+    s->job->failure = allocate(len + 1);
+    va_start(ap, fmt);
+    vsnprintf(s->job->failure, len + 1, fmt, ap);
+    va_end(ap);
+}
+
+static int start_session(struct Session *s, struct Job *job)
+{
+    char seed[32];
+    int pipefd[2];
+    FILE *requests;
+
+    memset(s, 0, sizeof(*s));
+    s->job = job;
+
+    requests = requests_for(job->walkthrough);
+    if (requests == NULL) {
+        fail(s, "%s: %s", job->walkthrough, strerror(errno));
+        return 0;
+    }
+    if (updating) {
+        s->tmpname = format("%s.new", job->transcript);
+        s->transcript = fopen(s->tmpname, "w");
+    } else {
+        s->transcript = fopen(job->transcript, "r");
+    }
+    if (s->transcript == NULL) {
+        fail(s, "%s: %s", updating ? s->tmpname : job->transcript, strerror(errno));
+        free(s->tmpname);
+        fclose(requests);
+        return 0;
+    }
+
+    /* Freed by end_session(), so only a session that starts has them */
+    s->actual.size = s->expected.size = 256;
+    s->actual.text = allocate(s->actual.size);
+    s->expected.text = allocate(s->expected.size);
+
+    if (pipe(pipefd) == -1)
+        fatal("cannot make a pipe: %s", strerror(errno));
+    snprintf(seed, sizeof(seed), "%lu", job->seed);
+    s->pid = fork();
+    if (s->pid == -1)
+        fatal("cannot fork: %s", strerror(errno));
+    if (s->pid == 0) {
+        int null = open("/dev/null", O_WRONLY);
+        dup2(fileno(requests), STDIN_FILENO);
+        dup2(pipefd[1], STDOUT_FILENO);
+        if (null != -1)
+            dup2(null, STDERR_FILENO);
+        close(pipefd[0]);
+        close(pipefd[1]);
+        if (coverage != NULL)
+            execl(interpreter, interpreter, "-a", "-n", "-r", seed, "-u", coverage, job->game, (char *)NULL);
+        else
+            execl(interpreter, interpreter, "-a", "-n", "-r", seed, job->game, (char *)NULL);
+        _exit(127);
+    }
+    close(pipefd[1]);
+    fclose(requests);
+    s->out = pipefd[0];
+    s->started = seconds();
+    return 1;
+}
+
+static void add_char(struct Line *line, char c)
+{
+    if (line->length + 1 >= line->size) {
+        line->size *= 2;
+        line->text = realloc(line->text, line->size);
+        if (line->text == NULL)
+            fatal("out of memory");
+    }
+    line->text[line->length++] = c;
+    line->text[line->length] = 0;
+}
+
+/* The part of a line around where it differs */
+static const char *snippet(const char *line, int column)
+{
+    static char buf[2][SNIPPET + 8];
+    static int which = 0;
+    int start = column > SNIPPET / 2 ? column - SNIPPET / 2 : 0;
+    int len = (int)strlen(line) - start;
+
+    which = !which;
+    if (len < 0)
+        len = 0;
+    snprintf(buf[which], sizeof(buf[which]), "%s%.*s%s", start ? "..." : "",
+        len > SNIPPET ? SNIPPET : len, line + start, len > SNIPPET ? "..." : "");
+    return buf[which];
+}
+
+/* The command of a turn, for the report */
+static char *command_of(const char *walkthrough, int turn)
+{
+    char line[512];
+    FILE *f = fopen(walkthrough, "r");
+    int n = 0;
+
+    if (f == NULL || turn == 0) {
+        if (f)
+            fclose(f);
+        return format("(before the first command)");
+    }
+    while (fgets(line, sizeof(line), f))
+        if (++n == turn) {
+            line[strcspn(line, "\r\n")] = 0;
+            fclose(f);
+            return format("\"%s\"", line);
+        }
+    fclose(f);
+    return format("(after the last command)");
+}
+
+static void report_divergence(struct Session *s)
+{
+    int c;
+    char *command;
+
+    /* The rest of the expected line */
+    while ((c = getc(s->transcript)) != EOF && c != '\n')
+        add_char(&s->expected, (char)c);
+    command = command_of(s->job->walkthrough, s->turn);
+    fail(s, "turn %d, command %s:\n    expected: %s\n    got:      %s", s->turn,
+        command, s->expected.length ? snippet(s->expected.text, s->column) : "(the end)",
+        s->actual.length ? snippet(s->actual.text, s->column) : "(the end)");
+    free(command);
+}
+
+/* Compares what the game wrote with the transcript, a byte at a time */
+static void take_output(struct Session *s, const char *buf, int len)
+{
+    for (int i = 0; i < len && !s->complete; i++) {
+        char c = buf[i];
+        if (s->diverged) {
+            /* Collect the rest of the line that differs */
+            if (c == '\n')
+                s->complete = 1;
+            else
+                add_char(&s->actual, c);
+            continue;
+        }
+        if (updating) {
+            putc(c, s->transcript);
+        } else {
+            int e = getc(s->transcript);
+            if (e != (unsigned char)c) {
+                if (e != EOF)
+                    ungetc(e, s->transcript);
+                s->diverged = 1;
+                i--;
+                continue;
+            }
+        }
+        if (c == '\n') {
+            s->turn++;
+            s->column = 0;
+            s->actual.length = s->expected.length = 0;
+        } else {
+            if (!updating) {
+                add_char(&s->actual, c);
+                add_char(&s->expected, c);
+            }
+            s->column++;
+        }
+    }
+}
+
+static void end_session(struct Session *s)
+{
+    int status, c;
+
+    if (s->diverged || s->job->failure != NULL)
+        kill(s->pid, SIGKILL);
+    close(s->out);
+    waitpid(s->pid, &status, 0);
+
+    if (s->job->failure != NULL) {
+        /* Already known */
+    } else if (s->diverged) {
+        report_divergence(s);
+    } else if (WIFSIGNALED(status)) {
+        fail(s, "the interpreter was killed by signal %d at turn %d", WTERMSIG(status), s->turn);
+    } else if (WEXITSTATUS(status) == 127) {
+        fail(s, "cannot run %s", interpreter);
+    } else if (WEXITSTATUS(status) != 0) {
+        fail(s, "the interpreter exited with status %d at turn %d", WEXITSTATUS(status), s->turn);
+    } else if (!updating && (c = getc(s->transcript)) != EOF) {
+        /* The game stopped early */
+        ungetc(c, s->transcript);
+        report_divergence(s);
+    }
+
+    if (fclose(s->transcript) == EOF && updating)
+        fail(s, "%s: %s", s->tmpname, strerror(errno));
+    if (updating) {
+        if (s->job->failure == NULL && rename(s->tmpname, s->job->transcript) == -1)
+            fail(s, "%s: %s", s->job->transcript, strerror(errno));
+        if (s->job->failure != NULL)
+            unlink(s->tmpname);
+        free(s->tmpname);
+    }
+    free(s->actual.text);
+    free(s->expected.text);
+
+    if (verbose)
+        printf("%s %s %s (%d turns, %.3f s)\n", s->job->failure ? "FAIL" : "ok  ",
+            s->job->game, s->job->walkthrough, s->turn, seconds() - s->started);
+}
+
+static int processors(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: runcorpus [options] corpus.list\n"
+                    "  -coverage path     add the action lines each game runs to the coverage\n"
+                    "                     reports in the directory path\n"
+                    "  -interpreter path  scottfree-memglk to run (../scottfree/scottfree-memglk\n"
+                    "                     next to this program)\n"
+                    "  -jobs n            sessions at once (%d, the number of processors)\n"
+                    "  -seed n            seed for jobs that don't give one (%lu)\n"
+                    "  -timeout secs      longest a job may take (%d)\n"
+                    "  -update            write the transcripts instead of comparing\n"
+                    "  -v                 list every job\n",
+        processors(), default_seed, timeout);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *listname = NULL;
+    int parallel = processors(), running = 0, next = 0, failed = 0;
+    struct Session *sessions;
+    struct pollfd *pfds;
+    double start = seconds();
+    int i;
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            if (listname != NULL)
+                usage();
+            listname = argv[i];
+        } else if (!strcmp(argv[i], "-update")) {
+            updating = 1;
+        } else if (!strcmp(argv[i], "-v")) {
+            verbose = 1;
+        } else if (i + 1 >= argc) {
+            usage();
+        } else if (!strcmp(argv[i], "-interpreter")) {
+            interpreter = argv[++i];
+        } else if (!strcmp(argv[i], "-jobs")) {
+            parallel = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-seed")) {
+            default_seed = strtoul(argv[++i], NULL, 10);
+        } else if (!strcmp(argv[i], "-coverage")) {
+            coverage = argv[++i];
+        } else if (!strcmp(argv[i], "-timeout")) {
+            timeout = atoi(argv[++i]);
+        } else {
+            usage();
+        }
+    }
+    if (listname == NULL || parallel < 1)
+        usage();
+    if (interpreter == NULL) {
+        const char *slash = strrchr(argv[0], '/');
+        interpreter = format("%.*s../scottfree/scottfree-memglk",
+            slash ? (int)(slash - argv[0] + 1) : 0, argv[0]);
+    }
+
+    read_list(listname);
+    qsort(jobs, numjobs, sizeof(struct Job), longest_first);
+    if (parallel > numjobs)
+        parallel = numjobs ? numjobs : 1;
+    sessions = allocate(parallel * sizeof(struct Session));
+    pfds = allocate(parallel * sizeof(struct pollfd));
+    for (i = 0; i < parallel; i++)
+        sessions[i].job = NULL;
+
+    while (next < numjobs || running > 0) {
+        /* Every free slot takes the next job */
+        for (i = 0; i < parallel && next < numjobs; i++) {
+            if (sessions[i].job != NULL)
+                continue;
+            if (start_session(&sessions[i], &jobs[next]))
+                running++;
+            else
+                sessions[i].job = NULL;
+            next++;
+        }
+
+        for (i = 0; i < parallel; i++) {
+            pfds[i].fd = sessions[i].job ? sessions[i].out : -1;
+            pfds[i].events = POLLIN;
+            pfds[i].revents = 0;
+        }
+        if (running == 0)
+            continue;
+        if (poll(pfds, parallel, 1000) == -1 && errno != EINTR)
+            fatal("poll: %s", strerror(errno));
+
+        for (i = 0; i < parallel; i++) {
+            struct Session *s = &sessions[i];
+            char buf[65536];
+            ssize_t got = 0;
+
+            if (s->job == NULL)
+                continue;
+            if (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                got = read(s->out, buf, sizeof(buf));
+                if (got > 0)
+                    take_output(s, buf, (int)got);
+            }
+            if (seconds() - s->started > timeout)
+                fail(s, "timed out at turn %d", s->turn);
+            if (got == 0 && (pfds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                s->eof = 1;
+            if (s->eof || s->complete || s->job->failure != NULL) {
+                end_session(s);
+                s->job = NULL;
+                running--;
+            }
+        }
+    }
+
+    for (i = 0; i < numjobs; i++) {
+        if (jobs[i].failure == NULL)
+            continue;
+        failed++;
+        printf("FAIL %s %s: %s\n", jobs[i].game, jobs[i].walkthrough, jobs[i].failure);
+    }
+    printf("%d of %d jobs %s in %.3f s\n", numjobs - failed, numjobs,
+        updating ? "written" : "passed", seconds() - start);
+    return failed ? 1 : 0;
+}
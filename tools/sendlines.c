@@ -0,0 +1,163 @@
+/*
+ *  sendlines.c
+ *
+ *  Plays a script of commands to a game served on a Unix domain socket
+ *  (scottfree-memglk -l) and prints everything the game sends back, for
+ *  testing the session host from a shell script.
+ *
+ *  Each line of the script is sent as it is, except that a line of the
+ *  form
+ *
+ *      @pause 3
+ *
+ *  sends nothing and only reads for that many seconds, long enough for
+ *  an idle session to go to sleep. At the end of the script the
+ *  connection is shut down for writing, and whatever the game still has
+ *  to say is read until it hangs up.
+ */
+
+#include <errno.h>
+#include <poll.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+
+static int timeout = 10;
+
+static void fatal(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    fprintf(stderr, "sendlines: ");
+    vfprintf(stderr, fmt, ap);
+    fprintf(stderr, "\n");
+    va_end(ap);
+    exit(2);
+}
+
+static double seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Copies what the game sends to stdout for the given time, or until it
+   hangs up. Returns 0 once it has. */
+static int copy_output(int conn, double wait)
+{
+    double until = seconds() + wait;
+    char buf[4096];
+
+    while (1) {
+        struct pollfd pfd = { conn, POLLIN, 0 };
+        double left = until - seconds();
+        ssize_t got;
+        int result;
+
+        if (left <= 0)
+            return 1;
+        result = poll(&pfd, 1, (int)(left * 1000) + 1);
+        if (result == -1 && errno == EINTR)
+            continue;
+        if (result == -1)
+            fatal("poll: %s", strerror(errno));
+        if (result == 0)
+            return 1;
+        got = read(conn, buf, sizeof(buf));
+        if (got == -1 && errno == EINTR)
+            continue;
+        if (got <= 0)
+            return 0;
+        fwrite(buf, 1, got, stdout);
+    }
+}
+
+static int connect_to(const char *path)
+{
+    struct sockaddr_un addr;
+    int fd, tries;
+
+    if (strlen(path) >= sizeof(addr.sun_path))
+        fatal("%s: socket path too long", path);
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strcpy(addr.sun_path, path);
+
+    /* The server may still be starting */
+    for (tries = 0; tries < timeout * 10; tries++) {
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+            fatal("cannot create socket: %s", strerror(errno));
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0)
+            return fd;
+        close(fd);
+        usleep(100000);
+    }
+    fatal("%s: %s", path, strerror(errno));
+    return -1;
+}
+
+static void send_all(int conn, const char *text, size_t length)
+{
+    while (length > 0) {
+        ssize_t sent = send(conn, text, length, MSG_NOSIGNAL);
+        if (sent == -1 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            fatal("send: %s", strerror(errno));
+        text += sent;
+        length -= sent;
+    }
+}
+
+static void usage(void)
+{
+    fprintf(stderr, "usage: sendlines [-timeout secs] socket < script\n"
+                    "  -timeout secs   give up on a game that doesn't hang up (%d)\n",
+        timeout);
+    exit(2);
+}
+
+int main(int argc, char **argv)
+{
+    const char *path = NULL;
+    char line[4096];
+    int conn, seconds_to_pause, i;
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-') {
+            if (path != NULL)
+                usage();
+            path = argv[i];
+        } else if (!strcmp(argv[i], "-timeout") && i + 1 < argc) {
+            timeout = atoi(argv[++i]);
+        } else {
+            usage();
+        }
+    }
+    if (path == NULL || timeout < 1)
+        usage();
+
+    conn = connect_to(path);
+    while (fgets(line, sizeof(line), stdin)) {
+        if (sscanf(line, "@pause %d", &seconds_to_pause) == 1) {
+            fflush(stdout);
+            if (!copy_output(conn, seconds_to_pause))
+                fatal("the game hung up");
+            continue;
+        }
+        send_all(conn, line, strlen(line));
+    }
+
+    shutdown(conn, SHUT_WR);
+    if (copy_output(conn, timeout))
+        fatal("the game did not hang up");
+    close(conn);
+    return 0;
+}